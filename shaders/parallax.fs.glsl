@@ -0,0 +1,52 @@
+#version 330
+
+// One full-screen pass over every background layer, back to front
+uniform sampler2D background_color;
+uniform sampler2D moon;
+uniform sampler2D clouds_far;
+uniform sampler2D clouds_close;
+uniform sampler2D rain;
+uniform sampler2D background;
+uniform sampler2D lava;
+
+// Per layer, in the order above: where one tile of the texture sits in world
+// pixels (corner, size), its scroll speed in pixels per second, and on which
+// axes it tiles (1) instead of being clear outside its rect (0)
+const int LAYER_COUNT = 7;
+uniform vec4 rects[LAYER_COUNT];
+uniform vec2 velocities[LAYER_COUNT];
+uniform vec2 repeats[LAYER_COUNT];
+// seconds
+uniform float time;
+
+in vec2 world_position;
+
+layout(location = 0) out vec4 color;
+
+vec4 layer(sampler2D tex, int index, vec2 phase)
+{
+	vec2 uv = (world_position - rects[index].xy - velocities[index] * time) / rects[index].zw + phase;
+	uv = mix(uv, fract(uv), repeats[index]);
+	if (any(lessThan(uv, vec2(0))) || any(greaterThan(uv, vec2(1))))
+		return vec4(0);
+	return texture(tex, uv);
+}
+
+vec3 over(vec3 below, vec4 above)
+{
+	return mix(below, above.rgb, above.a);
+}
+
+void main()
+{
+	vec3 result = layer(background_color, 0, vec2(0)).rgb;
+	result = over(result, layer(moon, 1, vec2(0)));
+	result = over(result, layer(clouds_far, 2, vec2(0)));
+	result = over(result, layer(clouds_close, 3, vec2(0)));
+	// two staggered sheets of rain, as dense as the copies it replaces
+	result = over(result, layer(rain, 4, vec2(0)));
+	result = over(result, layer(rain, 4, vec2(0.5)));
+	result = over(result, layer(background, 5, vec2(0)));
+	result = over(result, layer(lava, 6, vec2(0)));
+	color = vec4(result, 1.0);
+}
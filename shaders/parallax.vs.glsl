@@ -0,0 +1,14 @@
+#version 330
+
+in vec3 in_position;
+
+uniform vec2 world_size;
+
+// Window position in world pixels, y pointing down like the game's
+out vec2 world_position;
+
+void main()
+{
+	gl_Position = vec4(in_position.xy, 0, 1.0);
+	world_position = vec2(in_position.x + 1, 1 - in_position.y) / 2.f * world_size;
+}
@@ -0,0 +1,14 @@
+#version 330
+
+in vec3 vcolor;
+in float valpha;
+in vec2 corner;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	// round, soft edged
+	float falloff = 1.0 - smoothstep(0.5, 1.0, length(corner));
+	color = vec4(vcolor, valpha * falloff);
+}
@@ -0,0 +1,58 @@
+#version 330
+
+// Sprite quad corner, one instance per particle
+in vec3 in_position;
+
+// Burst
+uniform vec2 origin;
+uniform float age;
+uniform uint seed;
+uniform float scale;
+
+// Effect
+uniform float lifetime;
+uniform vec2 speed;
+uniform float direction;
+uniform float spread;
+uniform float gravity;
+uniform vec2 size;
+uniform vec3 color_start;
+uniform vec3 color_end;
+uniform vec2 area;
+
+uniform mat3 projection;
+
+out vec3 vcolor;
+out float valpha;
+out vec2 corner;
+
+float hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return float(x) / 4294967295.0;
+}
+
+void main()
+{
+	uint id = uint(gl_InstanceID) * 4u + seed * 0x9e3779b9u;
+	float life = lifetime * (0.5 + 0.5 * hash(id));
+	float t = age / life;
+
+	float angle = direction + (hash(id + 1u) - 0.5) * spread;
+	float v = mix(speed.x, speed.y, hash(id + 2u)) * scale;
+	vec2 start = origin + (vec2(hash(id + 3u), hash(id + 3u ^ 0x5bd1e995u)) * 2.0 - 1.0) * area * scale;
+	vec2 pos = start + vec2(cos(angle), sin(angle)) * v * age + vec2(0, 0.5 * gravity * age * age);
+
+	float s = mix(size.x, size.y, t) * scale;
+	vec3 p = projection * vec3(pos + in_position.xy * s, 1.0);
+	// dead particles collapse behind the near plane
+	gl_Position = t < 1.0 ? vec4(p.xy, 0.0, 1.0) : vec4(0.0, 0.0, 2.0, 1.0);
+
+	vcolor = mix(color_start, color_end, t);
+	valpha = 1.0 - t;
+	corner = in_position.xy * 2.0;
+}
@@ -1,6 +1,11 @@
 #version 330
 
 uniform sampler2D screen_texture;
+// Darkening from the pause, death fade and dialogue overlays
+uniform float brightness;
+// Part of the texture the world was rendered to, see dynamic resolution
+uniform vec2 uv_scale;
+uniform vec2 uv_max;
 
 in vec2 texcoord;
 
@@ -9,5 +14,6 @@ layout(location = 0) out vec4 color;
 
 void main()
 {
-    color = texture(screen_texture, texcoord);
-}
\ No newline at end of file
+    vec2 uv = min(texcoord * uv_scale, uv_max);
+    color = vec4(texture(screen_texture, uv).rgb * brightness, 1.0);
+}
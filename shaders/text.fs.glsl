@@ -0,0 +1,14 @@
+#version 330
+
+in vec2 texcoord;
+in vec3 vcolor;
+
+// The glyph atlas
+uniform sampler2D sampler0;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	color = vec4(vcolor, 1.0) * texture(sampler0, texcoord);
+}
@@ -0,0 +1,19 @@
+#version 330
+
+// Glyph quads, already laid out in window coordinates
+in vec2 in_position;
+in vec2 in_texcoord;
+in vec3 in_color;
+
+out vec2 texcoord;
+out vec3 vcolor;
+
+uniform mat3 projection;
+
+void main()
+{
+	texcoord = in_texcoord;
+	vcolor = in_color;
+	vec3 pos = projection * vec3(in_position, 1.0);
+	gl_Position = vec4(pos.xy, 0.0, 1.0);
+}
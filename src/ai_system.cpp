@@ -1,5 +1,6 @@
 // internal
 #include "ai_system.hpp"
+#include "frame_arena.hpp"
 #include <unordered_set>
 #include <queue>
 #include <map>
@@ -74,7 +75,11 @@ vec2 find_index_from_map(vec2 pos) {
 	return pos;
 }
 
-std::list<vec2> reconstruct_path(vec2 start, std::map<std::pair<float, float>, vec2> squares, std::list<vec2>& path) {
+// The search's scratch copy of the grid, marked as squares are visited
+typedef frame_vector<frame_vector<char>> SearchGrid;
+typedef frame_map<std::pair<float, float>, vec2> SearchParents;
+
+std::list<vec2> reconstruct_path(vec2 start, const SearchParents& squares, std::list<vec2>& path) {
 	vec2 pos = start;
 
 	do {
@@ -85,10 +90,10 @@ std::list<vec2> reconstruct_path(vec2 start, std::map<std::pair<float, float>, v
 	return path;
 }
 
-std::list<vec2> bfs_follow_iter(std::vector<std::vector<char>>& vec, vec2 start, std::list<vec2>& path) {
-	std::list<vec2> buf;
+std::list<vec2> bfs_follow_iter(SearchGrid& vec, vec2 start, std::list<vec2>& path) {
+	frame_list<vec2> buf;
 	//keep track of previous square <current, parent>
-	std::map<std::pair<float, float>, vec2> squares;
+	SearchParents squares;
 	buf.emplace_back(start);
 	squares.emplace(std::make_pair(start.x, start.y), vec2(-1, -1));
 	vec2 current;
@@ -113,8 +118,11 @@ std::list<vec2> bfs_follow_iter(std::vector<std::vector<char>>& vec, vec2 start,
 	return path;
 }
 
-void bfs_follow_start(std::vector<std::vector<char>>& vec, vec2 pos_chase, vec2 pos_prey, Entity& chaser) {
+void bfs_follow_start(const std::vector<std::vector<char>>& grid, vec2 pos_chase, vec2 pos_prey, Entity& chaser) {
 	std::list<vec2> path;
+	SearchGrid vec(grid.size());
+	for (size_t x = 0; x < grid.size(); x++)
+		vec[x].assign(grid[x].begin(), grid[x].end());
 	pos_prey = find_map_index(pos_prey);
 	pos_chase = find_map_index(pos_chase);
 
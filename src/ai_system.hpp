@@ -18,7 +18,8 @@ vec2 find_map_index(vec2 pos);
 
 vec2 find_index_from_map(vec2 pos);
 
-void bfs_follow_start(std::vector<std::vector<char>>& vec, vec2 pos_chase, vec2 pos_prey, Entity& chaser);
+// Searches a copy of grid, so callers can pass the shared one
+void bfs_follow_start(const std::vector<std::vector<char>>& grid, vec2 pos_chase, vec2 pos_prey, Entity& chaser);
 
 void fill_grid(std::vector<std::vector<char>>&, vec2, vec2);
 
@@ -0,0 +1,39 @@
+// internal
+#include "animation_system.hpp"
+#include "world_system.hpp"
+
+void AnimationSystem::step(float elapsed_ms, int dialogue)
+{
+	if (dialogue != 0)
+		return;
+	loop_clock += elapsed_ms / 1000.f;
+	for (AnimationInfo& animation : registry.animated.components)
+	{
+		if (animation.oneTimeState != -1)
+			animation.oneTimer += elapsed_ms / 1000.f;
+	}
+}
+
+void AnimationSystem::update_frames()
+{
+	int loop_frame = (int)floor(loop_clock * ANIMATION_SPEED_FACTOR);
+	for (uint i = 0; i < registry.animated.components.size(); i++)
+	{
+		// the dying hold whatever frame they were on
+		if (registry.deathTimers.has(registry.animated.entities[i]))
+			continue;
+		AnimationInfo& animation = registry.animated.components[i];
+		const int* frame_counts = animation.clip->stateFrameLength;
+		if (animation.oneTimeState != -1)
+		{
+			int count = (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR);
+			if (count < frame_counts[animation.oneTimeState]) {
+				animation.frame = vec2(count, animation.oneTimeState);
+				continue;
+			}
+			animation.oneTimeState = -1;
+			animation.oneTimer = 0;
+		}
+		animation.frame = vec2(loop_frame % frame_counts[animation.curState], animation.curState);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "components.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// Advances every AnimationInfo in one pass over the container, so the
+// renderer only reads the frame picked here
+class AnimationSystem
+{
+public:
+	// Runs one-shot timers and the loop clock; both stand still during dialogue
+	void step(float elapsed_ms, int dialogue);
+	// Picks each entity's frame and ends finished one-shots. Call after the
+	// game logic, which checks for one-shots that just played their last frame.
+	void update_frames();
+
+private:
+	// seconds, shared so entities in the same state loop in step
+	double loop_clock = 0;
+};
@@ -0,0 +1,222 @@
+// Header
+#include "autosave.hpp"
+#include "profiler.hpp"
+#include "json.hpp"
+#include "logger.hpp"
+#include "heap_counter.hpp"
+
+// stlib
+#include <cstdio>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+void SaveSnapshot::clear()
+{
+	fire_enemies.clear();
+	ghouls.clear();
+	spitters.clear();
+	spitter_bullets.clear();
+	boulders.clear();
+}
+
+namespace
+{
+	json::JSON to_json(const SaveSnapshot& s)
+	{
+		json::JSON out =
+		{
+			"mute", s.mute,
+			"ddl", s.ddl,
+			"ddf", s.ddf,
+			"recorded_max_ddf", s.recorded_max_ddf,
+			"history_max_ddf", s.history_max_ddf,
+			"score", s.score,
+			"history_max_score", s.history_max_score,
+			"hp", s.hp,
+			"player_x", s.player_position.x,
+			"player_y", s.player_position.y,
+			"weapon", s.weapon,
+			"fire_enemy", json::Array(),
+			"ghoul", json::Array(),
+			"spitter", json::Array(),
+			"spitter_bullet", json::Array(),
+			"boulder", json::Array(),
+		};
+
+		for (const FireEnemySave& fe : s.fire_enemies)
+		{
+			out["fire_enemy"].append(json::JSON({
+				"hp", fe.hp,
+				"x_pos", fe.position.x,
+				"y_pos", fe.position.y,
+				"a", fe.a,
+				"b", fe.b,
+				"c", fe.c,
+				"from_right", fe.from_right,
+			}));
+		}
+
+		for (const GhoulSave& g : s.ghouls)
+		{
+			out["ghoul"].append(json::JSON({
+				"hp", g.hp,
+				"x_pos", g.position.x,
+				"y_pos", g.position.y,
+				"x_v", g.velocity.x,
+				"y_v", g.velocity.y,
+				"dir", g.dir,
+			}));
+		}
+
+		for (const SpitterSave& sp : s.spitters)
+		{
+			out["spitter"].append(json::JSON({
+				"hp", sp.hp,
+				"x_pos", sp.position.x,
+				"y_pos", sp.position.y,
+				"x_v", sp.velocity.x,
+				"y_v", sp.velocity.y,
+				"dir", sp.dir,
+				"timer", sp.timer,
+				"shootable", sp.shootable,
+				"right_x", sp.right_x,
+				"left_x", sp.left_x,
+			}));
+		}
+
+		for (const SpitterBulletSave& sb : s.spitter_bullets)
+		{
+			out["spitter_bullet"].append(json::JSON({
+				"x_pos", sb.position.x,
+				"y_pos", sb.position.y,
+				"x_v", sb.velocity.x,
+				"y_v", sb.velocity.y,
+				"scale_x", sb.scale.x,
+				"scale_y", sb.scale.y,
+				"angle", sb.angle,
+				"mass", sb.mass,
+			}));
+		}
+
+		for (const BoulderSave& b : s.boulders)
+		{
+			out["boulder"].append(json::JSON({
+				"x_pos", b.position.x,
+				"y_pos", b.position.y,
+				"x_v", b.velocity.x,
+				"y_v", b.velocity.y,
+				"scale_x", b.scale.x,
+				"scale_y", b.scale.y,
+				"angle", b.angle,
+				"hitting", b.hitting,
+			}));
+		}
+
+		return out;
+	}
+}
+
+bool write_snapshot(const SaveSnapshot& snapshot, const std::string& path)
+{
+	HEAP_TAG_SCOPE(SAVE);
+	std::string text = to_json(snapshot).dump();
+	std::string tmp_path = path + ".tmp";
+
+	FILE* file = fopen(tmp_path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		LOG_ERROR(GAME, "Failed to open %s for writing", tmp_path.c_str());
+		return false;
+	}
+	bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+	ok = ok && fflush(file) == 0;
+#ifdef _WIN32
+	ok = ok && _commit(_fileno(file)) == 0;
+#else
+	ok = ok && fsync(fileno(file)) == 0;
+#endif
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+	{
+		LOG_ERROR(GAME, "Failed to write %s", tmp_path.c_str());
+		remove(tmp_path.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	ok = MoveFileExA(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	ok = rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+	if (!ok)
+		LOG_ERROR(GAME, "Failed to replace %s", path.c_str());
+	return ok;
+}
+
+void AutosaveService::start(const std::string& path)
+{
+	if (running)
+		return;
+	save_path = path;
+	running = true;
+	worker = std::thread(&AutosaveService::run, this);
+}
+
+void AutosaveService::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running)
+			return;
+		running = false;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+void AutosaveService::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return !running || (!has_pending && !writing); });
+}
+
+void AutosaveService::submit()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(back, pending);
+		has_pending = true;
+	}
+	wake.notify_one();
+}
+
+void AutosaveService::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this]() { return has_pending || !running; });
+		if (!has_pending)
+			break;
+
+		std::swap(pending, front);
+		has_pending = false;
+		writing = true;
+		lock.unlock();
+
+		{
+			ScopedTimer timer("autosave write");
+			write_snapshot(front, save_path);
+		}
+
+		lock.lock();
+		writing = false;
+		idle.notify_all();
+	}
+	idle.notify_all();
+}
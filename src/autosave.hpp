@@ -0,0 +1,120 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Plain copies of the saveable components. Captured on the game thread at a
+// tick boundary, serialised on the autosave thread, so nothing here may point
+// back into the registry.
+struct FireEnemySave
+{
+	int hp;
+	vec2 position;
+	float a, b, c;
+	bool from_right;
+};
+
+struct GhoulSave
+{
+	int hp;
+	vec2 position;
+	vec2 velocity;
+	int dir;
+};
+
+struct SpitterSave
+{
+	int hp;
+	vec2 position;
+	vec2 velocity;
+	int dir;
+	float timer;
+	bool shootable;
+	float left_x, right_x;
+};
+
+struct SpitterBulletSave
+{
+	vec2 position;
+	vec2 velocity;
+	vec2 scale;
+	float angle;
+	float mass;
+};
+
+struct BoulderSave
+{
+	vec2 position;
+	vec2 velocity;
+	vec2 scale;
+	float angle;
+	bool hitting;
+};
+
+struct SaveSnapshot
+{
+	bool mute = false;
+	int ddl = 0;
+	float ddf = 0.f;
+	float recorded_max_ddf = 0.f;
+	float history_max_ddf = 0.f;
+	int score = 0;
+	int history_max_score = 0;
+	int hp = 0;
+	vec2 player_position = { 0.f, 0.f };
+	int weapon = -1;
+	std::vector<FireEnemySave> fire_enemies;
+	std::vector<GhoulSave> ghouls;
+	std::vector<SpitterSave> spitters;
+	std::vector<SpitterBulletSave> spitter_bullets;
+	std::vector<BoulderSave> boulders;
+
+	// empties the lists but keeps their capacity for the next capture
+	void clear();
+};
+
+// Serialises the snapshot and replaces path with it: written to path.tmp,
+// fsync'ed, then renamed over the old save so a crash never leaves half a file.
+bool write_snapshot(const SaveSnapshot& snapshot, const std::string& path);
+
+// Double-buffered background writer. The game thread fills back_buffer() and
+// calls submit(), which swaps it with the pending slot; the worker thread swaps
+// the pending slot into its own buffer and writes it out. Submitting while a
+// write is still queued simply replaces the queued snapshot.
+class AutosaveService
+{
+public:
+	void start(const std::string& path);
+	// writes whatever is still pending, then joins the worker
+	void stop();
+	// blocks until no snapshot is queued or being written
+	void flush();
+
+	SaveSnapshot& back_buffer() { return back; }
+	void submit();
+
+	~AutosaveService() { stop(); }
+
+private:
+	void run();
+
+	std::string save_path;
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	bool running = false;
+	bool has_pending = false;
+	bool writing = false;
+
+	SaveSnapshot back;     // game thread only
+	SaveSnapshot pending;  // guarded by mutex
+	SaveSnapshot front;    // worker thread only
+};
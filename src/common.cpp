@@ -1,4 +1,5 @@
 #include "common.hpp"
+#include "logger.hpp"
 
 // Note, we could also use the functions from GLM but we write the transformations here to show the uderlying math
 void Transform::scale(vec2 scale)
@@ -49,7 +50,7 @@ bool gl_has_errors()
 			break;
 		}
 
-		fprintf(stderr, "OpenGL: %s", error_str);
+		LOG_ERROR(RENDER, "OpenGL: %s", error_str);
 		error = glGetError();
 		assert(false);
 	}
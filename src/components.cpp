@@ -1,5 +1,6 @@
 #include "components.hpp"
 #include "render_system.hpp" // for gl_has_errors
+#include "logger.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../ext/stb_image/stb_image.h"
@@ -20,7 +21,7 @@ bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out
 #pragma warning(disable:4996)
 #endif
 
-	printf("Loading OBJ file %s...\n", obj_path.c_str());
+	LOG_INFO(RENDER, "Loading OBJ file %s...", obj_path.c_str());
 	// Note, normal and UV indices are not loaded/used, but code is commented to do so
 	std::vector<uint16_t> out_uv_indices, out_normal_indices;
 	std::vector<glm::vec2> out_uvs;
@@ -28,7 +29,7 @@ bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out
 
 	FILE* file = fopen(obj_path.c_str(), "r");
 	if (file == NULL) {
-		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		LOG_ERROR(RENDER, "Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details");
 		getchar();
 		return false;
 	}
@@ -73,7 +74,7 @@ bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out
 					matches = fscanf(file, "%d/%d %d/%d/%d %d/%d/%d\n", &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
 					if (matches != 8)
 					{
-						printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+						LOG_ERROR(RENDER, "File can't be read by our simple parser :-( Try exporting with other options");
 						fclose(file);
 						return false;
 					}
@@ -122,11 +123,11 @@ bool CollisionMesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVer
 #pragma warning(disable:4996)
 #endif
 
-	printf("Loading OBJ file %s...\n", obj_path.c_str());
+	LOG_INFO(RENDER, "Loading OBJ file %s...", obj_path.c_str());
 
 	FILE* file = fopen(obj_path.c_str(), "r");
 	if (file == NULL) {
-		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		LOG_ERROR(RENDER, "Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details");
 		getchar();
 		return false;
 	}
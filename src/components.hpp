@@ -79,10 +79,16 @@ struct Block
 {
 };
 
+// The whole scrolling backdrop, drawn by the renderer in one full-screen pass
 struct ParallaxBackground
 {
-	// where to reset entity to once it reaches end of screen
-	vec2 resetPosition;
+	// clock the layers scroll with, stopped while paused
+	float scroll_ms = 0.f;
+};
+
+// Deadly floor along the bottom of the screen, its sprite is part of the parallax
+struct Lava
+{
 };
 
 struct Enemies
@@ -170,7 +176,8 @@ struct Rocket {
 struct GrenadeLauncher {
 	float cooldown = 0;
 	bool loaded = true;
-	std::vector<Entity> trajectory;
+	// aim the trajectory Polyline on the launcher was sampled for
+	vec2 trajectory_velocity = { 0.f, 0.f };
 };
 
 struct Grenade {
@@ -206,7 +213,16 @@ struct WaterBall {
 	float start_length;
 	float t = 0;
 	uint curve_num = 0;
-	std::vector<Entity> trajectory;
+};
+
+// Thick line through points (relative to origin), e.g. an aiming trajectory.
+// All polylines share one streamed vertex buffer and each is a single draw call
+struct Polyline
+{
+	std::vector<vec2> points;
+	vec2 origin = { 0.f, 0.f };
+	float width = 3.f;
+	vec3 color = { 1.f, 0.f, 0.f };
 };
 
 // Weapon the player has picked up
@@ -316,14 +332,30 @@ struct TexturedVertex
 	vec2 texcoord;
 };
 
-struct AnimationInfo
+// Layout of an animated sprite sheet, one row per state with its own frame
+// count. Read-only and shared by every entity that plays it.
+const int MAX_ANIMATION_STATES = 13;
+struct AnimationClip
 {
 	int states;
-	std::vector<int> stateFrameLength;
-	int curState;
+	int stateFrameLength[MAX_ANIMATION_STATES];
+	int initialState;
 	int stateCycleLength;
-    int oneTimeState = -1;
-	double oneTimer;
+};
+
+// Per entity playback of a shared clip: curState loops, oneTimeState plays
+// once over it. AnimationSystem advances it and picks the frame to draw.
+struct AnimationInfo
+{
+	const AnimationClip* clip = nullptr;
+	int curState = 0;
+	int oneTimeState = -1;
+	double oneTimer = 0;
+	// sprite sheet cell to draw, (column, row)
+	vec2 frame = { 0.f, 0.f };
+
+	AnimationInfo() = default;
+	AnimationInfo(const AnimationClip& animation_clip) : clip(&animation_clip), curState(animation_clip.initialState) {}
 };
 
 struct ShowWhenPaused {
@@ -501,15 +533,16 @@ enum class EFFECT_ASSET_ID
 	SPITTER_ENEMY = GHOUL + 1,
 	SPITTER_ENEMY_BULLET = SPITTER_ENEMY + 1,
 	FOLLOWING_ENEMY = SPITTER_ENEMY_BULLET + 1,
-    SCREEN_LAYER = FOLLOWING_ENEMY + 1,
-	LAVA_PILLAR = SCREEN_LAYER + 1,
+	LAVA_PILLAR = FOLLOWING_ENEMY + 1,
     BOSS = LAVA_PILLAR + 1,
 	BOSS_SWORD_S = BOSS + 1,
 	BOSS_SWORD_L = BOSS_SWORD_S + 1,
     HEALTH_BAR = BOSS_SWORD_L + 1,
-	DIALOGUE_LAYER = HEALTH_BAR + 1,
-	GRENADE_ORB = DIALOGUE_LAYER + 1,
-	EFFECT_COUNT = GRENADE_ORB + 1,
+	GRENADE_ORB = HEALTH_BAR + 1,
+	PARTICLE = GRENADE_ORB + 1,
+	PARALLAX = PARTICLE + 1,
+	TEXT = PARALLAX + 1,
+	EFFECT_COUNT = TEXT + 1,
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
@@ -524,6 +557,16 @@ enum class GEOMETRY_BUFFER_ID
 };
 const int geometry_count = (int)GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
+enum class FONT
+{
+	// built in 5x7 pixel font, printable ASCII
+	DEBUG = 0,
+	// the score digits, 0-9 only
+	SCORE = DEBUG + 1,
+	FONT_COUNT = SCORE + 1
+};
+const int font_count = (int)FONT::FONT_COUNT;
+
 struct RenderRequest
 {
 	TEXTURE_ASSET_ID used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
@@ -534,3 +577,25 @@ struct RenderRequest
     vec2 scale = {1,1};
     vec2 offset = {0,0};
 };
+
+// A string drawn through the glyph atlas at the entity's motion position (its
+// top left corner, or top right if right_aligned). All text is one batch that
+// is only rebuilt when something changed, so change the string with set_text.
+struct Text
+{
+	std::string text;
+	FONT font = FONT::DEBUG;
+	float height = 16.f;
+	vec3 color = { 1.f, 1.f, 1.f };
+	bool right_aligned = false;
+	bool visibility = true;
+	bool dirty = true;
+};
+
+inline void set_text(Text& text, const std::string& value)
+{
+	if (text.text == value)
+		return;
+	text.text = value;
+	text.dirty = true;
+}
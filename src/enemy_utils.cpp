@@ -5,91 +5,45 @@
 
 #include "enemy_utils.hpp"
 #include "physics_system.hpp"
+#include "logger.hpp"
+#include "projectile_pool.hpp"
 
 
 static std::default_random_engine rng = std::default_random_engine(std::random_device()());
 static std::uniform_real_distribution<float> uniform_dist;
 
-void do_enemy_spawn(float elapsed_ms, RenderSystem* renderer, int ddl) {
-    adjust_difficulty(ddl);
-    next_enemy_spawn -= elapsed_ms * (5.f/(registry.enemies.components.size()+1)+0.5);
-    printf("%f \n", next_enemy_spawn);
-    if (next_enemy_spawn > 0.f) {
-        return;
-    }
-
-    size_t spawns[ENEMY_COUNT] = {
+void do_enemy_spawn(float elapsed_ms, RenderSystem* renderer, SpawnDirector& director, int ddl) {
+    director.set_level(ddl);
+    size_t alive[ENEMY_COUNT] = {
             registry.fireEnemies.components.size(),
             registry.ghouls.components.size(),
             registry.spitterEnemies.components.size(),
             registry.boulders.components.size()
     };
+    director.step(elapsed_ms, registry.enemies.components.size(), alive);
 
-    float random = uniform_dist(rng);
-    int selectedEnemy = 0;
-    while (selectedEnemy < ENEMY_COUNT) {
-        if (spawn_prob[selectedEnemy] >= random && spawns[selectedEnemy] < max_spawns[selectedEnemy]) {
-            break;
-        }
-        selectedEnemy++;
-    }
-    switch (SpawnableEnemyType(selectedEnemy)) {
-        case FIRELINGS: {
-            summon_fireling_helper(renderer);
-            break;
-        }
-        case GHOULS: {
-            createGhoul(renderer, getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY)));
-            break;
-        }
-        case SPITTERS: {
-            createSpitterEnemy(renderer, getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY)));
-            break;
-        }
-        case BOULDERS: {
-            summon_boulder_helper(renderer);
-            break;
+    SpawnableEnemyType type;
+    while (director.next_spawn(type)) {
+        switch (type) {
+            case FIRELINGS: {
+                summon_fireling_helper(renderer);
+                break;
+            }
+            case GHOULS: {
+                createGhoul(renderer, getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY)));
+                break;
+            }
+            case SPITTERS: {
+                createSpitterEnemy(renderer, getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY)));
+                break;
+            }
+            case BOULDERS: {
+                summon_boulder_helper(renderer);
+                break;
+            }
+            case ENEMY_COUNT:
+                break;
         }
-        case ENEMY_COUNT:
-            break;
-    }
-    next_enemy_spawn = (spawn_delay * spawn_delay_variance) + uniform_dist(rng) * (spawn_delay * (1-spawn_delay_variance));
-}
-
-void adjust_difficulty(int ddl){
-    switch (ddl) {
-        case 0:
-            max_spawns = {8, 3, 0, 0};
-            spawn_prob = {.7, 1, 1, 1};
-            spawn_delay = 6000;
-            break;
-        case 1:
-            spitter_projectile_delay_ms = 5000.f;
-            max_spawns = {10, 5, 2, 0};
-            spawn_prob = {.5, .85, 1, 1};
-            spawn_delay = 5000;
-            break;
-        case 2:
-            spitter_projectile_delay_ms = 3500.f;
-            max_spawns = {12, 6, 3, 1};
-            spawn_prob = {.4, .8, .95, 1};
-            spawn_delay = 4000;
-            break;
-        case 3:
-            spitter_projectile_delay_ms = 3000.f;
-            max_spawns = {15, 4, 3, 2};
-            spawn_prob = {.4, .6, .85, 1};
-            spawn_delay = 3500;
-            break;
-        case 4:
-            max_spawns = {0, 0, 0, 0};
-            break;
-        default:
-            spitter_projectile_delay_ms = 2500.f;
-            max_spawns = {18, 7, 5, 3};
-            spawn_prob = {.3, .6, .8, 1};
-            spawn_delay = 3000;
-            break;
     }
 }
 
@@ -196,8 +150,7 @@ void move_tracer(float elapsed_ms_since_last_update, Entity player_hero)
             //enemy_reg.hittable = true;
 
             if (enemy_reg.path.size() == 0 && find_map_index(enemy_motion.position) != find_map_index(hero_motion.position)) {
-                std::vector<std::vector<char>> vec = grid_vec;
-                bfs_follow_start(vec, enemy_motion.position, hero_motion.position, enemy);
+                bfs_follow_start(grid_vec, enemy_motion.position, hero_motion.position, enemy);
             }
 
             //Don't blink when not moving: next pos in path is same pos as current
@@ -231,7 +184,7 @@ void move_tracer(float elapsed_ms_since_last_update, Entity player_hero)
     }
 }
 
-void move_spitters(float elapsed_ms_since_last_update, RenderSystem* renderer) {
+void move_spitters(float elapsed_ms_since_last_update, RenderSystem* renderer, float shot_delay_ms) {
     const uint SHOOT_STATE = 2;
     const uint SPITTER_FIRE_FRAME = 4;
     const uint WALKING_TIME = 5;
@@ -294,13 +247,13 @@ void move_spitters(float elapsed_ms_since_last_update, RenderSystem* renderer) {
             animation.oneTimer = 0;
             spitterEnemy.canShoot = true;
             // create bullet at same position as enemy
-            spitterEnemy.timeUntilNextShotMs = spitter_projectile_delay_ms;
+            spitterEnemy.timeUntilNextShotMs = shot_delay_ms;
         }
     }
 
-    // decay spitter bullets
+    // decay spitter bullets, back to front as releasing one moves the last into its slot
     auto& spitterBullets_container = registry.spitterBullets;
-    for (uint i = 0; i < spitterBullets_container.size(); i++)
+    for (int i = (int)spitterBullets_container.size() - 1; i >= 0; i--)
     {
         SpitterBullet& spitterBullet = spitterBullets_container.components[i];
         Entity entity = spitterBullets_container.entities[i];
@@ -314,7 +267,7 @@ void move_spitters(float elapsed_ms_since_last_update, RenderSystem* renderer) {
         if (spitterBullet.mass <= SPITTER_PROJECTILE_MIN_SIZE)
         {
             spitterBullet.mass = 0;
-            registry.remove_all_components_of(entity);
+            projectile_pool.release(entity);
         }
     }
 }
@@ -338,7 +291,7 @@ void boss_action_decision(Entity player_hero, Entity boss, RenderSystem* rendere
 
     switch (boss_state.state) {
         case BOSS_STATE::TELEPORT:
-            boss_action_teleport(boss);
+            boss_action_teleport(boss, renderer);
             break;
         case BOSS_STATE::SWIPE:
             boss_action_swipe(boss);
@@ -377,7 +330,7 @@ std::vector<int> teleport_unique(vec2 pos) {
     }
     return ret;
 }
-void boss_action_teleport(Entity boss){
+void boss_action_teleport(Entity boss, RenderSystem* renderer){
     const int PHASE_OUT = 8;
     const int PHASE_IN = 9;
     Motion& motion = registry.motions.get(boss);
@@ -386,7 +339,8 @@ void boss_action_teleport(Entity boss){
     Boss& boss_state = registry.boss.get(boss);
     Enemies& enemy_info = registry.enemies.get(boss);
     if (boss_state.phase == 0) {
-        play_sound(SOUND_EFFECT::TELEPORT);
+        play_sound(SOUND_EFFECT::TELEPORT, motion.position);
+        renderer->getParticles().emit(PARTICLE_EFFECT::TELEPORT, motion.position, 1.5f);
         enemy_info.hitting = false;
         enemy_info.hittable = false;
         info.oneTimeState = PHASE_OUT;
@@ -395,6 +349,7 @@ void boss_action_teleport(Entity boss){
         motion.position = getRandomWalkablePos(motion.scale, boss_platforms[rand() % boss_platforms.size()], false);
         boss_state.phase++;
     } else if(boss_state.phase == 2) {
+        renderer->getParticles().emit(PARTICLE_EFFECT::TELEPORT, motion.position, 1.5f);
         enemy_info.hittable = true;
         info.oneTimeState = PHASE_IN;
         boss_state.phase++;
@@ -411,7 +366,7 @@ void boss_action_swipe(Entity boss){
     Boss& boss_state = registry.boss.get(boss);
     AnimationInfo& info = registry.animated.get(boss);
     if (boss_state.phase == 0) {
-        play_sound(SOUND_EFFECT::BOSS_SLASH);
+        play_sound(SOUND_EFFECT::BOSS_SLASH, registry.motions.get(boss).position);
         info.oneTimeState = SWIPE;
         registry.motions.get(boss_state.hurt_boxes[0]).position = registry.motions.get(boss).position + vec2(0,55);
         registry.motions.get(boss_state.hurt_boxes[1]).position = registry.motions.get(boss).position + vec2(0,15);
@@ -443,28 +398,31 @@ void boss_action_summon(Entity boss, RenderSystem* renderer, uint type){
     AnimationInfo& info = registry.animated.get(boss);
     Boss& boss_state = registry.boss.get(boss);
     if (boss_state.phase == 0) {
-        play_sound(SOUND_EFFECT::BOSS_SUMMON);
+        play_sound(SOUND_EFFECT::BOSS_SUMMON, registry.motions.get(boss).position);
         info.oneTimeState = SUMMON;
         boss_state.phase++;
     } else if(boss_state.phase == 1 && info.oneTimeState == -1) {
         info.oneTimeState = STAND_UP;
         switch (type) {
-            case 0:
-                for(int i = 0; i < 3 + rand() % 4; i++) {
-                    createGhoul(renderer, getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY)));
-                }
+            case 0: {
+                std::vector<vec2> positions(3 + rand() % 4);
+                for (vec2& position : positions)
+                    position = getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY));
+                createGhouls(renderer, positions);
                 break;
-            case 1:
-                for(int i = 0; i < 1 + rand() % 3; i++) {
-                    createSpitterEnemy(renderer, getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY)));
-                }
+            }
+            case 1: {
+                std::vector<vec2> positions(1 + rand() % 3);
+                for (vec2& position : positions)
+                    position = getRandomWalkablePos(ASSET_SIZE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY));
+                createSpitterEnemies(renderer, positions);
                 break;
-            case 2:
-                for(int i = 0; i < 10 + rand() % 6; i++) {
-                    Motion& motion = registry.motions.get(boss);
-                    createSpitterEnemyBullet(renderer, motion.position, motion.angle);
-                }
+            }
+            case 2: {
+                Motion& motion = registry.motions.get(boss);
+                createSpitterEnemyBullets(renderer, motion.position, motion.angle, 10 + rand() % 6);
                 break;
+            }
         }
         boss_state.phase++;
     } else if(boss_state.phase == 2 && info.oneTimeState == -1) {
@@ -517,9 +475,12 @@ BOSS_STATE get_action(Entity player_hero, Entity boss, RenderSystem* renderer) {
     uint num_spitters = registry.spitterEnemies.entities.size();
     BOSS_STATE action;
     float max_utility = 0;
+    // the search copies these at every level, so keep them on the frame arena
+    const std::vector<float>& boss_cooldowns = registry.boss.components[0].cooldowns;
+    frame_vector<float> cooldowns(boss_cooldowns.begin(), boss_cooldowns.end());
     for (uint i = 0; i < (uint) BOSS_STATE::SIZE; i++) {
-        if (registry.boss.components[0].cooldowns[i] <= 0) {
-            float utility = get_action_reward((BOSS_STATE) i, boss_pos, num_ghouls, num_spitters, 0, registry.boss.components[0].cooldowns, player_hero, boss, renderer);
+        if (cooldowns[i] <= 0) {
+            float utility = get_action_reward((BOSS_STATE) i, boss_pos, num_ghouls, num_spitters, 0, cooldowns, player_hero, boss, renderer);
             if (utility > max_utility) {
                 max_utility = utility;
                 action = (BOSS_STATE) i;
@@ -537,7 +498,7 @@ BOSS_STATE get_action(Entity player_hero, Entity boss, RenderSystem* renderer) {
 
 
 
-float mdp_helper(vec2 boss_pos, uint num_ghouls, uint num_spitters, uint step_num, std::vector<float> cooldowns, Entity player_hero, Entity boss, RenderSystem* renderer) {
+float mdp_helper(vec2 boss_pos, uint num_ghouls, uint num_spitters, uint step_num, frame_vector<float> cooldowns, Entity player_hero, Entity boss, RenderSystem* renderer) {
     float max_utility = 0;
     if (step_num <= MDP_HORIZON) {
         for (uint i = 0; i < (uint) BOSS_STATE::SIZE; i++) {
@@ -552,7 +513,7 @@ float mdp_helper(vec2 boss_pos, uint num_ghouls, uint num_spitters, uint step_nu
     return max_utility;
 }
 
-float get_action_reward(BOSS_STATE action, vec2 boss_pos, uint num_ghouls, uint num_spitters, uint step_num, std::vector<float> cooldowns, Entity player_hero, Entity boss, RenderSystem* renderer) {
+float get_action_reward(BOSS_STATE action, vec2 boss_pos, uint num_ghouls, uint num_spitters, uint step_num, frame_vector<float> cooldowns, Entity player_hero, Entity boss, RenderSystem* renderer) {
     cooldowns[(uint) action] = BOSS_ACTION_COOLDOWNS[(uint) action];
     for (float& cd: cooldowns)
         if (cd > 0)
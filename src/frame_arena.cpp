@@ -0,0 +1,67 @@
+// Header
+#include "frame_arena.hpp"
+
+// stlib
+#include <cstdint>
+#include <new>
+
+namespace
+{
+	const size_t FRAME_ARENA_CAPACITY = 256 * 1024;
+}
+
+FrameArena::FrameArena(size_t capacity)
+	: block(static_cast<char*>(::operator new(capacity))), block_size(capacity)
+{
+	// room for a busy tick's overflow without growing in the middle of it
+	overflow.reserve(64);
+}
+
+FrameArena::~FrameArena()
+{
+	reset();
+	::operator delete(block);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	uintptr_t base = reinterpret_cast<uintptr_t>(block);
+	uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	size_t end = (size_t)(aligned - base) + size;
+	if (end <= block_size)
+	{
+		offset = end;
+		return reinterpret_cast<void*>(aligned);
+	}
+	// operator new is aligned for any fundamental type
+	void* spill = ::operator new(size);
+	overflow.push_back(spill);
+	overflow_bytes += size + alignment;
+	return spill;
+}
+
+bool FrameArena::reset()
+{
+	size_t needed = used();
+	for (void* spill : overflow)
+		::operator delete(spill);
+	overflow.clear();
+	overflow_bytes = 0;
+	offset = 0;
+	if (needed <= block_size)
+		return false;
+
+	size_t grown = block_size;
+	while (grown < needed)
+		grown *= 2;
+	::operator delete(block);
+	block = static_cast<char*>(::operator new(grown));
+	block_size = grown;
+	return true;
+}
+
+FrameArena& frame_arena()
+{
+	static FrameArena arena(FRAME_ARENA_CAPACITY);
+	return arena;
+}
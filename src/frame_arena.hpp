@@ -0,0 +1,65 @@
+#pragma once
+
+// stlib
+#include <cstddef>
+#include <list>
+#include <map>
+#include <vector>
+
+// Bump allocator for temporaries that live no longer than one tick of the
+// main loop. Freeing is a no-op, reset() at the end of the tick takes back
+// everything at once. When a tick needs more than the block holds the rest
+// comes from the heap, and the next reset grows the block to fit, so a
+// steady game settles at one block and no heap traffic. Main thread only.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t capacity);
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* allocate(size_t size, size_t alignment);
+	// true when this tick overflowed and the block was grown
+	bool reset();
+
+	size_t capacity() const { return block_size; }
+	// bytes handed out this tick, overflow included
+	size_t used() const { return offset + overflow_bytes; }
+
+private:
+	char* block;
+	size_t block_size;
+	size_t offset = 0;
+	std::vector<void*> overflow;
+	size_t overflow_bytes = 0;
+};
+
+// The main loop's arena, reset once per tick
+FrameArena& frame_arena();
+
+// STL allocator on frame_arena(); containers using it must not outlive the tick
+template <typename T>
+struct FrameAllocator
+{
+	using value_type = T;
+
+	FrameAllocator() = default;
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>&) {}
+
+	T* allocate(size_t n) { return static_cast<T*>(frame_arena().allocate(n * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using frame_vector = std::vector<T, FrameAllocator<T>>;
+template <typename T>
+using frame_list = std::list<T, FrameAllocator<T>>;
+template <typename K, typename V, typename Compare = std::less<K>>
+using frame_map = std::map<K, V, Compare, FrameAllocator<std::pair<const K, V>>>;
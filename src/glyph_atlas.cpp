@@ -0,0 +1,230 @@
+// Header
+#include "glyph_atlas.hpp"
+#include "logger.hpp"
+
+// stlib
+#include <cstdio>
+
+namespace
+{
+	const ivec2 ATLAS_SIZE = { 512, 128 };
+
+	// Debug font: 5x7 glyphs in 6x8 cells (a column and a row of spacing),
+	// 16 to a row starting at ' '
+	const ivec2 DEBUG_CELL = { 6, 8 };
+	const int DEBUG_COLUMNS = 16;
+	const char DEBUG_FIRST = ' ';
+	const char DEBUG_LAST = '~';
+
+	// Score digits, one cell each below the debug font
+	const ivec2 SCORE_CELL = { 32, 48 };
+	const int SCORE_ROW_Y = 64;
+
+	// One byte per column, least significant bit at the top
+	const unsigned char DEBUG_GLYPHS[][5] = {
+		{ 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+		{ 0x00, 0x00, 0x5F, 0x00, 0x00 }, // !
+		{ 0x00, 0x07, 0x00, 0x07, 0x00 }, // "
+		{ 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // #
+		{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, // $
+		{ 0x23, 0x13, 0x08, 0x64, 0x62 }, // %
+		{ 0x36, 0x49, 0x55, 0x22, 0x50 }, // &
+		{ 0x00, 0x05, 0x03, 0x00, 0x00 }, // '
+		{ 0x00, 0x1C, 0x22, 0x41, 0x00 }, // (
+		{ 0x00, 0x41, 0x22, 0x1C, 0x00 }, // )
+		{ 0x14, 0x08, 0x3E, 0x08, 0x14 }, // *
+		{ 0x08, 0x08, 0x3E, 0x08, 0x08 }, // +
+		{ 0x00, 0x50, 0x30, 0x00, 0x00 }, // ,
+		{ 0x08, 0x08, 0x08, 0x08, 0x08 }, // -
+		{ 0x00, 0x60, 0x60, 0x00, 0x00 }, // .
+		{ 0x20, 0x10, 0x08, 0x04, 0x02 }, // /
+		{ 0x3E, 0x51, 0x49, 0x45, 0x3E }, // 0
+		{ 0x00, 0x42, 0x7F, 0x40, 0x00 }, // 1
+		{ 0x42, 0x61, 0x51, 0x49, 0x46 }, // 2
+		{ 0x21, 0x41, 0x45, 0x4B, 0x31 }, // 3
+		{ 0x18, 0x14, 0x12, 0x7F, 0x10 }, // 4
+		{ 0x27, 0x45, 0x45, 0x45, 0x39 }, // 5
+		{ 0x3C, 0x4A, 0x49, 0x49, 0x30 }, // 6
+		{ 0x01, 0x71, 0x09, 0x05, 0x03 }, // 7
+		{ 0x36, 0x49, 0x49, 0x49, 0x36 }, // 8
+		{ 0x06, 0x49, 0x49, 0x29, 0x1E }, // 9
+		{ 0x00, 0x36, 0x36, 0x00, 0x00 }, // :
+		{ 0x00, 0x56, 0x36, 0x00, 0x00 }, // ;
+		{ 0x08, 0x14, 0x22, 0x41, 0x00 }, // <
+		{ 0x14, 0x14, 0x14, 0x14, 0x14 }, // =
+		{ 0x00, 0x41, 0x22, 0x14, 0x08 }, // >
+		{ 0x02, 0x01, 0x51, 0x09, 0x06 }, // ?
+		{ 0x32, 0x49, 0x79, 0x41, 0x3E }, // @
+		{ 0x7E, 0x11, 0x11, 0x11, 0x7E }, // A
+		{ 0x7F, 0x49, 0x49, 0x49, 0x36 }, // B
+		{ 0x3E, 0x41, 0x41, 0x41, 0x22 }, // C
+		{ 0x7F, 0x41, 0x41, 0x22, 0x1C }, // D
+		{ 0x7F, 0x49, 0x49, 0x49, 0x41 }, // E
+		{ 0x7F, 0x09, 0x09, 0x09, 0x01 }, // F
+		{ 0x3E, 0x41, 0x49, 0x49, 0x7A }, // G
+		{ 0x7F, 0x08, 0x08, 0x08, 0x7F }, // H
+		{ 0x00, 0x41, 0x7F, 0x41, 0x00 }, // I
+		{ 0x20, 0x40, 0x41, 0x3F, 0x01 }, // J
+		{ 0x7F, 0x08, 0x14, 0x22, 0x41 }, // K
+		{ 0x7F, 0x40, 0x40, 0x40, 0x40 }, // L
+		{ 0x7F, 0x02, 0x0C, 0x02, 0x7F }, // M
+		{ 0x7F, 0x04, 0x08, 0x10, 0x7F }, // N
+		{ 0x3E, 0x41, 0x41, 0x41, 0x3E }, // O
+		{ 0x7F, 0x09, 0x09, 0x09, 0x06 }, // P
+		{ 0x3E, 0x41, 0x51, 0x21, 0x5E }, // Q
+		{ 0x7F, 0x09, 0x19, 0x29, 0x46 }, // R
+		{ 0x46, 0x49, 0x49, 0x49, 0x31 }, // S
+		{ 0x01, 0x01, 0x7F, 0x01, 0x01 }, // T
+		{ 0x3F, 0x40, 0x40, 0x40, 0x3F }, // U
+		{ 0x1F, 0x20, 0x40, 0x20, 0x1F }, // V
+		{ 0x3F, 0x40, 0x38, 0x40, 0x3F }, // W
+		{ 0x63, 0x14, 0x08, 0x14, 0x63 }, // X
+		{ 0x07, 0x08, 0x70, 0x08, 0x07 }, // Y
+		{ 0x61, 0x51, 0x49, 0x45, 0x43 }, // Z
+		{ 0x00, 0x7F, 0x41, 0x41, 0x00 }, // [
+		{ 0x02, 0x04, 0x08, 0x10, 0x20 }, // '\'
+		{ 0x00, 0x41, 0x41, 0x7F, 0x00 }, // ]
+		{ 0x04, 0x02, 0x01, 0x02, 0x04 }, // ^
+		{ 0x40, 0x40, 0x40, 0x40, 0x40 }, // _
+		{ 0x00, 0x01, 0x02, 0x04, 0x00 }, // `
+		{ 0x20, 0x54, 0x54, 0x54, 0x78 }, // a
+		{ 0x7F, 0x48, 0x44, 0x44, 0x38 }, // b
+		{ 0x38, 0x44, 0x44, 0x44, 0x20 }, // c
+		{ 0x38, 0x44, 0x44, 0x48, 0x7F }, // d
+		{ 0x38, 0x54, 0x54, 0x54, 0x18 }, // e
+		{ 0x08, 0x7E, 0x09, 0x01, 0x02 }, // f
+		{ 0x0C, 0x52, 0x52, 0x52, 0x3E }, // g
+		{ 0x7F, 0x08, 0x04, 0x04, 0x78 }, // h
+		{ 0x00, 0x44, 0x7D, 0x40, 0x00 }, // i
+		{ 0x20, 0x40, 0x44, 0x3D, 0x00 }, // j
+		{ 0x7F, 0x10, 0x28, 0x44, 0x00 }, // k
+		{ 0x00, 0x41, 0x7F, 0x40, 0x00 }, // l
+		{ 0x7C, 0x04, 0x18, 0x04, 0x78 }, // m
+		{ 0x7C, 0x08, 0x04, 0x04, 0x78 }, // n
+		{ 0x38, 0x44, 0x44, 0x44, 0x38 }, // o
+		{ 0x7C, 0x14, 0x14, 0x14, 0x08 }, // p
+		{ 0x08, 0x14, 0x14, 0x18, 0x7C }, // q
+		{ 0x7C, 0x08, 0x04, 0x04, 0x08 }, // r
+		{ 0x48, 0x54, 0x54, 0x54, 0x20 }, // s
+		{ 0x04, 0x3F, 0x44, 0x40, 0x20 }, // t
+		{ 0x3C, 0x40, 0x40, 0x20, 0x7C }, // u
+		{ 0x1C, 0x20, 0x40, 0x20, 0x1C }, // v
+		{ 0x3C, 0x40, 0x30, 0x40, 0x3C }, // w
+		{ 0x44, 0x28, 0x10, 0x28, 0x44 }, // x
+		{ 0x0C, 0x50, 0x50, 0x50, 0x3C }, // y
+		{ 0x44, 0x64, 0x54, 0x4C, 0x44 }, // z
+		{ 0x00, 0x08, 0x36, 0x41, 0x00 }, // {
+		{ 0x00, 0x00, 0x7F, 0x00, 0x00 }, // |
+		{ 0x00, 0x41, 0x36, 0x08, 0x00 }, // }
+		{ 0x08, 0x04, 0x08, 0x10, 0x08 }, // ~
+	};
+
+	static_assert(sizeof(DEBUG_GLYPHS) / sizeof(DEBUG_GLYPHS[0]) == DEBUG_LAST - DEBUG_FIRST + 1, "one glyph per printable character");
+
+	vec2 texel_to_uv(ivec2 texel)
+	{
+		return vec2(texel) / vec2(ATLAS_SIZE);
+	}
+}
+
+void GlyphAtlas::init()
+{
+	std::vector<unsigned char> pixels(ATLAS_SIZE.x * ATLAS_SIZE.y * 4, 0);
+
+	Font& debug = fonts[(int)FONT::DEBUG];
+	debug.advance = (float)DEBUG_CELL.x / DEBUG_CELL.y;
+	for (int c = DEBUG_FIRST; c <= DEBUG_LAST; c++)
+	{
+		int index = c - DEBUG_FIRST;
+		ivec2 cell = ivec2(index % DEBUG_COLUMNS, index / DEBUG_COLUMNS) * DEBUG_CELL;
+		for (int x = 0; x < 5; x++)
+			for (int y = 0; y < 7; y++)
+			{
+				if (!(DEBUG_GLYPHS[index][x] & (1 << y)))
+					continue;
+				unsigned char* pixel = &pixels[((cell.y + y) * ATLAS_SIZE.x + cell.x + x) * 4];
+				pixel[0] = pixel[1] = pixel[2] = pixel[3] = 255;
+			}
+		// the quad covers the whole cell, spacing included
+		Glyph& glyph = debug.glyphs[c];
+		glyph.uv_min = texel_to_uv(cell);
+		glyph.uv_max = texel_to_uv(cell + DEBUG_CELL);
+		glyph.width = debug.advance;
+	}
+
+	// digits sit in fixed cells as wide as they are tall, like the old score sprites
+	fonts[(int)FONT::SCORE].advance = 1.f;
+
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_SIZE.x, ATLAS_SIZE.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl_has_errors();
+}
+
+size_t GlyphAtlas::memory_bytes() const
+{
+	return (size_t)ATLAS_SIZE.x * ATLAS_SIZE.y * 4;
+}
+
+void GlyphAtlas::destroy()
+{
+	glDeleteTextures(1, &atlas);
+	atlas = 0;
+}
+
+void GlyphAtlas::uploadScoreDigit(int digit, ivec2 size, const unsigned char* pixels)
+{
+	if (size.x > SCORE_CELL.x || size.y > SCORE_CELL.y)
+	{
+		LOG_ERROR(RENDER, "Score digit %d (%dx%d) does not fit its atlas cell", digit, size.x, size.y);
+		return;
+	}
+	ivec2 cell = { digit * SCORE_CELL.x, SCORE_ROW_Y };
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, cell.x, cell.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	gl_has_errors();
+
+	Glyph& glyph = fonts[(int)FONT::SCORE].glyphs['0' + digit];
+	glyph.uv_min = texel_to_uv(cell);
+	glyph.uv_max = texel_to_uv(cell + size);
+	glyph.width = (float)size.x / size.y;
+	glyph_revision++;
+}
+
+float GlyphAtlas::width(FONT font, const std::string& text, float height) const
+{
+	return fonts[(int)font].advance * height * text.size();
+}
+
+void GlyphAtlas::layout(FONT font, const std::string& text, vec2 position, float height, vec3 color, bool right_aligned,
+	std::vector<TextVertex>& out) const
+{
+	const Font& f = fonts[(int)font];
+	float advance = f.advance * height;
+	if (right_aligned)
+		position.x -= width(font, text, height);
+
+	for (char c : text)
+	{
+		const Glyph& glyph = f.glyphs[(unsigned char)c & 127];
+		if (glyph.width > 0.f)
+		{
+			// centered in its advance, for the narrower digits
+			float w = glyph.width * height;
+			vec2 top_left = { position.x + (advance - w) / 2.f, position.y };
+			vec2 bottom_right = top_left + vec2(w, height);
+			TextVertex corners[4] = {
+				{ top_left, glyph.uv_min, color },
+				{ { bottom_right.x, top_left.y }, { glyph.uv_max.x, glyph.uv_min.y }, color },
+				{ bottom_right, glyph.uv_max, color },
+				{ { top_left.x, bottom_right.y }, { glyph.uv_min.x, glyph.uv_max.y }, color },
+			};
+			const int indices[6] = { 0, 1, 2, 0, 2, 3 };
+			for (int i : indices)
+				out.push_back(corners[i]);
+		}
+		position.x += advance;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+
+// stlib
+#include <array>
+#include <string>
+#include <vector>
+
+// One corner of a glyph quad, six per glyph
+struct TextVertex
+{
+	vec2 position;
+	vec2 texcoord;
+	vec3 color;
+};
+
+// Both fonts packed into a single texture, so any mix of text is one draw
+// call. The debug font is rasterized at init; the score digits are copied in
+// as their textures are uploaded and stay blank until then.
+class GlyphAtlas
+{
+public:
+	void init();
+	void destroy();
+
+	// Copies the RGBA pixels of one score digit texture into its cell
+	void uploadScoreDigit(int digit, ivec2 size, const unsigned char* pixels);
+
+	// Appends the quads of text, height pixels tall, with its top left (or
+	// top right if right_aligned) corner at position. Unknown characters
+	// advance without drawing.
+	void layout(FONT font, const std::string& text, vec2 position, float height, vec3 color, bool right_aligned,
+		std::vector<TextVertex>& out) const;
+	float width(FONT font, const std::string& text, float height) const;
+
+	GLuint texture() const { return atlas; }
+	size_t memory_bytes() const;
+	// bumped whenever glyphs are added, text laid out before needs redoing
+	unsigned int revision() const { return glyph_revision; }
+
+private:
+	struct Glyph
+	{
+		vec2 uv_min = { 0.f, 0.f };
+		vec2 uv_max = { 0.f, 0.f };
+		// quad width, in multiples of the text height; 0 for no glyph
+		float width = 0.f;
+	};
+	struct Font
+	{
+		// pen advance per character, in multiples of the text height
+		float advance = 1.f;
+		std::array<Glyph, 128> glyphs;
+	};
+
+	std::array<Font, font_count> fonts;
+	GLuint atlas = 0;
+	unsigned int glyph_revision = 0;
+};
@@ -0,0 +1,49 @@
+// Header
+#include "gpu_timer.hpp"
+
+void GpuTimer::init()
+{
+	glGenQueries(QUERY_COUNT, queries);
+	gl_has_errors();
+}
+
+void GpuTimer::destroy()
+{
+	if (queries[0] != 0)
+		glDeleteQueries(QUERY_COUNT, queries);
+	*this = GpuTimer();
+}
+
+void GpuTimer::begin()
+{
+	// the GPU is more than QUERY_COUNT frames behind, drop the oldest result
+	if (pending == QUERY_COUNT)
+		pending--;
+	glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void GpuTimer::end()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	next = (next + 1) % QUERY_COUNT;
+	pending++;
+}
+
+bool GpuTimer::poll(float& out_ms)
+{
+	bool found = false;
+	while (pending > 0)
+	{
+		GLuint query = queries[(next - pending + QUERY_COUNT) % QUERY_COUNT];
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+			break;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+		out_ms = (float)ns / 1000000.f;
+		pending--;
+		found = true;
+	}
+	return found;
+}
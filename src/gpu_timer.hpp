@@ -0,0 +1,27 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// Measures GPU time between begin() and end() with GL_TIME_ELAPSED queries.
+// Results are collected a few frames later so the CPU never waits on the GPU.
+// Only one timer may be between begin() and end() at a time.
+class GpuTimer
+{
+public:
+	void init();
+	void destroy();
+
+	void begin();
+	void end();
+
+	// Latest finished measurement; false if nothing new has completed
+	bool poll(float& out_ms);
+
+private:
+	static const int QUERY_COUNT = 4;
+	GLuint queries[QUERY_COUNT] = {};
+	int next = 0;
+	// begun but not yet read, oldest at next - pending
+	int pending = 0;
+};
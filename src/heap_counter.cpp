@@ -0,0 +1,164 @@
+// Header
+#include "heap_counter.hpp"
+
+// stlib
+#include <cstdlib>
+#include <new>
+#ifdef HEAP_TRACKING
+#include <atomic>
+#endif
+
+namespace
+{
+	// trivially constructed, so safe to touch from operator new on any thread
+	thread_local size_t thread_allocations = 0;
+	thread_local size_t thread_tagged_allocations = 0;
+	thread_local HEAP_TAG current_tag = HEAP_TAG::GENERAL;
+
+	void count_allocation()
+	{
+		thread_allocations++;
+		if (current_tag != HEAP_TAG::GENERAL)
+			thread_tagged_allocations++;
+	}
+
+	const char* HEAP_TAG_NAMES[heap_tag_count] = {
+		"general", "ecs", "textures", "meshes", "audio", "save", "render"
+	};
+
+	void* allocate_or_throw(std::size_t size)
+	{
+		while (true)
+		{
+			if (void* memory = std::malloc(size == 0 ? 1 : size))
+				return memory;
+			std::new_handler handler = std::get_new_handler();
+			if (!handler)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+#ifdef HEAP_TRACKING
+	// Every allocation is prefixed with its size and tag so delete can
+	// uncharge it. The header keeps the pointer handed out max-aligned.
+	struct AllocationHeader
+	{
+		size_t size;
+		HEAP_TAG tag;
+	};
+	const size_t HEADER_SIZE = alignof(std::max_align_t);
+	static_assert(sizeof(AllocationHeader) <= HEADER_SIZE, "allocation header does not fit its slot");
+
+	// zero initialized before any constructor runs
+	std::atomic<size_t> live_bytes[heap_tag_count];
+	std::atomic<size_t> live_allocations[heap_tag_count];
+	std::atomic<size_t> peak_bytes[heap_tag_count];
+	std::atomic<size_t> total_allocations[heap_tag_count];
+
+	void charge(HEAP_TAG tag, size_t size)
+	{
+		int i = (int)tag;
+		size_t live = live_bytes[i].fetch_add(size, std::memory_order_relaxed) + size;
+		live_allocations[i].fetch_add(1, std::memory_order_relaxed);
+		total_allocations[i].fetch_add(1, std::memory_order_relaxed);
+		size_t peak = peak_bytes[i].load(std::memory_order_relaxed);
+		while (live > peak && !peak_bytes[i].compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void uncharge(HEAP_TAG tag, size_t size)
+	{
+		int i = (int)tag;
+		live_bytes[i].fetch_sub(size, std::memory_order_relaxed);
+		live_allocations[i].fetch_sub(1, std::memory_order_relaxed);
+	}
+#endif
+}
+
+size_t heap_allocations()
+{
+	return thread_allocations;
+}
+
+size_t heap_tagged_allocations()
+{
+	return thread_tagged_allocations;
+}
+
+const char* heap_tag_name(HEAP_TAG tag)
+{
+	return HEAP_TAG_NAMES[(int)tag];
+}
+
+HeapTagScope::HeapTagScope(HEAP_TAG tag)
+	: previous(current_tag)
+{
+	current_tag = tag;
+}
+
+HeapTagScope::~HeapTagScope()
+{
+	current_tag = previous;
+}
+
+#ifdef HEAP_TRACKING
+
+bool heap_tag_stats(HEAP_TAG tag, HeapTagStats& stats)
+{
+	int i = (int)tag;
+	stats.live_bytes = live_bytes[i].load(std::memory_order_relaxed);
+	stats.live_allocations = live_allocations[i].load(std::memory_order_relaxed);
+	stats.peak_bytes = peak_bytes[i].load(std::memory_order_relaxed);
+	stats.total_allocations = total_allocations[i].load(std::memory_order_relaxed);
+	return true;
+}
+
+// The array and nothrow forms forward to these
+void* operator new(std::size_t size)
+{
+	count_allocation();
+	char* block = static_cast<char*>(allocate_or_throw(HEADER_SIZE + size));
+	AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+	header->size = size;
+	header->tag = current_tag;
+	charge(current_tag, size);
+	return block + HEADER_SIZE;
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (!memory)
+		return;
+	char* block = static_cast<char*>(memory) - HEADER_SIZE;
+	AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+	uncharge(header->tag, header->size);
+	std::free(block);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	::operator delete(memory);
+}
+
+#else
+
+// The array and nothrow forms forward to these
+void* operator new(std::size_t size)
+{
+	count_allocation();
+	return allocate_or_throw(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+#endif
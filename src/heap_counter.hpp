@@ -0,0 +1,70 @@
+#pragma once
+
+// stlib
+#include <cstddef>
+
+// Number of global operator new calls the calling thread has made so far.
+// Sampled around a tick of the main loop it shows whether the game still
+// touches the general heap once it reached a steady state.
+size_t heap_allocations();
+
+// What a heap allocation was made for. The calling thread's current tag is
+// set with HEAP_TAG_SCOPE and everything it allocates meanwhile is charged
+// to it; anything outside a scope is GENERAL.
+enum class HEAP_TAG
+{
+	GENERAL = 0,
+	ECS = GENERAL + 1,
+	TEXTURES = ECS + 1,
+	MESHES = TEXTURES + 1,
+	AUDIO = MESHES + 1,
+	SAVE = AUDIO + 1,
+	RENDER = SAVE + 1,
+	HEAP_TAG_COUNT = RENDER + 1
+};
+const int heap_tag_count = (int)HEAP_TAG::HEAP_TAG_COUNT;
+
+struct HeapTagStats
+{
+	size_t live_bytes = 0;
+	size_t live_allocations = 0;
+	size_t peak_bytes = 0;
+	size_t total_allocations = 0;
+};
+
+const char* heap_tag_name(HEAP_TAG tag);
+
+// Of heap_allocations(), those made inside a HEAP_TAG_SCOPE: storage a system
+// keeps and grows until the game reached its peak (containers, snapshots),
+// as opposed to the temporaries of a tick
+size_t heap_tagged_allocations();
+
+// Charges the calling thread's allocations to a tag until it goes out of
+// scope. Freeing is charged to the tag the memory was allocated under.
+class HeapTagScope
+{
+public:
+	explicit HeapTagScope(HEAP_TAG tag);
+	~HeapTagScope();
+	HeapTagScope(const HeapTagScope&) = delete;
+	HeapTagScope& operator=(const HeapTagScope&) = delete;
+
+private:
+	HEAP_TAG previous;
+};
+
+#define HEAP_TAG_CONCAT_INNER(a, b) a##b
+#define HEAP_TAG_CONCAT(a, b) HEAP_TAG_CONCAT_INNER(a, b)
+#define HEAP_TAG_SCOPE(tag) HeapTagScope HEAP_TAG_CONCAT(heap_tag_scope_, __LINE__)(HEAP_TAG::tag)
+
+#ifdef HEAP_TRACKING
+
+// Fills in the byte counts of a tag, always true in a tracking build
+bool heap_tag_stats(HEAP_TAG tag, HeapTagStats& stats);
+
+#else
+
+// Per-tag byte counts need the size header only a HEAP_TRACKING build adds
+inline bool heap_tag_stats(HEAP_TAG, HeapTagStats&) { return false; }
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+
+// stlib
+#include <functional>
+#include <vector>
+
+// A value that calls its listeners when it changes. Setting the value it
+// already holds is a single compare, so it can be published every step.
+template <typename T>
+class Observable
+{
+public:
+	using Listener = std::function<void(const T&)>;
+
+	void set(const T& new_value)
+	{
+		if (published && new_value == value)
+			return;
+		value = new_value;
+		published = true;
+		for (Listener& listener : listeners)
+			listener(value);
+	}
+	const T& get() const { return value; }
+
+	void subscribe(Listener listener) { listeners.push_back(std::move(listener)); }
+
+	// Drops the listeners; the next set notifies whatever subscribes again
+	void reset()
+	{
+		listeners.clear();
+		published = false;
+	}
+
+private:
+	T value = T();
+	bool published = false;
+	std::vector<Listener> listeners;
+};
+
+// What the in-game HUD shows. The world publishes the game state into it every
+// step and each widget only updates its render data when its value changed.
+struct HudModel
+{
+	Observable<int> hp;
+	Observable<INVULN_TYPE> invuln_type;
+	Observable<COLLECTABLE_TYPE> equipment;
+	Observable<unsigned int> score;
+	// the dynamic difficulty factor
+	Observable<float> difficulty;
+
+	// For when the HUD entities are recreated, before subscribing the new ones
+	void reset()
+	{
+		hp.reset();
+		invuln_type.reset();
+		equipment.reset();
+		score.reset();
+		difficulty.reset();
+	}
+};
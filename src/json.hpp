@@ -11,6 +11,9 @@
 #include <initializer_list>
 #include <ostream>
 #include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
 
 namespace json {
 
@@ -418,7 +421,7 @@ class JSON
         Class Type = Class::Null;
 };
 
-JSON Array() {
+inline JSON Array() {
     return std::move( JSON::Make( JSON::Class::Array ) );
 }
 
@@ -429,11 +432,11 @@ JSON Array( T... args ) {
     return std::move( arr );
 }
 
-JSON Object() {
+inline JSON Object() {
     return std::move( JSON::Make( JSON::Class::Object ) );
 }
 
-std::ostream& operator<<( std::ostream &os, const JSON &json ) {
+inline std::ostream& operator<<( std::ostream &os, const JSON &json ) {
     os << json.dump();
     return os;
 }
@@ -641,9 +644,297 @@ namespace {
     }
 }
 
-JSON JSON::Load( const string &str ) {
+inline JSON JSON::Load( const string &str ) {
     size_t offset = 0;
     return std::move( parse_next( str, offset ) );
 }
 
+/* Read-only, arena-backed DOM for loading files.
+ *
+ * Document::Parse takes ownership of the text and parses it in place: strings
+ * are unescaped inside the buffer and nodes point at them, arrays and objects
+ * are ranges of one flat child list, and everything is released together when
+ * the Document goes away. Use JSON when the tree needs to be built or edited.
+ */
+class Document
+{
+    public:
+        typedef JSON::Class Class;
+
+        class Value {
+            const Document *doc;
+            unsigned        idx;
+
+            public:
+                Value( const Document *d, unsigned i ) : doc( d ), idx( i ) {}
+
+                Class JSONType() const { return IsValid() ? doc->nodes[idx].type : Class::Null; }
+                bool IsNull() const { return JSONType() == Class::Null; }
+
+                // Number of members of an object or elements of an array, -1 otherwise
+                int size() const {
+                    Class type = JSONType();
+                    if( type == Class::Array || type == Class::Object )
+                        return doc->nodes[idx].count;
+                    return -1;
+                }
+
+                bool hasKey( const char *key ) const { return Find( key ) != npos; }
+
+                Value operator[]( const char *key ) const { return Value( doc, Find( key ) ); }
+                Value operator[]( const string &key ) const { return operator[]( key.c_str() ); }
+
+                Value operator[]( unsigned index ) const {
+                    if( JSONType() != Class::Array || index >= doc->nodes[idx].count )
+                        return Value( doc, npos );
+                    return Value( doc, doc->children[doc->nodes[idx].first + index] );
+                }
+
+                // Object members in file order
+                Value key( unsigned index ) const { return member( index, 0 ); }
+                Value value( unsigned index ) const { return member( index, 1 ); }
+
+                // Unescaped string bytes inside the document buffer
+                const char *data() const { return JSONType() == Class::String ? doc->buffer.data() + doc->nodes[idx].str : ""; }
+                size_t length() const { return JSONType() == Class::String ? doc->nodes[idx].len : 0; }
+                string ToString() const { return string( data(), length() ); }
+
+                // Integral and floating values convert into each other, unlike JSON
+                double ToFloat() const {
+                    Class type = JSONType();
+                    if( type == Class::Floating ) return doc->nodes[idx].Float;
+                    if( type == Class::Integral ) return (double)doc->nodes[idx].Int;
+                    return 0.0;
+                }
+
+                long ToInt() const {
+                    Class type = JSONType();
+                    if( type == Class::Integral ) return doc->nodes[idx].Int;
+                    if( type == Class::Floating ) return (long)doc->nodes[idx].Float;
+                    return 0;
+                }
+
+                bool ToBool() const { return JSONType() == Class::Boolean && doc->nodes[idx].Bool; }
+
+            private:
+                bool IsValid() const { return doc && idx != npos; }
+
+                Value member( unsigned index, unsigned which ) const {
+                    if( JSONType() != Class::Object || index >= doc->nodes[idx].count )
+                        return Value( doc, npos );
+                    return Value( doc, doc->children[doc->nodes[idx].first + index * 2 + which] );
+                }
+
+                unsigned Find( const char *key ) const {
+                    if( JSONType() != Class::Object )
+                        return npos;
+                    const Node &obj = doc->nodes[idx];
+                    size_t key_len = strlen( key );
+                    for( unsigned i = 0; i < obj.count; ++i ) {
+                        const Node &k = doc->nodes[doc->children[obj.first + i * 2]];
+                        if( k.len == key_len && memcmp( doc->buffer.data() + k.str, key, key_len ) == 0 )
+                            return doc->children[obj.first + i * 2 + 1];
+                    }
+                    return npos;
+                }
+        };
+
+        // Parses text, replacing anything parsed before. Returns false and logs on malformed input.
+        bool Parse( string text ) {
+            buffer = std::move( text );
+            nodes.clear();
+            children.clear();
+            scratch.clear();
+            nodes.reserve( buffer.size() / 8 + 1 );
+            children.reserve( buffer.size() / 8 + 1 );
+
+            cursor = &buffer[0];
+            ok = true;
+            ParseNext();
+            SkipWs();
+            if( ok && *cursor != '\0' )
+                Fail( "trailing characters" );
+            if( !ok ) {
+                nodes.clear();
+                children.clear();
+            }
+            scratch = std::vector<unsigned>();
+            return ok;
+        }
+
+        Value Root() const { return Value( this, nodes.empty() ? npos : 0 ); }
+
+    private:
+        enum : unsigned { npos = ~0u };
+
+        struct Node {
+            Class type = Class::Null;
+            union {
+                double Float;
+                long   Int;
+                bool   Bool;
+            };
+            unsigned    str = 0;        // String: offset into buffer
+            unsigned    len = 0;        // String
+            unsigned    first = 0;      // Array / Object: offset into children
+            unsigned    count = 0;      // Array: elements, Object: members
+
+            Node() : Int( 0 ) {}
+        };
+
+        unsigned NewNode( Class type ) {
+            nodes.emplace_back();
+            nodes.back().type = type;
+            return (unsigned)nodes.size() - 1;
+        }
+
+        void SkipWs() {
+            while( *cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t' ) ++cursor;
+        }
+
+        void Fail( const char *what ) {
+            if( ok )
+                std::cerr << "ERROR: Document: " << what << " at offset " << ( cursor - buffer.data() ) << "\n";
+            ok = false;
+        }
+
+        // Children are gathered on the scratch stack while a container is open and
+        // copied into one contiguous run of children when it closes.
+        void CloseContainer( unsigned node, size_t scratch_start, unsigned per_entry ) {
+            nodes[node].first = (unsigned)children.size();
+            nodes[node].count = (unsigned)( ( scratch.size() - scratch_start ) / per_entry );
+            children.insert( children.end(), scratch.begin() + scratch_start, scratch.end() );
+            scratch.resize( scratch_start );
+        }
+
+        unsigned ParseNext() {
+            SkipWs();
+            switch( *cursor ) {
+                case '{' : return ParseObject();
+                case '[' : return ParseArray();
+                case '\"': return ParseString();
+                case 't' : return ParseLiteral( "true", Class::Boolean, true );
+                case 'f' : return ParseLiteral( "false", Class::Boolean, false );
+                case 'n' : return ParseLiteral( "null", Class::Null, false );
+                default  :
+                    if( ( *cursor >= '0' && *cursor <= '9' ) || *cursor == '-' )
+                        return ParseNumber();
+            }
+            Fail( "unknown starting character" );
+            return NewNode( Class::Null );
+        }
+
+        unsigned ParseObject() {
+            unsigned node = NewNode( Class::Object );
+            size_t scratch_start = scratch.size();
+            ++cursor;
+            SkipWs();
+            if( *cursor == '}' )
+                ++cursor;
+            else while( ok ) {
+                SkipWs();
+                if( *cursor != '\"' ) { Fail( "expected string key" ); break; }
+                scratch.push_back( ParseString() );
+                SkipWs();
+                if( *cursor != ':' ) { Fail( "expected colon" ); break; }
+                ++cursor;
+                scratch.push_back( ParseNext() );
+                SkipWs();
+                if( *cursor == ',' ) { ++cursor; continue; }
+                if( *cursor == '}' ) { ++cursor; break; }
+                Fail( "expected ',' or '}'" );
+            }
+            CloseContainer( node, scratch_start, 2 );
+            return node;
+        }
+
+        unsigned ParseArray() {
+            unsigned node = NewNode( Class::Array );
+            size_t scratch_start = scratch.size();
+            ++cursor;
+            SkipWs();
+            if( *cursor == ']' )
+                ++cursor;
+            else while( ok ) {
+                scratch.push_back( ParseNext() );
+                SkipWs();
+                if( *cursor == ',' ) { ++cursor; continue; }
+                if( *cursor == ']' ) { ++cursor; break; }
+                Fail( "expected ',' or ']'" );
+            }
+            CloseContainer( node, scratch_start, 1 );
+            return node;
+        }
+
+        // Unescapes in place; the output never outruns the input.
+        unsigned ParseString() {
+            unsigned node = NewNode( Class::String );
+            char *out = ++cursor;
+            const char *start = out;
+            while( *cursor != '\"' ) {
+                if( *cursor == '\0' ) { Fail( "unterminated string" ); break; }
+                if( *cursor != '\\' ) { *out++ = *cursor++; continue; }
+                switch( *++cursor ) {
+                    case '\"': *out++ = '\"'; break;
+                    case '\\': *out++ = '\\'; break;
+                    case '/' : *out++ = '/';  break;
+                    case 'b' : *out++ = '\b'; break;
+                    case 'f' : *out++ = '\f'; break;
+                    case 'n' : *out++ = '\n'; break;
+                    case 'r' : *out++ = '\r'; break;
+                    case 't' : *out++ = '\t'; break;
+                    case '\0': Fail( "unterminated string" ); continue;
+                    default  : *out++ = '\\'; *out++ = *cursor; break;  // \u is kept verbatim, like JSON
+                }
+                ++cursor;
+            }
+            if( *cursor == '\"' ) ++cursor;
+            nodes[node].str = (unsigned)( start - buffer.data() );
+            nodes[node].len = (unsigned)( out - start );
+            return node;
+        }
+
+        unsigned ParseNumber() {
+            const char *start = cursor;
+            bool is_double = false;
+            if( *cursor == '-' ) ++cursor;
+            while( ( *cursor >= '0' && *cursor <= '9' ) || *cursor == '.' || *cursor == 'e' || *cursor == 'E' || *cursor == '+' || *cursor == '-' ) {
+                is_double = is_double || *cursor == '.' || *cursor == 'e' || *cursor == 'E';
+                ++cursor;
+            }
+            char *end = nullptr;
+            unsigned node;
+            if( is_double ) {
+                node = NewNode( Class::Floating );
+                nodes[node].Float = strtod( start, &end );
+            }
+            else {
+                node = NewNode( Class::Integral );
+                nodes[node].Int = strtol( start, &end, 10 );
+            }
+            if( end != cursor )
+                Fail( "malformed number" );
+            return node;
+        }
+
+        unsigned ParseLiteral( const char *word, Class type, bool value ) {
+            size_t n = strlen( word );
+            if( strncmp( cursor, word, n ) != 0 )
+                Fail( "unknown literal" );
+            else
+                cursor += n;
+            unsigned node = NewNode( type );
+            if( type == Class::Boolean )
+                nodes[node].Bool = value;
+            return node;
+        }
+
+        string                buffer;
+        std::vector<Node>     nodes;
+        std::vector<unsigned> children;
+        std::vector<unsigned> scratch;
+        char                 *cursor = nullptr;
+        bool                  ok = true;
+};
+
 } // End Namespace json
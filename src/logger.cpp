@@ -0,0 +1,170 @@
+// Header
+#include "logger.hpp"
+
+// stlib
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	const size_t LOG_RING_SIZE = 1024; // power of two
+	const size_t LOG_MESSAGE_SIZE = 240;
+	const auto LOG_FLUSH_INTERVAL = std::chrono::milliseconds(20);
+
+	const char* const level_names[] = { "debug", "info", "warn", "error" };
+	const char* const category_names[] = { "game", "spawn", "ai", "physics", "render", "audio" };
+
+	// A slot is free for the producer claiming position p while its sequence
+	// is p, and holds a message for the consumer while it is p + 1
+	struct LogSlot
+	{
+		std::atomic<size_t> sequence;
+		LOG_LEVEL level;
+		LOG_CATEGORY category;
+		char text[LOG_MESSAGE_SIZE];
+	};
+
+	// Bounded multi-producer ring drained by one consumer at a time, normally
+	// the flush thread
+	class Logger
+	{
+	public:
+		Logger()
+		{
+			for (size_t i = 0; i < LOG_RING_SIZE; i++)
+				ring[i].sequence.store(i, std::memory_order_relaxed);
+			flusher = std::thread([this]() { run(); });
+		}
+
+		~Logger()
+		{
+			{
+				std::lock_guard<std::mutex> lock(stop_mutex);
+				stop = true;
+			}
+			stop_signal.notify_one();
+			flusher.join();
+			drain();
+		}
+
+		void push(LOG_LEVEL level, LOG_CATEGORY category, const char* format, va_list args)
+		{
+			size_t position = enqueue_position.load(std::memory_order_relaxed);
+			LogSlot* slot;
+			while (true)
+			{
+				slot = &ring[position & (LOG_RING_SIZE - 1)];
+				size_t sequence = slot->sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+				if (difference == 0) {
+					if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				} else if (difference < 0) {
+					// full, the flusher is behind
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				} else {
+					position = enqueue_position.load(std::memory_order_relaxed);
+				}
+			}
+			slot->level = level;
+			slot->category = category;
+			vsnprintf(slot->text, LOG_MESSAGE_SIZE, format, args);
+			slot->sequence.store(position + 1, std::memory_order_release);
+		}
+
+		void drain()
+		{
+			std::lock_guard<std::mutex> lock(drain_mutex);
+			bool wrote_out = false, wrote_err = false;
+			while (true)
+			{
+				LogSlot& slot = ring[dequeue_position & (LOG_RING_SIZE - 1)];
+				if (slot.sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+					break;
+				bool is_error = slot.level >= LOG_LEVEL::WARN;
+				fprintf(is_error ? stderr : stdout, "[%s] %s%s%s\n", category_names[(int)slot.category],
+					is_error ? level_names[(int)slot.level] : "", is_error ? ": " : "", slot.text);
+				wrote_err = wrote_err || is_error;
+				wrote_out = wrote_out || !is_error;
+				slot.sequence.store(dequeue_position + LOG_RING_SIZE, std::memory_order_release);
+				dequeue_position++;
+			}
+
+			unsigned int lost = dropped.exchange(0, std::memory_order_relaxed);
+			if (lost > 0) {
+				fprintf(stderr, "[log] %u messages dropped\n", lost);
+				wrote_err = true;
+			}
+			if (wrote_out)
+				fflush(stdout);
+			if (wrote_err)
+				fflush(stderr);
+		}
+
+	private:
+		void run()
+		{
+			std::unique_lock<std::mutex> lock(stop_mutex);
+			while (!stop)
+			{
+				stop_signal.wait_for(lock, LOG_FLUSH_INTERVAL);
+				lock.unlock();
+				drain();
+				lock.lock();
+			}
+		}
+
+		LogSlot ring[LOG_RING_SIZE];
+		std::atomic<size_t> enqueue_position{ 0 };
+		std::atomic<unsigned int> dropped{ 0 };
+		size_t dequeue_position = 0;
+		std::mutex drain_mutex;
+
+		std::thread flusher;
+		std::mutex stop_mutex;
+		std::condition_variable stop_signal;
+		bool stop = false;
+	};
+
+	// Started by the first message, flushed and stopped at exit
+	Logger& logger()
+	{
+		static Logger instance;
+		return instance;
+	}
+}
+
+void log_write(LOG_LEVEL level, LOG_CATEGORY category, const char* format, ...)
+{
+	// an error makes room first rather than risk being the message dropped
+	if (level == LOG_LEVEL::ERR)
+		log_flush();
+	va_list args;
+	va_start(args, format);
+	logger().push(level, category, format, args);
+	va_end(args);
+	if (level == LOG_LEVEL::ERR)
+		log_flush();
+}
+
+void log_flush()
+{
+	logger().drain();
+}
+
+bool LogRateLimit::allow(float interval_ms)
+{
+	long long now = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	long long next = next_us.load(std::memory_order_relaxed);
+	if (now < next)
+		return false;
+	// another thread may have taken this interval's message already
+	return next_us.compare_exchange_strong(next, now + (long long)(interval_ms * 1000.f), std::memory_order_relaxed);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// stlib
+#include <atomic>
+
+enum class LOG_LEVEL
+{
+	DEBUG = 0,
+	INFO = DEBUG + 1,
+	WARN = INFO + 1,
+	ERR = WARN + 1,
+};
+
+enum class LOG_CATEGORY
+{
+	GAME = 0,
+	SPAWN = GAME + 1,
+	AI = SPAWN + 1,
+	PHYSICS = AI + 1,
+	RENDER = PHYSICS + 1,
+	AUDIO = RENDER + 1,
+	LOG_CATEGORY_COUNT = AUDIO + 1
+};
+
+// Compile-time filters, override with -D. Release builds drop debug messages;
+// LOG_CATEGORY_MASK has one bit per LOG_CATEGORY.
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+#ifndef LOG_CATEGORY_MASK
+#define LOG_CATEGORY_MASK 0xffffffffu
+#endif
+
+constexpr bool log_enabled(LOG_LEVEL level, LOG_CATEGORY category)
+{
+	return (int)level >= LOG_MIN_LEVEL && (LOG_CATEGORY_MASK & (1u << (int)category)) != 0;
+}
+
+// Formats the message into a lock-free ring buffer and returns; a background
+// thread writes it out, so the caller never waits on the terminal. With the
+// ring full the message is dropped and counted. Errors are written out before
+// returning, since an assert usually follows them.
+void log_write(LOG_LEVEL level, LOG_CATEGORY category, const char* format, ...)
+#ifdef __GNUC__
+	__attribute__((format(printf, 3, 4)))
+#endif
+	;
+
+// Writes out everything queued so far
+void log_flush();
+
+// Lets one message through per interval, for log lines in per-frame code
+class LogRateLimit
+{
+public:
+	bool allow(float interval_ms);
+
+private:
+	std::atomic<long long> next_us{ 0 };
+};
+
+// A disabled level or category is a constant false condition, so the call
+// and its arguments are compiled out
+#define LOG(level, category, ...) \
+	do { \
+		if (log_enabled(LOG_LEVEL::level, LOG_CATEGORY::category)) \
+			log_write(LOG_LEVEL::level, LOG_CATEGORY::category, __VA_ARGS__); \
+	} while (0)
+
+#define LOG_DEBUG(category, ...) LOG(DEBUG, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG(INFO, category, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG(WARN, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG(ERR, category, __VA_ARGS__)
+
+// At most one message per interval_ms from this call site
+#define LOG_EVERY_MS(interval_ms, level, category, ...) \
+	do { \
+		static LogRateLimit log_rate_limit; \
+		if (log_enabled(LOG_LEVEL::level, LOG_CATEGORY::category) && log_rate_limit.allow(interval_ms)) \
+			log_write(LOG_LEVEL::level, LOG_CATEGORY::category, __VA_ARGS__); \
+	} while (0)
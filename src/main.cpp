@@ -3,21 +3,52 @@
 #include <gl3w.h>
 
 // stlib
+#include <cassert>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
 // internal
+#include "animation_system.hpp"
 #include "physics_system.hpp"
 #include "render_system.hpp"
 #include "world_system.hpp"
+#include "profiler.hpp"
+#include "logger.hpp"
+#include "frame_arena.hpp"
+#include "heap_counter.hpp"
+#include "sound_utils.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
+
+// With rendering on its own thread nothing paces the game loop to vsync any
+// more; don't step more often than this
+const auto MIN_STEP_TIME = std::chrono::microseconds(1000000 / 240);
+
+// Ticks of uninterrupted play before the game counts as settled; debug builds
+// assert that a settled tick makes no heap allocation
+const int SETTLE_TICKS = 120;
+
 // Entry point
-int main()
+int main(int argc, char* argv[])
 {
+	// --pipelined: draw on a render thread from snapshots of the game state
+	// --audio-buffer <samples>: mixer buffer length, raise it if the sound crackles
+	bool pipelined = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--pipelined") == 0)
+			pipelined = true;
+		else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc)
+			set_audio_buffer_samples(atoi(argv[++i]));
+	}
+
 	// Global systems
 	WorldSystem world_system;
 	RenderSystem render_system;
 	PhysicsSystem physics_system;
+	AnimationSystem animation_system;
 	
 	// Initializing window
 	GLFWwindow* window = world_system.create_window();
@@ -31,26 +62,66 @@ int main()
 	// initialize the main systems
 	render_system.init(window);
 	world_system.init(&render_system);
+	if (pipelined)
+		render_system.startRenderThread();
 	
 	// variable timestep loop
 	auto t = Clock::now();
+	int settled_ticks = 0;
+	unsigned int restarts = world_system.restarts;
 	while (!world_system.is_over()) {
 		// Processes system messages, if this wasn't present the window would become unresponsive
 		glfwPollEvents();
+		// general heap use of the tick, the window system's excluded
+		size_t allocations_before = heap_allocations();
+		size_t tagged_before = heap_tagged_allocations();
 		// Calculating elapsed times in milliseconds from the previous iteration
         auto now = Clock::now();
 		
-        if (!world_system.pause && !world_system.isTitleScreen) {
-            float elapsed_ms =
-                    min((float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000, 50.0f);
-            world_system.step(elapsed_ms);
-			physics_system.step(elapsed_ms, world_system.dialogue_screen_active);
-            world_system.handle_collisions();
+        float elapsed_ms =
+                min((float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000, 50.0f);
+        if (!world_system.pause) {
+            // the title and almanac screens animate too
+            animation_system.step(elapsed_ms, world_system.dialogue_screen_active);
+            if (!world_system.isTitleScreen) {
+                world_system.step(elapsed_ms);
+                physics_system.step(elapsed_ms, world_system.dialogue_screen_active);
+                world_system.handle_collisions();
+                world_system.autosave(elapsed_ms);
+            }
+            animation_system.update_frames();
         }
         t = now;
 
-		render_system.draw(world_system.pause, world_system.debug, world_system.dialogue_screen_active);
+		if (pipelined) {
+			render_system.submit(world_system.pause, world_system.debug, world_system.dialogue_screen_active);
+			std::this_thread::sleep_until(now + MIN_STEP_TIME);
+		} else {
+			render_system.draw(world_system.pause, world_system.debug, world_system.dialogue_screen_active);
+		}
+
+		// the tick's temporaries are done with
+		bool arena_grown = frame_arena().reset();
+		if (arena_grown)
+			LOG_DEBUG(GAME, "frame arena grown to %zu bytes", frame_arena().capacity());
+		// zero once the game settled, anything else is a hot path to move onto the arena
+		size_t tick_allocations = heap_allocations() - allocations_before;
+		profiler_count("heap allocs", (float)tick_allocations);
+
+		// Settling starts over whenever play stops (pause, dialogue, the title or
+		// the debug view, which copies the profiler sections), the world is
+		// rebuilt, or storage grew: the frame arena or anything tagged, like the
+		// registry's containers as the enemy count reaches a new peak
+		bool playing = !world_system.pause && !world_system.isTitleScreen && !world_system.dialogue_screen_active && !world_system.debug;
+		bool grown = arena_grown || heap_tagged_allocations() != tagged_before;
+		settled_ticks = (playing && !grown && world_system.restarts == restarts) ? settled_ticks + 1 : 0;
+		restarts = world_system.restarts;
+		assert(settled_ticks < SETTLE_TICKS || tick_allocations == 0);
 	}
+	render_system.stopRenderThread();
+
+	log_flush();
+	profiler_print();
 
 	return EXIT_SUCCESS;
 }
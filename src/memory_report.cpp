@@ -0,0 +1,89 @@
+// Header
+#include "memory_report.hpp"
+
+// internal
+#include "heap_counter.hpp"
+#include "logger.hpp"
+#include "sound_utils.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <array>
+#include <vector>
+
+namespace
+{
+	// What the previous report saw
+	bool has_previous = false;
+	unsigned int previous_entities = 0;
+	std::vector<size_t> previous_container_bytes;
+	std::array<size_t, heap_tag_count> previous_tag_bytes = {};
+
+	float kb(size_t bytes)
+	{
+		return bytes / 1024.f;
+	}
+
+	float delta_kb(size_t now, size_t before)
+	{
+		return ((float)now - (float)before) / 1024.f;
+	}
+
+	void report_heap()
+	{
+		HeapTagStats stats;
+		if (!heap_tag_stats(HEAP_TAG::GENERAL, stats))
+		{
+			LOG_INFO(GAME, "Heap by tag: configure with -DHEAP_TRACKING=ON to track it");
+			return;
+		}
+		LOG_INFO(GAME, "%-10s %12s %10s %12s %12s", "heap tag", "live KB", "blocks", "peak KB", "change KB");
+		size_t total = 0;
+		for (int i = 0; i < heap_tag_count; i++)
+		{
+			heap_tag_stats((HEAP_TAG)i, stats);
+			LOG_INFO(GAME, "%-10s %12.1f %10zu %12.1f %+12.1f", heap_tag_name((HEAP_TAG)i), kb(stats.live_bytes),
+				stats.live_allocations, kb(stats.peak_bytes), delta_kb(stats.live_bytes, previous_tag_bytes[i]));
+			previous_tag_bytes[i] = stats.live_bytes;
+			total += stats.live_bytes;
+		}
+		LOG_INFO(GAME, "%-10s %12.1f", "total", kb(total));
+	}
+
+	void report_registry()
+	{
+		std::vector<ContainerMemory> usage = registry.memory_usage();
+		previous_container_bytes.resize(usage.size(), 0);
+
+		LOG_INFO(GAME, "%-40s %10s %12s %12s", "container", "count", "KB", "change KB");
+		size_t total = 0;
+		for (size_t i = 0; i < usage.size(); i++)
+		{
+			const ContainerMemory& container = usage[i];
+			// skip what never held anything
+			if (container.bytes > 0 || previous_container_bytes[i] > 0)
+				LOG_INFO(GAME, "%-40s %10zu %12.1f %+12.1f", container.type, container.components, kb(container.bytes),
+					delta_kb(container.bytes, previous_container_bytes[i]));
+			previous_container_bytes[i] = container.bytes;
+			total += container.bytes;
+		}
+		LOG_INFO(GAME, "%-40s %10s %12.1f  (component-owned heap not included)", "total", "", kb(total));
+
+		unsigned int entities = Entity::created();
+		if (has_previous)
+			LOG_INFO(GAME, "%u entity ids handed out, %u since the last report", entities, entities - previous_entities);
+		else
+			LOG_INFO(GAME, "%u entity ids handed out", entities);
+		previous_entities = entities;
+	}
+}
+
+void log_memory_report(RenderSystem* renderer)
+{
+	LOG_INFO(GAME, "---- memory report ----");
+	report_heap();
+	report_registry();
+	renderer->reportMemory();
+	report_sound_memory();
+	has_previous = true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// internal
+#include "render_system.hpp"
+
+// Logs where the game's memory went: heap bytes per tag (HEAP_TRACKING
+// builds only), every registry container, what the renderer uploaded and
+// the decoded sound effects. Registry sizes, entity ids and heap tags are
+// printed with their change since the previous report, so pressing the key
+// again after a while of play shows what keeps growing.
+void log_memory_report(RenderSystem* renderer);
@@ -0,0 +1,193 @@
+// Header
+#include "mesh_cache.hpp"
+#include "logger.hpp"
+
+// stlib
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const uint32_t MESH_CACHE_MAGIC = 0x434d5454; // "TTMC"
+	const uint32_t MESH_CACHE_VERSION = 1;
+
+	enum class MeshCacheKind : uint32_t
+	{
+		MESH = 0,
+		COLLISION_MESH = 1
+	};
+
+	struct MeshCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		MeshCacheKind kind;
+		uint32_t vertex_count;
+		uint64_t source_checksum;
+		uint32_t element_count; // indices for MESH, edges for COLLISION_MESH
+		uint32_t element_size;
+		float size_x;
+		float size_y;
+	};
+
+	static_assert(sizeof(ColoredVertex) == 6 * sizeof(float), "ColoredVertex must be tightly packed for the mesh cache");
+
+	std::string cache_path(const std::string& obj_path)
+	{
+		return obj_path + ".bin";
+	}
+
+	// Checksum of the source OBJ, or 0 if it isn't there
+	uint64_t source_checksum(const std::string& obj_path, bool& has_source)
+	{
+		std::vector<char> bytes;
+		has_source = read_file_bytes(obj_path, bytes);
+		return has_source ? fnv1a_hash(bytes.data(), bytes.size()) : 0;
+	}
+
+	// Returns the element payload if the cache exists, is well formed and matches the source
+	bool read_cache(const std::string& obj_path, MeshCacheKind kind, uint32_t element_size,
+		std::vector<ColoredVertex>& out_vertices, std::vector<char>& out_elements, uint32_t& out_element_count, vec2& out_size)
+	{
+		std::vector<char> bytes;
+		if (!read_file_bytes(cache_path(obj_path), bytes) || bytes.size() < sizeof(MeshCacheHeader))
+			return false;
+
+		MeshCacheHeader header;
+		memcpy(&header, bytes.data(), sizeof(header));
+		if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+			header.kind != kind || header.element_size != element_size)
+			return false;
+
+		size_t vertex_bytes = (size_t)header.vertex_count * sizeof(ColoredVertex);
+		size_t element_bytes = (size_t)header.element_count * element_size;
+		if (bytes.size() != sizeof(header) + vertex_bytes + element_bytes)
+			return false;
+
+		bool has_source;
+		uint64_t checksum = source_checksum(obj_path, has_source);
+		if (has_source && checksum != header.source_checksum)
+		{
+			LOG_INFO(RENDER, "Mesh cache for %s is stale, rebuilding", obj_path.c_str());
+			return false;
+		}
+
+		const char* payload = bytes.data() + sizeof(header);
+		out_vertices.resize(header.vertex_count);
+		memcpy(out_vertices.data(), payload, vertex_bytes);
+		out_elements.assign(payload + vertex_bytes, payload + vertex_bytes + element_bytes);
+		out_element_count = header.element_count;
+		out_size = { header.size_x, header.size_y };
+		return true;
+	}
+
+	void write_cache(const std::string& obj_path, MeshCacheKind kind, uint32_t element_size,
+		const std::vector<ColoredVertex>& vertices, const void* elements, uint32_t element_count, vec2 size)
+	{
+		bool has_source;
+		MeshCacheHeader header;
+		header.magic = MESH_CACHE_MAGIC;
+		header.version = MESH_CACHE_VERSION;
+		header.kind = kind;
+		header.vertex_count = (uint32_t)vertices.size();
+		header.source_checksum = source_checksum(obj_path, has_source);
+		header.element_count = element_count;
+		header.element_size = element_size;
+		header.size_x = size.x;
+		header.size_y = size.y;
+
+		std::string path = cache_path(obj_path);
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == nullptr)
+		{
+			LOG_ERROR(RENDER, "Failed to write mesh cache %s", path.c_str());
+			return;
+		}
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(vertices.data(), sizeof(ColoredVertex), vertices.size(), file);
+		fwrite(elements, element_size, element_count, file);
+		fclose(file);
+	}
+}
+
+uint64_t fnv1a_hash(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool read_file_bytes(const std::string& path, std::vector<char>& out_bytes)
+{
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	out_bytes.resize(size > 0 ? (size_t)size : 0);
+	bool ok = out_bytes.empty() || fread(out_bytes.data(), 1, out_bytes.size(), file) == out_bytes.size();
+	fclose(file);
+	return ok;
+}
+
+bool load_mesh_cached(const std::string& obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<uint16_t>& out_vertex_indices, vec2& out_size)
+{
+	std::vector<char> elements;
+	uint32_t count;
+	if (read_cache(obj_path, MeshCacheKind::MESH, sizeof(uint16_t), out_vertices, elements, count, out_size))
+	{
+		out_vertex_indices.resize(count);
+		memcpy(out_vertex_indices.data(), elements.data(), elements.size());
+		return true;
+	}
+
+	out_vertices.clear();
+	out_vertex_indices.clear();
+	if (!Mesh::loadFromOBJFile(obj_path, out_vertices, out_vertex_indices, out_size))
+		return false;
+	write_cache(obj_path, MeshCacheKind::MESH, sizeof(uint16_t), out_vertices,
+		out_vertex_indices.data(), (uint32_t)out_vertex_indices.size(), out_size);
+	return true;
+}
+
+bool load_collision_mesh_cached(const std::string& obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<std::pair<int, int>>& out_edges, vec2& out_size)
+{
+	// edges are stored as two int32 per entry
+	const uint32_t edge_size = 2 * sizeof(int32_t);
+	std::vector<char> elements;
+	uint32_t count;
+	if (read_cache(obj_path, MeshCacheKind::COLLISION_MESH, edge_size, out_vertices, elements, count, out_size))
+	{
+		out_edges.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			int32_t edge[2];
+			memcpy(edge, elements.data() + i * edge_size, edge_size);
+			out_edges[i] = { edge[0], edge[1] };
+		}
+		return true;
+	}
+
+	out_vertices.clear();
+	out_edges.clear();
+	if (!CollisionMesh::loadFromOBJFile(obj_path, out_vertices, out_edges, out_size))
+		return false;
+	std::vector<int32_t> packed;
+	packed.reserve(out_edges.size() * 2);
+	for (const std::pair<int, int>& edge : out_edges)
+	{
+		packed.push_back(edge.first);
+		packed.push_back(edge.second);
+	}
+	write_cache(obj_path, MeshCacheKind::COLLISION_MESH, edge_size, out_vertices,
+		packed.data(), (uint32_t)out_edges.size(), out_size);
+	return true;
+}
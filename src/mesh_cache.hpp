@@ -0,0 +1,29 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+
+// stlib
+#include <string>
+#include <vector>
+#include <utility>
+
+// Binary cache for the OBJ meshes in data/meshes.
+//
+// The first launch parses foo.obj as before and writes foo.obj.bin next to it:
+// a small header (magic, version, kind, FNV-1a checksum of the source OBJ,
+// counts, original size) followed by the normalised vertex array and the
+// index or edge array. Later launches read the .bin in a single read and only
+// hash the OBJ bytes to detect a stale cache; no text is parsed. If the OBJ is
+// missing the cache is trusted as is.
+
+// Drop-in replacements for Mesh::loadFromOBJFile / CollisionMesh::loadFromOBJFile
+bool load_mesh_cached(const std::string& obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<uint16_t>& out_vertex_indices, vec2& out_size);
+bool load_collision_mesh_cached(const std::string& obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<std::pair<int, int>>& out_edges, vec2& out_size);
+
+// FNV-1a over a byte range, also used for other asset caches
+uint64_t fnv1a_hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+// Reads a whole file with one read; false if it can't be opened
+bool read_file_bytes(const std::string& path, std::vector<char>& out_bytes);
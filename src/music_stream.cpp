@@ -0,0 +1,696 @@
+// Header
+#include "music_stream.hpp"
+
+// internal
+#include "heap_counter.hpp"
+#include "logger.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+
+#include <SDL_mixer.h>
+
+namespace
+{
+	// Mixed ahead of the device, about 190 ms at 44.1 kHz. Power of two so
+	// the ring indices wrap with a mask.
+	const size_t RING_FRAMES = 8192;
+	const size_t CHUNK_FRAMES = 1024;
+	// how fast a deck still fading out is silenced when it is needed for a new track
+	const int DECLICK_MS = 10;
+
+	const int WAVE_FORMAT_PCM = 1;
+	const int WAVE_FORMAT_IEEE_FLOAT = 3;
+	const int WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+	unsigned int read_u32(const unsigned char* bytes)
+	{
+		return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+	}
+
+	unsigned int read_u16(const unsigned char* bytes)
+	{
+		return bytes[0] | (bytes[1] << 8);
+	}
+
+	float read_sample(const unsigned char* bytes, int bits, bool is_float)
+	{
+		switch (bits)
+		{
+		case 8:
+			return (bytes[0] - 128) / 128.f;
+		case 16:
+			return (Sint16)read_u16(bytes) / 32768.f;
+		case 24:
+			return (Sint32)((bytes[0] << 8) | (bytes[1] << 16) | ((unsigned int)bytes[2] << 24)) / 2147483648.f;
+		default:
+			if (is_float)
+			{
+				unsigned int word = read_u32(bytes);
+				float value;
+				memcpy(&value, &word, sizeof(value));
+				return value;
+			}
+			return (Sint32)read_u32(bytes) / 2147483648.f;
+		}
+	}
+
+	bool has_extension(const std::string& path, const char* extension)
+	{
+		size_t length = strlen(extension);
+		if (path.size() < length)
+			return false;
+		for (size_t i = 0; i < length; i++)
+			if (tolower((unsigned char)path[path.size() - length + i]) != extension[i])
+				return false;
+		return true;
+	}
+}
+
+bool WavStream::open(const std::string& path)
+{
+	close();
+	file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	unsigned char header[12];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+		memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+	{
+		close();
+		return false;
+	}
+
+	// walk the chunks up to the sample data, picking up the format on the way
+	int format = 0;
+	while (true)
+	{
+		unsigned char chunk[8];
+		if (fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk))
+		{
+			close();
+			return false;
+		}
+		size_t size = read_u32(chunk + 4);
+		if (memcmp(chunk, "fmt ", 4) == 0)
+		{
+			unsigned char fmt[40] = {};
+			size_t wanted = std::min(size, sizeof(fmt));
+			if (size < 16 || fread(fmt, 1, wanted, file) != wanted)
+			{
+				close();
+				return false;
+			}
+			format = read_u16(fmt);
+			channels = read_u16(fmt + 2);
+			sample_rate = read_u32(fmt + 4);
+			bits = read_u16(fmt + 14);
+			// the real format is the start of the sub format GUID
+			if (format == WAVE_FORMAT_EXTENSIBLE && size >= 26)
+				format = read_u16(fmt + 24);
+			fseek(file, (long)(size - wanted + (size & 1)), SEEK_CUR);
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			data_start = ftell(file);
+			data_bytes = size;
+			break;
+		}
+		else
+		{
+			fseek(file, (long)(size + (size & 1)), SEEK_CUR);
+		}
+	}
+
+	is_float = format == WAVE_FORMAT_IEEE_FLOAT;
+	bool readable = (format == WAVE_FORMAT_PCM && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) ||
+		(is_float && bits == 32);
+	size_t frame_bytes = channels * bits / 8;
+	if (!readable || channels < 1 || sample_rate <= 0 || data_bytes < frame_bytes)
+	{
+		close();
+		return false;
+	}
+	// a header may promise more than the file holds
+	fseek(file, 0, SEEK_END);
+	long end = ftell(file);
+	size_t on_disk = end > data_start ? (size_t)(end - data_start) : 0;
+	data_bytes = std::min(data_bytes, on_disk);
+	data_bytes -= data_bytes % frame_bytes;
+	if (data_bytes == 0 || fseek(file, data_start, SEEK_SET) != 0)
+	{
+		close();
+		return false;
+	}
+	data_read = 0;
+	read_since_rewind = false;
+	dead = false;
+	return true;
+}
+
+void WavStream::close()
+{
+	if (file != nullptr)
+		fclose(file);
+	file = nullptr;
+}
+
+void WavStream::read(float* out, size_t frames)
+{
+	size_t sample_bytes = bits / 8;
+	size_t frame_bytes = channels * sample_bytes;
+	while (frames > 0)
+	{
+		if (file == nullptr || dead)
+		{
+			std::fill(out, out + frames * 2, 0.f);
+			return;
+		}
+		if (data_read == data_bytes)
+		{
+			// a whole pass without a frame, rewinding again would spin forever
+			if (!read_since_rewind || fseek(file, data_start, SEEK_SET) != 0)
+			{
+				dead = true;
+				continue;
+			}
+			data_read = 0;
+			read_since_rewind = false;
+		}
+		size_t count = std::min(frames, (data_bytes - data_read) / frame_bytes);
+		raw.resize(count * frame_bytes);
+		size_t got = fread(raw.data(), frame_bytes, count, file);
+		if (got < count)
+		{
+			// truncated file, treat what is missing as the end
+			data_read = data_bytes;
+			if (got == 0)
+				continue;
+		}
+		else
+		{
+			data_read += got * frame_bytes;
+		}
+		if (got > 0)
+			read_since_rewind = true;
+
+		for (size_t i = 0; i < got; i++)
+		{
+			const unsigned char* frame = &raw[i * frame_bytes];
+			out[0] = read_sample(frame, bits, is_float);
+			out[1] = channels > 1 ? read_sample(frame + sample_bytes, bits, is_float) : out[0];
+			out += 2;
+		}
+		frames -= got;
+	}
+}
+
+bool OggStream::open(const std::string& path)
+{
+	close();
+	file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	// the first page names the logical stream, pages of any other are skipped
+	unsigned char first[27];
+	if (fread(first, 1, sizeof(first), file) != sizeof(first) || memcmp(first, "OggS", 4) != 0 ||
+		fseek(file, 0, SEEK_SET) != 0)
+	{
+		close();
+		return false;
+	}
+	serial = read_u32(first + 14);
+	segment_count = 0;
+	segment_next = 0;
+
+	bool headers = read_packet() && decoder.read_identification(packet.data(), packet.size()) &&
+		read_packet() && decoder.read_comment(packet.data(), packet.size()) &&
+		read_packet() && decoder.read_setup(packet.data(), packet.size());
+	if (!headers)
+	{
+		close();
+		return false;
+	}
+	// audio normally starts on a fresh page, but may share the setup's last one
+	if (segment_next == segment_count)
+	{
+		audio_page = ftell(file);
+		audio_segment = 0;
+	}
+	else
+	{
+		audio_page = page_start;
+		audio_segment = segment_next;
+	}
+	dead = false;
+	read_since_rewind = false;
+	if (!rewind())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void OggStream::close()
+{
+	if (file != nullptr)
+		fclose(file);
+	file = nullptr;
+	// the codebooks are only needed while the track plays
+	decoder = VorbisDecoder();
+}
+
+size_t OggStream::memory_bytes() const
+{
+	return decoder.memory_bytes() + page.capacity() + packet.capacity();
+}
+
+bool OggStream::read_page()
+{
+	while (true)
+	{
+		page_start = ftell(file);
+		unsigned char header[27];
+		if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "OggS", 4) != 0 || header[4] != 0)
+			return false;
+		segment_count = header[26];
+		if (fread(segments, 1, segment_count, file) != (size_t)segment_count)
+			return false;
+		size_t body = 0;
+		for (int i = 0; i < segment_count; i++)
+			body += segments[i];
+		page.resize(body);
+		if (fread(page.data(), 1, body, file) != body)
+			return false;
+		if (read_u32(header + 14) != serial)
+			continue;
+		page_granule = (long long)((unsigned long long)read_u32(header + 6) | ((unsigned long long)read_u32(header + 10) << 32));
+		page_last = (header[5] & 4) != 0;
+		segment_next = 0;
+		page_next = 0;
+		return true;
+	}
+}
+
+bool OggStream::read_packet()
+{
+	packet.clear();
+	while (true)
+	{
+		if (segment_next == segment_count)
+		{
+			if (!read_page())
+				return false;
+			continue;
+		}
+		// a lacing value of 255 means the packet goes on in the next segment
+		int lacing = segments[segment_next++];
+		packet.insert(packet.end(), page.begin() + page_next, page.begin() + page_next + lacing);
+		page_next += lacing;
+		if (lacing < 255)
+			return true;
+	}
+}
+
+bool OggStream::rewind()
+{
+	if (fseek(file, audio_page, SEEK_SET) != 0)
+		return false;
+	segment_count = 0;
+	segment_next = 0;
+	page_next = 0;
+	if (audio_segment > 0)
+	{
+		if (!read_page())
+			return false;
+		for (int i = 0; i < audio_segment; i++)
+			page_next += segments[i];
+		segment_next = audio_segment;
+	}
+	decoder.reset();
+	decoded = 0;
+	ready = 0;
+	ready_next = 0;
+	return true;
+}
+
+bool OggStream::decode_more()
+{
+	while (true)
+	{
+		if (!read_packet())
+		{
+			// a whole pass without a frame, rewinding again would spin forever
+			if (!read_since_rewind || !rewind())
+				return false;
+			read_since_rewind = false;
+			continue;
+		}
+		// a packet that doesn't decode is skipped, the next one stands alone
+		int frames = decoder.decode(packet.data(), packet.size());
+		if (frames <= 0)
+			continue;
+		// the last page's granule position trims the padding off the final packet
+		if (page_last && page_granule >= 0)
+			frames = (int)std::max(0LL, std::min((long long)frames, page_granule - decoded));
+		decoded += frames;
+		if (frames == 0)
+			continue;
+		ready = frames;
+		ready_next = 0;
+		read_since_rewind = true;
+		return true;
+	}
+}
+
+void OggStream::read(float* out, size_t frames)
+{
+	while (frames > 0)
+	{
+		if (file == nullptr || dead)
+		{
+			std::fill(out, out + frames * 2, 0.f);
+			return;
+		}
+		if (ready_next == ready && !decode_more())
+		{
+			dead = true;
+			continue;
+		}
+		size_t count = std::min(frames, (size_t)(ready - ready_next));
+		const float* left = decoder.pcm(0) + ready_next;
+		const float* right = decoder.channels() > 1 ? decoder.pcm(1) + ready_next : left;
+		for (size_t i = 0; i < count; i++)
+		{
+			out[0] = left[i];
+			out[1] = right[i];
+			out += 2;
+		}
+		ready_next += (int)count;
+		frames -= count;
+	}
+}
+
+bool TrackStream::open(const std::string& path)
+{
+	close();
+	is_ogg = has_extension(path, ".ogg");
+	return is_ogg ? ogg.open(path) : wav.open(path);
+}
+
+void TrackStream::close()
+{
+	wav.close();
+	ogg.close();
+}
+
+void TrackStream::read(float* out, size_t frames)
+{
+	if (is_ogg)
+		ogg.read(out, frames);
+	else
+		wav.read(out, frames);
+}
+
+void MusicStream::Deck::pull_frame()
+{
+	if (chunk_frame * 2 >= chunk.size())
+	{
+		stream.read(chunk.data(), chunk.size() / 2);
+		chunk_frame = 0;
+	}
+	previous[0] = next[0];
+	previous[1] = next[1];
+	next[0] = chunk[chunk_frame * 2];
+	next[1] = chunk[chunk_frame * 2 + 1];
+	chunk_frame++;
+}
+
+bool MusicStream::start()
+{
+	if (running)
+		return true;
+	Uint16 format;
+	if (!Mix_QuerySpec(&device_rate, &format, &device_channels))
+		return false;
+	if (format != AUDIO_S16SYS)
+	{
+		LOG_ERROR(AUDIO, "Music streaming needs signed 16 bit output, the device opened with format %x", format);
+		return false;
+	}
+
+	ring.assign(RING_FRAMES * 2, 0.f);
+	mix_buffer.assign(CHUNK_FRAMES * 2, 0.f);
+	for (Deck& deck : decks)
+		deck.chunk.assign(CHUNK_FRAMES * 2, 0.f);
+	// starts out a full ring of silence, so the device never waits on the first fill
+	ring_read = 0;
+	ring_write = RING_FRAMES;
+
+	running = true;
+	worker = std::thread(&MusicStream::run, this);
+	Mix_HookMusic(&MusicStream::mix, this);
+	return true;
+}
+
+void MusicStream::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running)
+			return;
+		running = false;
+	}
+	// the callback must be gone before the ring is
+	Mix_HookMusic(NULL, NULL);
+	wake.notify_one();
+	worker.join();
+	for (Deck& deck : decks)
+	{
+		deck.stream.close();
+		deck.active = false;
+	}
+}
+
+void MusicStream::play(const std::string& path, int fade_ms)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back({ path, fade_ms });
+	}
+	wake.notify_one();
+}
+
+void MusicStream::fade_out(int fade_ms)
+{
+	play("", fade_ms);
+}
+
+bool MusicStream::can_play(const std::string& path)
+{
+	TrackStream probe;
+	return probe.open(path);
+}
+
+size_t MusicStream::memory_bytes() const
+{
+	size_t bytes = (ring.capacity() + mix_buffer.capacity()) * sizeof(float);
+	for (const Deck& deck : decks)
+		bytes += deck.chunk.capacity() * sizeof(float);
+	return bytes;
+}
+
+int MusicStream::fade_frames(int fade_ms) const
+{
+	return std::max(1, (int)((long long)fade_ms * device_rate / 1000));
+}
+
+// Runs on the audio device's thread: no locks, no allocation, no file access
+void MusicStream::mix(void* self, Uint8* stream, int length)
+{
+	MusicStream* music = static_cast<MusicStream*>(self);
+	Sint16* out = reinterpret_cast<Sint16*>(stream);
+	int channels = music->device_channels;
+	size_t frames = length / (sizeof(Sint16) * channels);
+
+	size_t read = music->ring_read.load(std::memory_order_relaxed);
+	size_t available = music->ring_write.load(std::memory_order_acquire) - read;
+	size_t taken = std::min(frames, available);
+	float volume = music->master_volume.load(std::memory_order_relaxed) * 32767.f;
+	for (size_t i = 0; i < frames; i++)
+	{
+		float left = 0.f, right = 0.f;
+		if (i < taken)
+		{
+			size_t at = ((read + i) & (RING_FRAMES - 1)) * 2;
+			left = music->ring[at];
+			right = music->ring[at + 1];
+		}
+		Sint16 l = (Sint16)(clamp(left, -1.f, 1.f) * volume);
+		Sint16 r = (Sint16)(clamp(right, -1.f, 1.f) * volume);
+		if (channels == 1)
+		{
+			out[0] = (Sint16)((l + r) / 2);
+		}
+		else
+		{
+			out[0] = l;
+			out[1] = r;
+			for (int c = 2; c < channels; c++)
+				out[c] = 0;
+		}
+		out += channels;
+	}
+	music->ring_read.store(read + taken, std::memory_order_release);
+	if (taken < frames)
+		music->underruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MusicStream::run()
+{
+	HEAP_TAG_SCOPE(AUDIO);
+	// wakes up a few times per ring length to top it up
+	const auto refill_interval = std::chrono::milliseconds(std::max<long long>(1, (long long)RING_FRAMES * 250 / device_rate));
+	std::vector<Request> handling;
+	unsigned int reported_underruns = 0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (running)
+	{
+		std::swap(handling, requests);
+		lock.unlock();
+
+		for (const Request& request : handling)
+			handle(request);
+		handling.clear();
+
+		size_t free_frames = RING_FRAMES - (ring_write.load(std::memory_order_relaxed) - ring_read.load(std::memory_order_acquire));
+		while (free_frames >= CHUNK_FRAMES)
+		{
+			fill(CHUNK_FRAMES);
+			free_frames -= CHUNK_FRAMES;
+			// the spare deck went quiet, the track waiting for it can start
+			if (has_deferred && !decks[1 - current].active)
+			{
+				has_deferred = false;
+				begin(deferred);
+			}
+		}
+
+		unsigned int total_underruns = underruns.load(std::memory_order_relaxed);
+		if (total_underruns != reported_underruns)
+		{
+			LOG_EVERY_MS(1000, WARN, AUDIO, "Music stream ran dry %u times", total_underruns);
+			reported_underruns = total_underruns;
+		}
+
+		lock.lock();
+		wake.wait_for(lock, refill_interval, [this]() { return !requests.empty() || !running; });
+	}
+}
+
+void MusicStream::handle(const Request& request)
+{
+	// only the latest request counts
+	has_deferred = false;
+	if (request.path.empty())
+	{
+		fade_out_deck(decks[current], fade_frames(request.fade_ms));
+		return;
+	}
+
+	// the other deck may still be fading out an older track; cutting it off
+	// mid-waveform clicks, so it is faded down quickly and the track waits
+	Deck& spare = decks[1 - current];
+	if (spare.active)
+	{
+		int declick_frames = fade_frames(DECLICK_MS);
+		spare.gain_step = std::min(spare.gain_step, -std::max(spare.gain, 1e-6f) / declick_frames);
+		deferred = request;
+		has_deferred = true;
+		return;
+	}
+	begin(request);
+}
+
+void MusicStream::fade_out_deck(Deck& deck, int frames)
+{
+	if (deck.active && deck.gain > 0.f)
+	{
+		deck.gain_step = -deck.gain / frames;
+	}
+	else
+	{
+		deck.active = false;
+		deck.stream.close();
+	}
+}
+
+void MusicStream::begin(const Request& request)
+{
+	Deck& incoming = decks[1 - current];
+	// opened before anything changes, so a track that fails to open leaves the current one playing
+	if (!incoming.stream.open(request.path))
+	{
+		LOG_ERROR(AUDIO, "Could not stream %s", request.path.c_str());
+		return;
+	}
+	LOG_DEBUG(AUDIO, "Streaming %s, %.1f KB of decoder state", request.path.c_str(), incoming.stream.memory_bytes() / 1024.f);
+	int frames = fade_frames(request.fade_ms);
+	fade_out_deck(decks[current], frames);
+	current = 1 - current;
+	incoming.active = true;
+	incoming.gain = 0.f;
+	incoming.gain_step = 1.f / frames;
+	incoming.chunk_frame = incoming.chunk.size() / 2;
+	incoming.step = (double)incoming.stream.rate() / device_rate;
+	incoming.phase = 0.0;
+	incoming.pull_frame();
+	incoming.pull_frame();
+}
+
+void MusicStream::fill(size_t frames)
+{
+	std::fill(mix_buffer.begin(), mix_buffer.begin() + frames * 2, 0.f);
+	for (Deck& deck : decks)
+	{
+		if (!deck.active)
+			continue;
+		for (size_t i = 0; i < frames; i++)
+		{
+			while (deck.phase >= 1.0)
+			{
+				deck.pull_frame();
+				deck.phase -= 1.0;
+			}
+			float t = (float)deck.phase;
+			mix_buffer[i * 2] += (deck.previous[0] + (deck.next[0] - deck.previous[0]) * t) * deck.gain;
+			mix_buffer[i * 2 + 1] += (deck.previous[1] + (deck.next[1] - deck.previous[1]) * t) * deck.gain;
+			deck.phase += deck.step;
+			deck.gain = clamp(deck.gain + deck.gain_step, 0.f, 1.f);
+		}
+		if (deck.stream.failed())
+			LOG_ERROR(AUDIO, "Music stream stopped, reading the track failed");
+		// faded out, or nothing left to play
+		if ((deck.gain_step < 0.f && deck.gain <= 0.f) || deck.stream.failed())
+		{
+			deck.active = false;
+			deck.stream.close();
+		}
+	}
+
+	size_t write = ring_write.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < frames; i++)
+	{
+		size_t at = ((write + i) & (RING_FRAMES - 1)) * 2;
+		ring[at] = mix_buffer[i * 2];
+		ring[at + 1] = mix_buffer[i * 2 + 1];
+	}
+	ring_write.store(write + frames, std::memory_order_release);
+}
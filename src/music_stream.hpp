@@ -0,0 +1,210 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "vorbis_decoder.hpp"
+
+// stlib
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+// Reads the sample data of a PCM or float WAV a chunk at a time instead of
+// loading it whole, starting over when it reaches the end.
+class WavStream
+{
+public:
+	// Parses the header; false if the file is missing or not a format we read
+	bool open(const std::string& path);
+	void close();
+	bool is_open() const { return file != nullptr; }
+	int rate() const { return sample_rate; }
+
+	// Fills out with frames interleaved stereo frames, looping at the end of the
+	// data. A pass over the data that yields nothing marks the stream failed,
+	// from then on it reads silence.
+	void read(float* out, size_t frames);
+	bool failed() const { return dead; }
+
+	~WavStream() { close(); }
+
+private:
+	FILE* file = nullptr;
+	long data_start = 0;
+	size_t data_bytes = 0;
+	size_t data_read = 0;
+	int channels = 0;
+	int bits = 0;
+	bool is_float = false;
+	int sample_rate = 0;
+	bool read_since_rewind = false;
+	bool dead = false;
+	std::vector<unsigned char> raw;
+};
+
+// Reads an Ogg Vorbis file a page at a time and decodes its packets as the
+// samples are asked for, starting over when it reaches the end. Same calls
+// as WavStream; only the header packets are kept whole.
+class OggStream
+{
+public:
+	// Reads the three Vorbis headers; false if the file is missing or not a stream we decode
+	bool open(const std::string& path);
+	void close();
+	bool is_open() const { return file != nullptr; }
+	int rate() const { return decoder.rate(); }
+
+	// Like WavStream::read: looping stereo frames, silence once failed
+	void read(float* out, size_t frames);
+	bool failed() const { return dead; }
+	// Decoder tables and page buffers of the open file
+	size_t memory_bytes() const;
+
+	~OggStream() { close(); }
+
+private:
+	// the next page of our logical stream, into page and segments
+	bool read_page();
+	// the next whole packet, which may span pages; false at the end of the file
+	bool read_packet();
+	// back to the first audio packet
+	bool rewind();
+	// decodes packets until some frames are ready, looping at the end
+	bool decode_more();
+
+	FILE* file = nullptr;
+	VorbisDecoder decoder;
+	unsigned int serial = 0;
+	// where the first audio packet starts: the page and the segment on it
+	long audio_page = 0;
+	int audio_segment = 0;
+
+	// current page
+	long page_start = 0;
+	std::vector<unsigned char> page;
+	unsigned char segments[255] = {};
+	int segment_count = 0;
+	int segment_next = 0;
+	size_t page_next = 0;
+	long long page_granule = -1;
+	bool page_last = false;
+
+	std::vector<unsigned char> packet;
+	// frames since the first audio packet; the last page's granule position
+	// says how many of its frames are real
+	long long decoded = 0;
+	int ready = 0;
+	int ready_next = 0;
+	bool read_since_rewind = false;
+	bool dead = false;
+};
+
+// A music track, read by WavStream or OggStream depending on its extension
+class TrackStream
+{
+public:
+	bool open(const std::string& path);
+	void close();
+	int rate() const { return is_ogg ? ogg.rate() : wav.rate(); }
+	void read(float* out, size_t frames);
+	bool failed() const { return is_ogg ? ogg.failed() : wav.failed(); }
+	size_t memory_bytes() const { return is_ogg ? ogg.memory_bytes() : 0; }
+
+private:
+	WavStream wav;
+	OggStream ogg;
+	bool is_ogg = false;
+};
+
+// Music played through the mixer's music hook instead of Mix_Music, so two
+// tracks can crossfade. A worker thread opens and reads the tracks, resamples
+// them to the device rate and mixes them into a ring buffer a little ahead of
+// the device; the mixer callback only copies out of the ring. Requests from
+// the game thread are queued and return at once. Memory is the fixed ring,
+// mix and chunk buffers (88 KB), plus an Ogg track's decoder tables while it
+// plays, whatever the length of the tracks.
+class MusicStream
+{
+public:
+	// Hooks the music slot and starts the worker; call after Mix_OpenAudio
+	bool start();
+	// Unhooks and joins the worker; call before Mix_CloseAudio
+	void stop();
+
+	// Crossfades from whatever plays now to path, looping, over fade_ms
+	void play(const std::string& path, int fade_ms);
+	void fade_out(int fade_ms);
+	// 0 to 1, applied as the device pulls samples so muting is immediate
+	void set_volume(float volume) { master_volume = volume; }
+
+	// Whether path can be streamed, reading the headers only
+	static bool can_play(const std::string& path);
+	// Sample buffers held by the stream
+	size_t memory_bytes() const;
+
+	~MusicStream() { stop(); }
+
+private:
+	// One of the two tracks being crossfaded
+	struct Deck
+	{
+		TrackStream stream;
+		bool active = false;
+		float gain = 0.f;
+		float gain_step = 0.f;
+		// source frames at the file's rate, and the linear resampler over them
+		std::vector<float> chunk;
+		size_t chunk_frame = 0;
+		double phase = 0.0;
+		double step = 1.0;
+		float previous[2] = { 0.f, 0.f };
+		float next[2] = { 0.f, 0.f };
+
+		void pull_frame();
+	};
+
+	struct Request
+	{
+		std::string path;
+		int fade_ms = 0;
+	};
+
+	static void mix(void* self, Uint8* stream, int length);
+	void run();
+	void handle(const Request& request);
+	// crossfades from the current deck to request's track on the spare one
+	void begin(const Request& request);
+	void fade_out_deck(Deck& deck, int frames);
+	void fill(size_t frames);
+	int fade_frames(int fade_ms) const;
+
+	// worker side
+	Deck decks[2];
+	int current = 0;
+	std::vector<float> mix_buffer;
+	// a track waiting for the spare deck to finish fading out
+	Request deferred;
+	bool has_deferred = false;
+
+	// mixer side, written by the worker and read by the device callback
+	std::vector<float> ring;
+	std::atomic<size_t> ring_read{ 0 };
+	std::atomic<size_t> ring_write{ 0 };
+	std::atomic<unsigned int> underruns{ 0 };
+	std::atomic<float> master_volume{ 1.f };
+	int device_rate = 0;
+	int device_channels = 0;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Request> requests;
+	bool running = false;
+};
@@ -0,0 +1,76 @@
+// Header
+#include "particle_system.hpp"
+
+namespace
+{
+	// Make sure these remain in sync with PARTICLE_EFFECT
+	const std::array<ParticleEffect, particle_effect_count> PARTICLE_EFFECTS = { {
+		// HIT: short bright sparks
+		{ 80, 0.35f, { 150.f, 450.f }, 0.f, 2.f * M_PI, 600.f, { 5.f, 1.f },
+			{ 1.f, 1.f, 0.8f }, { 1.f, 0.5f, 0.1f }, { 4.f, 4.f }, true },
+		// DEATH: slow, drifting ash
+		{ 400, 1.2f, { 20.f, 160.f }, -M_PI / 2, 2.f * M_PI, -60.f, { 7.f, 2.f },
+			{ 0.6f, 0.6f, 0.65f }, { 0.15f, 0.1f, 0.2f }, { 20.f, 30.f }, false },
+		// EXPLOSION
+		{ 1500, 0.8f, { 50.f, 600.f }, 0.f, 2.f * M_PI, 300.f, { 10.f, 2.f },
+			{ 1.f, 0.9f, 0.4f }, { 0.8f, 0.15f, 0.05f }, { 10.f, 10.f }, true },
+		// LAVA: embers thrown up out of the pit
+		{ 600, 1.5f, { 300.f, 900.f }, -M_PI / 2, 0.6f, 900.f, { 6.f, 2.f },
+			{ 1.f, 0.7f, 0.2f }, { 0.6f, 0.05f, 0.f }, { 60.f, 10.f }, true },
+		// TELEPORT: a ring bursting outwards
+		{ 800, 0.6f, { 280.f, 320.f }, 0.f, 2.f * M_PI, 0.f, { 6.f, 1.f },
+			{ 0.8f, 0.5f, 1.f }, { 0.3f, 0.f, 0.6f }, { 5.f, 5.f }, true },
+	} };
+}
+
+const ParticleEffect& ParticleSystem::effect(PARTICLE_EFFECT id)
+{
+	return PARTICLE_EFFECTS[(int)id];
+}
+
+void ParticleSystem::emit(PARTICLE_EFFECT id, vec2 position, float scale)
+{
+	ParticleEmitter* slot = &pool[0];
+	for (ParticleEmitter& emitter : pool)
+	{
+		if (!emitter.active) {
+			slot = &emitter;
+			break;
+		}
+		if (emitter.spawn_time < slot->spawn_time)
+			slot = &emitter;
+	}
+
+	slot->effect = id;
+	slot->origin = position;
+	slot->scale = scale;
+	slot->spawn_time = clock;
+	slot->seed = next_seed++;
+	slot->active = true;
+}
+
+void ParticleSystem::step(float elapsed_ms)
+{
+	clock += elapsed_ms / 1000.f;
+	for (ParticleEmitter& emitter : pool)
+	{
+		if (emitter.active && clock - emitter.spawn_time > effect(emitter.effect).lifetime)
+			emitter.active = false;
+	}
+}
+
+bool ParticleSystem::any_active() const
+{
+	for (const ParticleEmitter& emitter : pool)
+	{
+		if (emitter.active)
+			return true;
+	}
+	return false;
+}
+
+void ParticleSystem::clear()
+{
+	for (ParticleEmitter& emitter : pool)
+		emitter.active = false;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <array>
+
+enum class PARTICLE_EFFECT
+{
+	HIT = 0,
+	DEATH = HIT + 1,
+	EXPLOSION = DEATH + 1,
+	LAVA = EXPLOSION + 1,
+	TELEPORT = LAVA + 1,
+	PARTICLE_EFFECT_COUNT = TELEPORT + 1
+};
+const int particle_effect_count = (int)PARTICLE_EFFECT::PARTICLE_EFFECT_COUNT;
+
+// How the particles of a burst move and look. Each particle picks its
+// direction, speed and lifetime from a hash of its index and the burst seed,
+// so the vertex shader derives its whole state from the burst's age.
+struct ParticleEffect
+{
+	int count;
+	float lifetime;  // seconds, each particle lives 50-100% of it
+	vec2 speed;      // px/s, min and max
+	float direction; // radians, centre of the spread
+	float spread;    // radians
+	float gravity;   // px/s^2
+	vec2 size;       // px, at birth and at death
+	vec3 color_start;
+	vec3 color_end;
+	vec2 area;       // half extents of the spawn rectangle
+	bool additive;
+};
+
+// One burst, drawn as a single instanced call; no per-particle CPU state
+struct ParticleEmitter
+{
+	PARTICLE_EFFECT effect = PARTICLE_EFFECT::HIT;
+	vec2 origin = { 0.f, 0.f };
+	float scale = 1.f;
+	float spawn_time = 0.f;
+	unsigned int seed = 0;
+	bool active = false;
+};
+
+const int MAX_PARTICLE_EMITTERS = 64;
+
+// Fixed pool of emitters on a clock that only runs with the game, so
+// particles freeze on pause. Emitting never allocates; with the pool full the
+// oldest burst is recycled.
+class ParticleSystem
+{
+public:
+	void emit(PARTICLE_EFFECT effect, vec2 position, float scale = 1.f);
+	void step(float elapsed_ms);
+	void clear();
+
+	float time() const { return clock; }
+	bool any_active() const;
+	const std::array<ParticleEmitter, MAX_PARTICLE_EMITTERS>& emitters() const { return pool; }
+	static const ParticleEffect& effect(PARTICLE_EFFECT id);
+
+private:
+	std::array<ParticleEmitter, MAX_PARTICLE_EMITTERS> pool;
+	float clock = 0.f;
+	unsigned int next_seed = 1;
+};
@@ -2,6 +2,7 @@
 #include <iostream>
 #include "physics_system.hpp"
 #include "world_init.hpp"
+#include "frame_arena.hpp"
 
 const float COLLISION_THRESHOLD = 0.0f;
 
@@ -32,7 +33,7 @@ bool check_collision_conditions(Entity entity_i, Entity entity_j) {
         }
     } else if (registry.blocks.has(entity_i) && (registry.solids.has(entity_j) || registry.projectiles.has(entity_j))) {
         return true;
-    } else if (registry.parallaxBackgrounds.has(entity_i) || registry.blocks.has(entity_i)) {
+    } else if (registry.lava.has(entity_i) || registry.blocks.has(entity_i)) {
         if (registry.bullets.has(entity_j) ||
             registry.rockets.has(entity_j) ||
             registry.grenades.has(entity_j) ||
@@ -94,29 +95,32 @@ bool precise_collision(const Entity& entity1, const Entity& entity2) {
     CollisionMesh* mesh1 = registry.collisionMeshPtrs.get(entity1);
     CollisionMesh* mesh2 = registry.collisionMeshPtrs.get(entity2);
     
-    std::vector<ColoredVertex> vertices1 = mesh1->vertices;
+    // world space positions, only for this test
+    frame_vector<vec3> vertices1;
+    vertices1.reserve(mesh1->vertices.size());
     mat2 rotation_matrix1 = mat2({cos(motion1.angle), -sin(motion1.angle)}, {sin(motion1.angle), cos(motion1.angle)});
-    for (ColoredVertex& vertex: vertices1) {
-        vertex.position = vec3(motion1.position + (motion1.positionOffset + vec2(vertex.position.x * motion1.scale.x, vertex.position.y * motion1.scale.y)) * rotation_matrix1, 0);
+    for (const ColoredVertex& vertex: mesh1->vertices) {
+        vertices1.push_back(vec3(motion1.position + (motion1.positionOffset + vec2(vertex.position.x * motion1.scale.x, vertex.position.y * motion1.scale.y)) * rotation_matrix1, 0));
     }
     
-    std::vector<ColoredVertex> vertices2 = mesh2->vertices;
+    frame_vector<vec3> vertices2;
+    vertices2.reserve(mesh2->vertices.size());
     mat2 rotation_matrix2 = mat2({cos(motion2.angle), -sin(motion2.angle)}, {sin(motion2.angle), cos(motion2.angle)});
-    for (ColoredVertex& vertex: vertices2) {
-        vertex.position = vec3(motion2.position + (motion2.positionOffset + vec2(vertex.position.x * motion2.scale.x, vertex.position.y * motion2.scale.y)) * rotation_matrix2, 0);
+    for (const ColoredVertex& vertex: mesh2->vertices) {
+        vertices2.push_back(vec3(motion2.position + (motion2.positionOffset + vec2(vertex.position.x * motion2.scale.x, vertex.position.y * motion2.scale.y)) * rotation_matrix2, 0));
     }
 
     for (std::pair<int, int> edge1: mesh1->edges) {
         for (std::pair<int, int> edge2: mesh2->edges) {
-            if (check_intersection(vertices1[edge1.first - 1].position, vertices1[edge1.second - 1].position, vertices2[edge2.first - 1].position, vertices2[edge2.second - 1].position))
+            if (check_intersection(vertices1[edge1.first - 1], vertices1[edge1.second - 1], vertices2[edge2.first - 1], vertices2[edge2.second - 1]))
                 return true;
         }
-        if (check_inside(vertices1[edge1.first - 1].position, vertices1[edge1.second - 1].position, motion1.position + motion1.positionOffset * rotation_matrix1, motion2.position + motion2.positionOffset * rotation_matrix2))
+        if (check_inside(vertices1[edge1.first - 1], vertices1[edge1.second - 1], motion1.position + motion1.positionOffset * rotation_matrix1, motion2.position + motion2.positionOffset * rotation_matrix2))
             return true;
     }
 
     for (std::pair<int, int> edge2: mesh2->edges) {
-        if (check_inside(vertices2[edge2.first - 1].position, vertices2[edge2.second - 1].position, motion2.position + motion2.positionOffset * rotation_matrix2, motion1.position + motion1.positionOffset * rotation_matrix1))
+        if (check_inside(vertices2[edge2.first - 1], vertices2[edge2.second - 1], motion2.position + motion2.positionOffset * rotation_matrix2, motion1.position + motion1.positionOffset * rotation_matrix1))
             return true;
     }
 
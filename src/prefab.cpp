@@ -0,0 +1,45 @@
+// Header
+#include "prefab.hpp"
+
+Entity Prefab::spawn(vec2 position) const
+{
+	// single spawns grow the containers one push_back at a time, no batch to reserve for
+	return instantiate(position, 0, nullptr);
+}
+
+std::vector<Entity> Prefab::spawn_n(const std::vector<vec2>& positions, const SetUp& set_up) const
+{
+	size_t n = positions.size();
+	registry.motions.reserve_more(n);
+	for (const std::unique_ptr<Part>& part : parts)
+		part->reserve(n);
+
+	std::vector<Entity> spawned;
+	spawned.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		spawned.push_back(instantiate(positions[i], i, set_up));
+	return spawned;
+}
+
+Entity Prefab::instantiate(vec2 position, size_t index, const SetUp& set_up) const
+{
+	Entity entity;
+	Motion& instance = place(entity, position);
+	if (set_up)
+		set_up(index, instance);
+	insert_parts(entity);
+	return entity;
+}
+
+Motion& Prefab::place(Entity entity, vec2 position) const
+{
+	Motion& instance = registry.motions.insert(entity, motion);
+	instance.position = position;
+	return instance;
+}
+
+void Prefab::insert_parts(Entity entity) const
+{
+	for (const std::unique_ptr<Part>& part : parts)
+		part->insert(entity);
+}
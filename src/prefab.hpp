@@ -0,0 +1,73 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <functional>
+#include <memory>
+#include <vector>
+
+// The components one kind of entity starts with, written down once and
+// copied onto every instance. spawn_n reserves room in each container for the
+// whole batch before inserting, so a burst of spawns grows every container at
+// most once.
+class Prefab
+{
+public:
+	// Per instance adjustments, the index is into the positions passed to spawn_n
+	using SetUp = std::function<void(size_t index, Motion& motion)>;
+
+	// The motion every instance starts from; spawn_n only sets its position
+	Motion motion;
+
+	template <typename Component>
+	Prefab& with(ComponentContainer<Component>& container, Component component = Component())
+	{
+		// prefabs are built on first use, often mid-game; they are kept like the containers
+		HEAP_TAG_SCOPE(ECS);
+		parts.emplace_back(new ComponentPart<Component>(container, std::move(component)));
+		return *this;
+	}
+
+	Entity spawn(vec2 position) const;
+	// One instance adjusted by set_up(motion), called directly rather than
+	// through a SetUp so a single spawn builds no vector or std::function
+	template <typename SetUpOne>
+	Entity spawn(vec2 position, SetUpOne set_up) const
+	{
+		Entity entity;
+		set_up(place(entity, position));
+		insert_parts(entity);
+		return entity;
+	}
+	std::vector<Entity> spawn_n(const std::vector<vec2>& positions, const SetUp& set_up = nullptr) const;
+
+private:
+	Entity instantiate(vec2 position, size_t index, const SetUp& set_up) const;
+	Motion& place(Entity entity, vec2 position) const;
+	void insert_parts(Entity entity) const;
+
+	struct Part
+	{
+		virtual ~Part() = default;
+		virtual void reserve(size_t n) = 0;
+		virtual void insert(Entity entity) = 0;
+	};
+
+	template <typename Component>
+	struct ComponentPart : Part
+	{
+		ComponentPart(ComponentContainer<Component>& container, Component component)
+			: container(container), component(std::move(component)) {}
+		void reserve(size_t n) override { container.reserve_more(n); }
+		void insert(Entity entity) override { container.insert(entity, component); }
+
+		ComponentContainer<Component>& container;
+		Component component;
+	};
+
+	std::vector<std::unique_ptr<Part>> parts;
+};
@@ -0,0 +1,88 @@
+// Header
+#include "profiler.hpp"
+
+// stlib
+#include <mutex>
+#include <cstdio>
+
+namespace
+{
+	std::mutex profiler_mutex;
+	ProfileStats sections;
+	ProfileStats counters;
+
+	void accumulate(ProfileStat& stat, float value)
+	{
+		stat.count++;
+		stat.last_ms = value;
+		stat.total_ms += value;
+		stat.max_ms = (value > stat.max_ms) ? value : stat.max_ms;
+	}
+
+	ProfileStat& stat_of(ProfileStats& stats, const char* name)
+	{
+		auto found = stats.find(name);
+		if (found == stats.end())
+			found = stats.emplace(name, ProfileStat()).first;
+		return found->second;
+	}
+}
+
+void profiler_record(const char* name, float ms)
+{
+	std::lock_guard<std::mutex> lock(profiler_mutex);
+	accumulate(stat_of(sections, name), ms);
+}
+
+ProfileStats profiler_stats()
+{
+	std::lock_guard<std::mutex> lock(profiler_mutex);
+	return sections;
+}
+
+void profiler_count(const char* name, float value)
+{
+	std::lock_guard<std::mutex> lock(profiler_mutex);
+	accumulate(stat_of(counters, name), value);
+}
+
+ProfileStats profiler_counters()
+{
+	std::lock_guard<std::mutex> lock(profiler_mutex);
+	return counters;
+}
+
+void profiler_print()
+{
+	ProfileStats stats = profiler_stats();
+	printf("%-28s %8s %10s %10s %10s\n", "section", "count", "last ms", "avg ms", "max ms");
+	for (auto& s : stats)
+	{
+		const ProfileStat& stat = s.second;
+		printf("%-28s %8u %10.3f %10.3f %10.3f\n", s.first.c_str(), stat.count,
+			stat.last_ms, stat.total_ms / (float) stat.count, stat.max_ms);
+	}
+
+	ProfileStats counts = profiler_counters();
+	if (counts.empty())
+		return;
+	printf("%-28s %8s %10s %10s %10s\n", "counter", "frames", "last", "avg", "max");
+	for (auto& s : counts)
+	{
+		const ProfileStat& stat = s.second;
+		printf("%-28s %8u %10.0f %10.1f %10.0f\n", s.first.c_str(), stat.count,
+			stat.last_ms, stat.total_ms / (float) stat.count, stat.max_ms);
+	}
+}
+
+ScopedTimer::ScopedTimer(const char* name)
+	: name(name), start(std::chrono::high_resolution_clock::now())
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+	auto end = std::chrono::high_resolution_clock::now();
+	float ms = (float) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.f;
+	profiler_record(name, ms);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// stlib
+#include <chrono>
+#include <functional>
+#include <string>
+#include <map>
+
+// Accumulated timings for one named section
+struct ProfileStat
+{
+	unsigned int count = 0;
+	float last_ms = 0.f;
+	float total_ms = 0.f;
+	float max_ms = 0.f;
+};
+
+// Sections by name; the transparent comparator looks names up without
+// building a std::string, so only the first sample of a name allocates
+using ProfileStats = std::map<std::string, ProfileStat, std::less<>>;
+
+// Records a single sample for the named section. Safe to call from any thread.
+void profiler_record(const char* name, float ms);
+
+// Copy of all sections recorded so far
+ProfileStats profiler_stats();
+
+// Records a per-frame count (draw calls, ...) under name, kept apart from timings
+void profiler_count(const char* name, float value);
+ProfileStats profiler_counters();
+
+// Prints count / last / avg / max of every section and counter to stdout
+void profiler_print();
+
+// Times the enclosing scope and records it under name
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(const char* name);
+	~ScopedTimer();
+
+private:
+	const char* name;
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+#define PROFILE_SCOPE(name) ScopedTimer _profile_scope_timer(name)
@@ -0,0 +1,50 @@
+// Header
+#include "projectile_pool.hpp"
+
+ProjectilePool projectile_pool;
+
+void ProjectilePool::release(Entity projectile)
+{
+	if (registry.waterBalls.has(projectile))
+	{
+		// moved out first, removing it would free the buffers
+		spare_water_balls.push_back(std::move(registry.waterBalls.get(projectile)));
+	}
+	release_polyline(projectile);
+	registry.remove_all_components_of(projectile);
+}
+
+void ProjectilePool::release_polyline(Entity entity)
+{
+	if (!registry.polylines.has(entity))
+		return;
+	spare_polylines.push_back(std::move(registry.polylines.get(entity)));
+	registry.polylines.remove(entity);
+}
+
+WaterBall& ProjectilePool::add_water_ball(Entity entity)
+{
+	if (spare_water_balls.empty())
+		return registry.waterBalls.emplace(entity);
+
+	WaterBall& water_ball = registry.waterBalls.emplace(entity);
+	WaterBall& spare = spare_water_balls.back();
+	water_ball.points = std::move(spare.points);
+	water_ball.lengths = std::move(spare.lengths);
+	water_ball.points.clear();
+	water_ball.lengths.clear();
+	spare_water_balls.pop_back();
+	return water_ball;
+}
+
+Polyline& ProjectilePool::add_polyline(Entity entity)
+{
+	if (spare_polylines.empty())
+		return registry.polylines.emplace(entity);
+
+	Polyline& polyline = registry.polylines.emplace(entity);
+	polyline.points = std::move(spare_polylines.back().points);
+	polyline.points.clear();
+	spare_polylines.pop_back();
+	return polyline;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <vector>
+
+// Recycles what short-lived projectiles would otherwise allocate. The entity
+// itself is only a counter and the registry recycles its container slots and
+// map nodes, but water balls and aim previews carry point lists: released ones
+// are parked here with their capacity and handed to the next projectile.
+class ProjectilePool
+{
+public:
+	// Removes a projectile, keeping its water ball and polyline buffers
+	void release(Entity projectile);
+	// Removes only the polyline, e.g. an aim preview that was used up
+	void release_polyline(Entity entity);
+
+	// Like emplace, but reusing a released component's buffers when there is one
+	WaterBall& add_water_ball(Entity entity);
+	Polyline& add_polyline(Entity entity);
+
+private:
+	std::vector<WaterBall> spare_water_balls;
+	std::vector<Polyline> spare_polylines;
+};
+
+extern ProjectilePool projectile_pool;
@@ -0,0 +1,119 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+#include "particle_system.hpp"
+
+// stlib
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// One textured or coloured mesh, resolved from its entity's components when
+// the snapshot is taken
+struct RenderItem
+{
+	mat3 transform;
+	EFFECT_ASSET_ID effect;
+	GEOMETRY_BUFFER_ID geometry;
+	// the pressed variant for clicked buttons, HITBOX for debug boxes
+	TEXTURE_ASSET_ID texture;
+	vec3 color;
+	// sprite sheet frame (column, row) and sheet size, only set while animating
+	bool animated = false;
+	vec2 frame = { 0.f, 0.f };
+	vec2 frame_scale = { 1.f, 1.f };
+	// the hero blinks while invulnerable
+	bool player = false;
+	float invulnerable_timer = 0.f;
+	bool health_bar = false;
+	float health_percent = 0.f;
+};
+
+struct TextItem
+{
+	std::string text;
+	vec2 position;
+	FONT font;
+	float height;
+	vec3 color;
+	bool right_aligned;
+};
+
+// One triangle strip of polyline_vertices
+struct PolylineRange
+{
+	GLint first;
+	GLsizei count;
+	vec3 color;
+};
+
+// Everything a frame draws, copied out of the registry so the renderer never
+// reads game state that the simulation may be changing
+struct RenderSnapshot
+{
+	bool pause = false;
+	bool debug = false;
+	int dialogue = 0;
+	float screen_darken_factor = 0.f;
+	// glfwGetFramebufferSize may only be called from the main thread
+	ivec2 framebuffer_size = { 0, 0 };
+
+	std::vector<RenderItem> world;
+	std::vector<RenderItem> dialogue_items;
+	std::vector<RenderItem> on_top;
+	std::vector<RenderItem> debug_items;
+
+	bool parallax = false;
+	float parallax_ms = 0.f;
+
+	bool particles_active = false;
+	float particle_time = 0.f;
+	std::array<ParticleEmitter, MAX_PARTICLE_EMITTERS> particles;
+
+	// already extruded
+	std::vector<vec3> polyline_vertices;
+	std::vector<PolylineRange> polylines;
+
+	// only laid out again when text_generation moves
+	std::vector<TextItem> texts;
+	unsigned int text_generation = 0;
+
+	size_t entity_count = 0;
+};
+
+// Three slots shared by one writer and one reader: the writer fills back()
+// and publishes it, the reader takes the newest published slot. Neither side
+// ever waits for the other; snapshots the reader was too slow for are dropped.
+template <typename T>
+class TripleBuffer
+{
+public:
+	T& back() { return slots[back_index]; }
+	void publish()
+	{
+		back_index = middle.exchange(back_index | FRESH) & INDEX_MASK;
+	}
+
+	// Switches front() to the newest published slot, false if nothing was published since the last call
+	bool acquire()
+	{
+		if ((middle.load() & FRESH) == 0)
+			return false;
+		front_index = middle.exchange(front_index) & INDEX_MASK;
+		return true;
+	}
+	const T& front() const { return slots[front_index]; }
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;
+
+	std::array<T, 3> slots;
+	int back_index = 0;
+	int front_index = 1;
+	// the slot in between, FRESH until the reader took it
+	std::atomic<int> middle{ 2 };
+};
@@ -4,12 +4,56 @@
 #include <SDL.h>
 
 #include "tiny_ecs_registry.hpp"
-
-void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool pause, bool is_debug)
+#include "profiler.hpp"
+
+// stlib
+#include <chrono>
+#include <cstdio>
+
+// Dynamic resolution steps the render scale within these bounds, and only
+// after the GPU time settled for a few frames
+const float MIN_RENDER_SCALE = 0.5f;
+const float RENDER_SCALE_STEP = 0.05f;
+const int RENDER_SCALE_COOLDOWN_FRAMES = 30;
+
+// Debug overlay layout, in window coordinates
+const vec2 OVERLAY_POSITION = { 940.f, 90.f };
+const float OVERLAY_BAR_WIDTH = 200.f; // one frame budget
+const float OVERLAY_ROW_HEIGHT = 14.f;
+const float OVERLAY_TEXT_HEIGHT = 8.f; // debug font at 1:1
+const float OVERLAY_LINE_HEIGHT = 10.f;
+
+// Background layers, back to front in the order the parallax shader blends
+// them. rect is one tile of the texture in world pixels (corner, size),
+// velocity its scroll speed in pixels per second, repeat the axes it tiles on
+struct ParallaxLayer
+{
+	const char* sampler;
+	TEXTURE_ASSET_ID texture;
+	vec4 rect;
+	vec2 velocity;
+	vec2 repeat;
+};
+
+const ParallaxLayer PARALLAX_LAYERS[] = {
+	{ "background_color", TEXTURE_ASSET_ID::BACKGROUND_COLOR, { 0, 0, 1200, 800 }, { 0, 0 }, { 0, 0 } },
+	{ "moon", TEXTURE_ASSET_ID::PARALLAX_MOON, { 0, 0, 1160, 800 }, { 0, 0 }, { 0, 0 } },
+	{ "clouds_far", TEXTURE_ASSET_ID::PARALLAX_CLOUDS_FAR, { 0, 0, 1200, 800 }, { 25, 0 }, { 1, 0 } },
+	{ "clouds_close", TEXTURE_ASSET_ID::PARALLAX_CLOUDS_CLOSE, { 0, 0, 1200, 800 }, { 50, 0 }, { 1, 0 } },
+	{ "rain", TEXTURE_ASSET_ID::PARALLAX_RAIN, { 0, 0, 1200, 800 }, { 200, 600 }, { 1, 1 } },
+	{ "background", TEXTURE_ASSET_ID::BACKGROUND, { 0, 0, 1200, 800 }, { 0, 0 }, { 0, 0 } },
+	// the lava surface lines up with the top of the lava collision box
+	{ "lava", TEXTURE_ASSET_ID::PARALLAX_LAVA, { 0, 35, 1200, 800 }, { 50, 0 }, { 1, 0 } },
+};
+const int PARALLAX_LAYER_COUNT = sizeof(PARALLAX_LAYERS) / sizeof(PARALLAX_LAYERS[0]);
+
+// Resolves everything drawTexturedMesh needs from the entity's components
+void RenderSystem::captureItem(Entity entity, bool pause, bool is_debug, std::vector<RenderItem> &out)
 {
-    assert(registry.renderRequests.has(entity));
-    const RenderRequest &render_request = registry.renderRequests.get(entity);
+	assert(registry.renderRequests.has(entity));
+	const RenderRequest &render_request = registry.renderRequests.get(entity);
 
+	RenderItem item;
 	Motion &motion = registry.motions.get(entity);
 	// Transformation code, see Rendering and Transformation in the template
 	// specification for more info Incrementally updates transformation matrix,
@@ -17,27 +61,65 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool
 	Transform transform;
 	transform.translate(motion.position);
 	transform.rotate(motion.angle);
-    vec2 flip = {motion.dir, 1};
+	vec2 flip = {motion.dir, 1};
 	if (!is_debug) {
-        transform.translate(motion.positionOffset + render_request.offset * flip);
-    } else {
+		transform.translate(motion.positionOffset + render_request.offset * flip);
+	} else {
 		transform.translate(motion.positionOffset);
 	}
 	transform.rotate(motion.globalAngle);
 	transform.scale((is_debug ? motion.scale : render_request.scale) * flip);
+	item.transform = transform.mat;
+
+	item.effect = render_request.used_effect;
+	item.geometry = render_request.used_geometry;
+	item.texture = is_debug ? TEXTURE_ASSET_ID::HITBOX : render_request.used_texture;
+	// pressed texture must be +1 of the unpressed texture
+	if (!is_debug && registry.buttons.has(entity) && registry.buttons.get(entity).clicked)
+		item.texture = (TEXTURE_ASSET_ID)((GLuint)render_request.used_texture + 1);
+	item.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+
+	// does animation if texture has animation and is not DEAD
+	if (registry.animated.has(entity) && !registry.deathTimers.has(entity) && !pause && !is_debug)
+	{
+		const AnimationInfo &info = registry.animated.get(entity);
+		item.animated = true;
+		item.frame = info.frame;
+		item.frame_scale = vec2(info.clip->stateCycleLength, info.clip->states);
+	}
+
+	if (registry.players.has(entity) && !registry.deathTimers.has(entity)) {
+		item.player = true;
+		item.invulnerable_timer = registry.players.get(entity).invulnerable_timer;
+	}
+
+	if (registry.healthBar.has(entity)) {
+		item.health_bar = true;
+		if (registry.enemies.has(registry.healthBar.get(entity).owner)) {
+			Enemies& enemy = registry.enemies.get(registry.healthBar.get(entity).owner);
+			item.health_percent = (float)enemy.health/(float)enemy.total_health;
+		}
+	}
+
+	out.push_back(item);
+}
 
+void RenderSystem::drawTexturedMesh(const RenderItem &item, const mat3 &projection)
+{
+	// Still decoding, skip it for now rather than sampling an empty texture
+	if (item.texture != TEXTURE_ASSET_ID::TEXTURE_COUNT && !texture_ready[(GLuint)item.texture])
+		return;
 
-	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
+	const GLuint used_effect_enum = (GLuint)item.effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
 	const GLuint program = (GLuint)effects[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
+	useProgram(program);
 
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
+	assert(item.geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+	const GLuint vbo = vertex_buffers[(GLuint)item.geometry];
+	const GLuint ibo = index_buffers[(GLuint)item.geometry];
 
 	// Setting vertex and index buffers
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -45,7 +127,7 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool
 	gl_has_errors();
 
 	// Input data location as in the vertex buffer
-	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED || (uint) render_request.used_effect > (uint) EFFECT_ASSET_ID::ANIMATED)
+	if (item.effect == EFFECT_ASSET_ID::TEXTURED || (uint) item.effect > (uint) EFFECT_ASSET_ID::ANIMATED)
 	{
 		GLint in_position_loc = glGetAttribLocation(program, "in_position");
 		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
@@ -63,62 +145,30 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool
 			(void *)sizeof(
 				vec3)); // note the stride to skip the preceeding vertex position
 
-        // does animation if texture has animation and is not DEAD
-		if (registry.animated.has(entity) && !registry.deathTimers.has(entity) && !pause && !is_debug)
+		if (item.animated)
 		{
-			AnimationInfo &info = registry.animated.get(entity);
-			GLint frame_loc = glGetUniformLocation(program, "frame");
-            if (info.oneTimeState != -1) {
-                int count = (int)floor(info.oneTimer * ANIMATION_SPEED_FACTOR);
-                if (count < info.stateFrameLength[info.oneTimeState]) {
-                    glUniform2f(frame_loc, count % info.stateFrameLength[info.oneTimeState], info.oneTimeState);
-                } else {
-                    info.oneTimeState = -1;
-					info.oneTimer = 0;
-                }
-            } else {
-                glUniform2f(frame_loc, ((int)floor(glfwGetTime() * ANIMATION_SPEED_FACTOR) % info.stateFrameLength[info.curState]), info.curState);
-            }
-			GLint scale_loc = glGetUniformLocation(program, "scale");
-			glUniform2f(scale_loc, info.stateCycleLength, info.states);
+			glUniform2fv(glGetUniformLocation(program, "frame"), 1, (float *)&item.frame);
+			glUniform2fv(glGetUniformLocation(program, "scale"), 1, (float *)&item.frame_scale);
 		}
 
-		if (registry.players.has(entity) && !registry.deathTimers.has(entity)) {
+		if (item.player) {
 			GLint invulnerable_time_loc = glGetUniformLocation(program, "invulnerable_timer");
-			glUniform1f(invulnerable_time_loc, registry.players.get(entity).invulnerable_timer);
+			glUniform1f(invulnerable_time_loc, item.invulnerable_timer);
 			GLint pi_loc = glGetUniformLocation(program, "M_PI");
 			glUniform1f(pi_loc, M_PI);
 		}
 
-        if (registry.healthBar.has(entity)) {
-            float percent = 0;
-            if (registry.enemies.has(registry.healthBar.get(entity).owner)) {
-                Enemies& enemy = registry.enemies.get(registry.healthBar.get(entity).owner);
-                percent = (float)enemy.health/(float)enemy.total_health;
-            }
-            GLint health_percent_loc = glGetUniformLocation(program, "percent");
-            glUniform1f(health_percent_loc, percent);
-        }
+		if (item.health_bar) {
+			GLint health_percent_loc = glGetUniformLocation(program, "percent");
+			glUniform1f(health_percent_loc, item.health_percent);
+		}
 
 		// Enabling and binding texture to slot 0
 		glActiveTexture(GL_TEXTURE0);
 		gl_has_errors();
-
-		GLuint texture_id = is_debug? texture_gl_handles[(GLuint) TEXTURE_ASSET_ID::HITBOX] :texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-
-        assert(registry.renderRequests.has(entity));
-        if (registry.buttons.has(entity))
-        {
-            GameButton &button = registry.buttons.get(entity);
-            if (button.clicked) {
-                // pressed texture must be +1 of the unpressed texture
-                texture_id = texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture+1];
-            }
-        }
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		gl_has_errors();
+		bindTexture(texture_gl_handles[(GLuint)item.texture]);
 	}
-	else if (render_request.used_effect == EFFECT_ASSET_ID::COLOURED)
+	else if (item.effect == EFFECT_ASSET_ID::COLOURED)
 	{
 		GLint in_position_loc = glGetAttribLocation(program, "in_position");
 		gl_has_errors();
@@ -128,7 +178,7 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool
 							  sizeof(ColoredVertex), (void *)0);
 		gl_has_errors();
 	}
-	else if (render_request.used_effect == EFFECT_ASSET_ID::BULLET)
+	else if (item.effect == EFFECT_ASSET_ID::BULLET)
 	{
 		GLint in_position_loc = glGetAttribLocation(program, "in_position");
 		GLint in_color_loc = glGetAttribLocation(program, "in_color");
@@ -151,7 +201,7 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool
 
 	// Getting uniform locations for glUniform* calls
 	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+	const vec3 color = item.color * overlay_tint;
 	glUniform3fv(color_uloc, 1, (float *)&color);
 	gl_has_errors();
 
@@ -167,186 +217,19 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection, bool
 	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
 	// Setting uniform values to the currently bound program
 	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
+	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&item.transform);
 	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
 	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
 	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
+	drawElements(num_indices);
 }
 
-void RenderSystem::drawDialogueLayer(const mat3 &projection, int dialogue)
-{
-    Transform transform;
-    transform.translate(vec2(window_width_px/2.0, window_height_px/2.0));
-    transform.scale(vec2(window_width_px, window_height_px));
-
-    const GLuint program = (GLuint)effects[(GLuint)EFFECT_ASSET_ID::DIALOGUE_LAYER];
-
-    // Setting shaders
-    glUseProgram(program);
-    gl_has_errors();
-
-    const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
-    const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
-
-    // Setting vertex and index buffers
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    gl_has_errors();
-
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-            in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-            (void *)sizeof(
-                    vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
-
-    GLuint texture_id = texture_gl_handles[(GLuint) TEXTURE_ASSET_ID::BLACK_LAYER];
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    gl_has_errors();
-
-    GLuint dialogue_uloc = glGetUniformLocation(program, "show_dialogue_screen");
-    glUniform1i(dialogue_uloc, dialogue != 0);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-    GLint color_uloc = glGetUniformLocation(program, "fcolor");
-    const vec3 color = vec3(1.f,1.f,1.f);
-    glUniform3fv(color_uloc, 1, (float *)&color);
-    gl_has_errors();
-
-    // Get number of indices from index buffer, which has elements uint16_t
-    GLint size = 0;
-    glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-    gl_has_errors();
-
-    GLsizei num_indices = size / sizeof(uint16_t);
-    // GLsizei num_triangles = num_indices / 3;
-
-    GLint currProgram;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-    // Setting uniform values to the currently bound program
-    GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-    glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-    GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-    glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-    gl_has_errors();
-    // Drawing of num_indices/3 triangles specified in the index buffer
-    glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-    gl_has_errors();
-}
-
-void RenderSystem::drawScreenLayer(const mat3 &projection, bool pause)
-{
-    Transform transform;
-    transform.translate(vec2(window_width_px/2.0, window_height_px/2.0));
-    transform.scale(vec2(window_width_px, window_height_px));
-
-    const GLuint program = (GLuint)effects[(GLuint)EFFECT_ASSET_ID::SCREEN_LAYER];
-
-    // Setting shaders
-    glUseProgram(program);
-    gl_has_errors();
-
-    const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
-    const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
-
-    // Setting vertex and index buffers
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    gl_has_errors();
-
-
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-            in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-            (void *)sizeof(
-                    vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
-
-    GLuint texture_id = texture_gl_handles[(GLuint) TEXTURE_ASSET_ID::BLACK_LAYER];
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    gl_has_errors();
-
-    // Set clock
-    GLuint time_uloc = glGetUniformLocation(program, "time");
-    GLuint dead_timer_uloc = glGetUniformLocation(program, "screen_darken_factor");
-    GLuint pause_uloc = glGetUniformLocation(program, "pause");
-    glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-    ScreenState &screen = registry.screenStates.get(screen_state_entity);
-    glUniform1f(dead_timer_uloc, screen.screen_darken_factor);
-    glUniform1i(pause_uloc, pause);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-    GLint color_uloc = glGetUniformLocation(program, "fcolor");
-    const vec3 color = vec3(1.f,1.f,1.f);
-    glUniform3fv(color_uloc, 1, (float *)&color);
-    gl_has_errors();
-
-    // Get number of indices from index buffer, which has elements uint16_t
-    GLint size = 0;
-    glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-    gl_has_errors();
-
-    GLsizei num_indices = size / sizeof(uint16_t);
-    // GLsizei num_triangles = num_indices / 3;
-
-    GLint currProgram;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-    // Setting uniform values to the currently bound program
-    GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-    glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-    GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-    glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-    gl_has_errors();
-    // Drawing of num_indices/3 triangles specified in the index buffer
-    glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-    gl_has_errors();
-}
-void RenderSystem::drawToScreen()
+// Composites the scene target onto the letterboxed backbuffer
+void RenderSystem::drawToScreen(float brightness)
 {
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::SCREEN]);
-	gl_has_errors();
-	// Clearing backbuffer
-	int w, h;
-    float ox = 0, oy = 0;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-    float aspect_ratio = window_width_px / (float) window_height_px; // 16:9
-    float new_aspect_ratio = w / (float) h;
-    if (aspect_ratio < new_aspect_ratio) {
-        int new_w = h * aspect_ratio;
-        ox = (w-new_w)/2.0;
-        w = new_w;
-    } else {
-        int new_h = w / aspect_ratio;
-        oy = (h-new_h) / 2.0;
-        h = new_h;
-    }
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(ox, oy, w, h);
-	glDepthRange(0, 10);
-    // black bar colors, can be changed
-	glClearColor(0, 0, 0, 1.0);
-	glClearDepth(1.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	gl_has_errors();
-	// Enabling alpha channel for textures
-	glEnable(GL_BLEND);
-	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
+	const GLuint screen_program = effects[(GLuint)EFFECT_ASSET_ID::SCREEN];
+	useProgram(screen_program);
 
 	// Draw the screen texture on the quad geometry
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
@@ -355,100 +238,792 @@ void RenderSystem::drawToScreen()
 		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
 																	 // indices to the bound GL_ARRAY_BUFFER
 	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::SCREEN];
-	gl_has_errors();
 	// Set the vertex position and vertex texture coordinates (both stored in the
 	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
+	GLint in_position_loc = glGetAttribLocation(screen_program, "in_position");
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
 	gl_has_errors();
 
+	// Darkening of the pause, death fade and dialogue overlays, in one go
+	GLint brightness_uloc = glGetUniformLocation(screen_program, "brightness");
+	glUniform1f(brightness_uloc, brightness);
+	// The world only covers frame.scene_size of the target; stay half a texel
+	// inside it so linear filtering doesn't pick up stale pixels when upscaling
+	vec2 target_size = vec2(scene_target_size);
+	vec2 uv_scale = vec2(frame.scene_size) / target_size;
+	vec2 uv_max = (vec2(frame.scene_size) - 0.5f) / target_size;
+	glUniform2fv(glGetUniformLocation(screen_program, "uv_scale"), 1, (float *)&uv_scale);
+	glUniform2fv(glGetUniformLocation(screen_program, "uv_max"), 1, (float *)&uv_max);
+	gl_has_errors();
+
 	// Bind our texture in Texture Unit 0
 	glActiveTexture(GL_TEXTURE0);
 
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	bindTexture(off_screen_render_buffer_color);
+	// Draw, one triangle = 3 vertices
+	drawElements(3);
+}
+
+void RenderSystem::useProgram(GLuint program)
+{
+	if (program == bound_program)
+		return;
+	glUseProgram(program);
 	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-				  // no offset from the bound index buffer
+	bound_program = program;
+	frame_stats.program_switches++;
+}
+
+void RenderSystem::bindTexture(GLuint texture)
+{
+	if (texture == bound_texture)
+		return;
+	glBindTexture(GL_TEXTURE_2D, texture);
 	gl_has_errors();
+	bound_texture = texture;
+	frame_stats.texture_binds++;
 }
 
-// Render our game world
-// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw(bool pause, bool debug, int dialogue)
+void RenderSystem::drawElements(GLsizei num_indices)
 {
-	// Getting size of window
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	// nullptr indicates that there is no offset from the bound index buffer
+	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	gl_has_errors();
+	frame_stats.draw_calls++;
+	frame_stats.vertices += num_indices;
+}
 
-	// First render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+void RenderSystem::drawElementsInstanced(GLsizei num_indices, GLsizei instances)
+{
+	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr, instances);
 	gl_has_errors();
-	// Clearing backbuffer
-	glViewport(0, 0, w, h);
-	glDepthRange(0.00001, 10);
-	glClearColor(0.01f, 0.02f, 0.08f, 1.0f);
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
-							  // and alpha blending, one would have to sort
-							  // sprites back to front
+	frame_stats.draw_calls++;
+	frame_stats.vertices += num_indices * instances;
+}
+
+void RenderSystem::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	gl_has_errors();
+	frame_stats.draw_calls++;
+	frame_stats.vertices += count;
+}
+
+// Every Polyline is extruded into a triangle strip on the CPU when the
+// snapshot is taken; all of them go to the GPU in one upload and each is then
+// a single draw call
+void RenderSystem::capturePolylines(RenderSnapshot &snapshot)
+{
+	snapshot.polyline_vertices.clear();
+	snapshot.polylines.clear();
+	for (const Polyline &line : registry.polylines.components)
+	{
+		size_t count = line.points.size();
+		if (count < 2)
+			continue;
+		snapshot.polylines.push_back({ (GLint)snapshot.polyline_vertices.size(), (GLsizei)count * 2, line.color });
+		for (size_t i = 0; i < count; i++)
+		{
+			// normal of the chord through the neighbours, a cheap join
+			vec2 dir = line.points[i + 1 < count ? i + 1 : i] - line.points[i > 0 ? i - 1 : i];
+			float len = sqrt(dot(dir, dir));
+			vec2 normal = len > 0.f ? vec2(-dir.y, dir.x) * (line.width / 2.f / len) : vec2(0.f);
+			vec2 point = line.origin + line.points[i];
+			snapshot.polyline_vertices.push_back(vec3(point + normal, 0.f));
+			snapshot.polyline_vertices.push_back(vec3(point - normal, 0.f));
+		}
+	}
+}
+
+void RenderSystem::drawPolylines(const RenderSnapshot &snapshot, const mat3 &projection)
+{
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::COLOURED];
+	useProgram(program);
+
+	// respecifying the store lets the driver hand out fresh memory instead of
+	// waiting on last frame's draws
+	glBindBuffer(GL_ARRAY_BUFFER, polyline_vbo);
+	glBufferData(GL_ARRAY_BUFFER, snapshot.polyline_vertices.size() * sizeof(vec3), snapshot.polyline_vertices.data(), GL_STREAM_DRAW);
+	GLint in_position_loc = glGetAttribLocation(program, "in_position");
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
+	glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float *)&projection);
+	gl_has_errors();
+
+	GLint color_uloc = glGetUniformLocation(program, "color");
+	for (const PolylineRange &range : snapshot.polylines)
+	{
+		glUniform3fv(color_uloc, 1, (float *)&range.color);
+		drawArrays(GL_TRIANGLE_STRIP, range.first, range.count);
+	}
+}
+
+// Every live burst is one instanced draw of the sprite quad; particle.vs.glsl
+// places each instance from the burst's age and seed
+void RenderSystem::drawParticles(const RenderSnapshot &snapshot, const mat3 &projection)
+{
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::PARTICLE];
+	useProgram(program);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+	GLint in_position_loc = glGetAttribLocation(program, "in_position");
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
+	glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float *)&projection);
+	gl_has_errors();
+
+	for (const ParticleEmitter &emitter : snapshot.particles)
+	{
+		if (!emitter.active)
+			continue;
+		const ParticleEffect &effect = ParticleSystem::effect(emitter.effect);
+
+		glUniform2fv(glGetUniformLocation(program, "origin"), 1, (float *)&emitter.origin);
+		glUniform1f(glGetUniformLocation(program, "age"), snapshot.particle_time - emitter.spawn_time);
+		glUniform1ui(glGetUniformLocation(program, "seed"), emitter.seed);
+		glUniform1f(glGetUniformLocation(program, "scale"), emitter.scale);
+		glUniform1f(glGetUniformLocation(program, "lifetime"), effect.lifetime);
+		glUniform2fv(glGetUniformLocation(program, "speed"), 1, (float *)&effect.speed);
+		glUniform1f(glGetUniformLocation(program, "direction"), effect.direction);
+		glUniform1f(glGetUniformLocation(program, "spread"), effect.spread);
+		glUniform1f(glGetUniformLocation(program, "gravity"), effect.gravity);
+		glUniform2fv(glGetUniformLocation(program, "size"), 1, (float *)&effect.size);
+		glUniform3fv(glGetUniformLocation(program, "color_start"), 1, (float *)&effect.color_start);
+		glUniform3fv(glGetUniformLocation(program, "color_end"), 1, (float *)&effect.color_end);
+		glUniform2fv(glGetUniformLocation(program, "area"), 1, (float *)&effect.area);
+		gl_has_errors();
+
+		glBlendFunc(GL_SRC_ALPHA, effect.additive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+		drawElementsInstanced(6, effect.count);
+	}
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+// Every background layer in one full-screen triangle, scrolled in the shader
+void RenderSystem::drawParallax(float time_ms)
+{
+	// Still decoding, leave the background black for now
+	for (const ParallaxLayer &layer : PARALLAX_LAYERS)
+		if (!texture_ready[(GLuint)layer.texture])
+			return;
+
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::PARALLAX];
+	useProgram(program);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	GLint in_position_loc = glGetAttribLocation(program, "in_position");
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
+	gl_has_errors();
+
+	vec4 rects[PARALLAX_LAYER_COUNT];
+	vec2 velocities[PARALLAX_LAYER_COUNT];
+	vec2 repeats[PARALLAX_LAYER_COUNT];
+	for (int i = 0; i < PARALLAX_LAYER_COUNT; i++)
+	{
+		rects[i] = PARALLAX_LAYERS[i].rect;
+		velocities[i] = PARALLAX_LAYERS[i].velocity;
+		repeats[i] = PARALLAX_LAYERS[i].repeat;
+	}
+	vec2 world_size = { window_width_px, window_height_px };
+	glUniform2fv(glGetUniformLocation(program, "world_size"), 1, (float *)&world_size);
+	glUniform1f(glGetUniformLocation(program, "time"), time_ms / 1000.f);
+	glUniform4fv(glGetUniformLocation(program, "rects"), PARALLAX_LAYER_COUNT, (float *)rects);
+	glUniform2fv(glGetUniformLocation(program, "velocities"), PARALLAX_LAYER_COUNT, (float *)velocities);
+	glUniform2fv(glGetUniformLocation(program, "repeats"), PARALLAX_LAYER_COUNT, (float *)repeats);
+	gl_has_errors();
+
+	// one texture unit per layer, unit 0 last so bindTexture stays in sync
+	for (int i = PARALLAX_LAYER_COUNT - 1; i >= 0; i--)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glUniform1i(glGetUniformLocation(program, PARALLAX_LAYERS[i].sampler), i);
+		if (i == 0) {
+			bindTexture(texture_gl_handles[(GLuint)PARALLAX_LAYERS[i].texture]);
+		} else {
+			glBindTexture(GL_TEXTURE_2D, texture_gl_handles[(GLuint)PARALLAX_LAYERS[i].texture]);
+			frame_stats.texture_binds++;
+		}
+	}
+	gl_has_errors();
+
+	drawElements(3);
+}
+
+// Untextured sprite quad for the debug overlay, tinted by color
+void RenderSystem::drawOverlayQuad(GLuint texture, vec2 position, vec2 scale, vec3 color, const mat3 &projection)
+{
+	Transform transform;
+	transform.translate(position);
+	transform.scale(scale);
+
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
+	useProgram(program);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+	GLint in_position_loc = glGetAttribLocation(program, "in_position");
+	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
+	glEnableVertexAttribArray(in_texcoord_loc);
+	glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
+	gl_has_errors();
+
+	glActiveTexture(GL_TEXTURE0);
+	bindTexture(texture);
+
+	glUniform3fv(glGetUniformLocation(program, "fcolor"), 1, (float *)&color);
+	glUniformMatrix3fv(glGetUniformLocation(program, "transform"), 1, GL_FALSE, (float *)&transform.mat);
+	glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float *)&projection);
+	gl_has_errors();
+
+	drawElements(6);
+}
+
+bool RenderSystem::textBatchStale()
+{
+	bool stale = text_batch_keys.size() != registry.texts.components.size();
+	for (size_t i = 0; i < registry.texts.components.size(); i++)
+	{
+		Text &text = registry.texts.components[i];
+		TextKey key = { (unsigned int)registry.texts.entities[i], registry.motions.get(registry.texts.entities[i]).position, text.visibility };
+		stale = stale || text.dirty || key.entity != text_batch_keys[i].entity ||
+			key.position != text_batch_keys[i].position || key.visible != text_batch_keys[i].visible;
+	}
+	return stale;
+}
+
+// Copies the visible texts into the snapshot, which only has to happen when
+// one of them changed since this slot was last written
+void RenderSystem::captureTexts(RenderSnapshot &snapshot)
+{
+	if (textBatchStale())
+	{
+		text_batch_keys.clear();
+		for (size_t i = 0; i < registry.texts.components.size(); i++)
+		{
+			Text &text = registry.texts.components[i];
+			Entity entity = registry.texts.entities[i];
+			text_batch_keys.push_back({ (unsigned int)entity, registry.motions.get(entity).position, text.visibility });
+			text.dirty = false;
+		}
+		text_generation++;
+	}
+	if (snapshot.text_generation == text_generation)
+		return;
+
+	snapshot.texts.clear();
+	for (size_t i = 0; i < registry.texts.components.size(); i++)
+	{
+		const Text &text = registry.texts.components[i];
+		if (text.visibility)
+			snapshot.texts.push_back({ text.text, text_batch_keys[i].position, text.font, text.height, text.color, text.right_aligned });
+	}
+	snapshot.text_generation = text_generation;
+}
+
+// All Text entities in one draw call; the quads stay on the GPU until one of
+// them changes
+void RenderSystem::drawText(const RenderSnapshot &snapshot, const mat3 &projection)
+{
+	if (snapshot.text_generation != text_batch_generation || glyphs.revision() != text_batch_revision)
+	{
+		text_vertices.clear();
+		for (const TextItem &text : snapshot.texts)
+			glyphs.layout(text.font, text.text, text.position, text.height, text.color, text.right_aligned, text_vertices);
+		text_batch_generation = snapshot.text_generation;
+		text_batch_revision = glyphs.revision();
+		text_vertex_count = (GLsizei)text_vertices.size();
+		glBindBuffer(GL_ARRAY_BUFFER, text_vbo);
+		glBufferData(GL_ARRAY_BUFFER, text_vertices.size() * sizeof(TextVertex), text_vertices.data(), GL_DYNAMIC_DRAW);
+		gl_has_errors();
+	}
+	drawTextVertices(text_vbo, text_vertex_count, projection);
+}
+
+void RenderSystem::drawTextVertices(GLuint vbo, GLsizei count, const mat3 &projection)
+{
+	if (count == 0)
+		return;
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXT];
+	useProgram(program);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	GLint in_position_loc = glGetAttribLocation(program, "in_position");
+	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
+	GLint in_color_loc = glGetAttribLocation(program, "in_color");
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)0);
+	glEnableVertexAttribArray(in_texcoord_loc);
+	glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)sizeof(vec2));
+	glEnableVertexAttribArray(in_color_loc);
+	glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)(2 * sizeof(vec2)));
+	glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float *)&projection);
+	gl_has_errors();
+
+	glActiveTexture(GL_TEXTURE0);
+	bindTexture(glyphs.texture());
+	drawArrays(GL_TRIANGLES, 0, count);
+
+	// no other effect feeds a colour attribute, don't leave it reading this buffer
+	glDisableVertexAttribArray(in_color_loc);
+}
+
+// One bar per render pass with its GPU time against the frame budget (CPU time
+// as a thin bar below it), labelled with both times. Below: the GL work of the
+// last frame, frame times, entity count and every profiler section
+void RenderSystem::drawStatsOverlay(const mat3 &projection)
+{
+	const vec3 palette[] = {
+		{ 0.3f, 0.6f, 1.f }, { 0.3f, 1.f, 0.5f }, { 1.f, 0.8f, 0.2f }, { 1.f, 0.4f, 0.3f },
+		{ 0.8f, 0.4f, 1.f }, { 0.4f, 1.f, 1.f }, { 1.f, 1.f, 1.f },
+	};
+	const size_t palette_size = sizeof(palette) / sizeof(palette[0]);
+	char line[96];
+
+	overlay_text_vertices.clear();
+	auto print = [&](vec2 position, vec3 color, bool right_aligned) {
+		glyphs.layout(FONT::DEBUG, line, position, OVERLAY_TEXT_HEIGHT, color, right_aligned, overlay_text_vertices);
+	};
+
+	vec2 row = OVERLAY_POSITION;
+	drawOverlayQuad(overlay_texture, row + vec2(OVERLAY_BAR_WIDTH / 2.f, OVERLAY_ROW_HEIGHT * render_graph.size() / 2.f),
+		vec2(OVERLAY_BAR_WIDTH, OVERLAY_ROW_HEIGHT * render_graph.size()), vec3(0.1f), projection);
+	for (size_t i = 0; i < render_graph.size(); i++)
+	{
+		const PassTiming &timing = pass_timings[i];
+		float gpu_width = min(timing.gpu_ms / target_frame_ms, 1.f) * OVERLAY_BAR_WIDTH;
+		float cpu_width = min(timing.cpu_ms / target_frame_ms, 1.f) * OVERLAY_BAR_WIDTH;
+		vec3 color = palette[i % palette_size];
+		drawOverlayQuad(overlay_texture, row + vec2(gpu_width / 2.f, OVERLAY_ROW_HEIGHT * 0.35f), vec2(gpu_width, OVERLAY_ROW_HEIGHT * 0.6f), color, projection);
+		drawOverlayQuad(overlay_texture, row + vec2(cpu_width / 2.f, OVERLAY_ROW_HEIGHT * 0.8f), vec2(cpu_width, OVERLAY_ROW_HEIGHT * 0.2f), color * 0.6f, projection);
+		snprintf(line, sizeof(line), "%s %5.2f %5.2f", render_graph[i].name, timing.gpu_ms, timing.cpu_ms);
+		print(row + vec2(-4.f, (OVERLAY_ROW_HEIGHT - OVERLAY_TEXT_HEIGHT) / 2.f), color, true);
+		row.y += OVERLAY_ROW_HEIGHT;
+	}
+
+	row.y += OVERLAY_LINE_HEIGHT;
+	const vec3 white = vec3(1.f);
+	snprintf(line, sizeof(line), "cpu %5.2f ms  gpu %5.2f ms  scale %.2f", cpu_frame_ms, gpu_frame_ms, render_scale);
+	print(row, white, false);
+	row.y += OVERLAY_LINE_HEIGHT;
+	snprintf(line, sizeof(line), "draws %u  programs %u  textures %u", last_frame_stats.draw_calls,
+		last_frame_stats.program_switches, last_frame_stats.texture_binds);
+	print(row, white, false);
+	row.y += OVERLAY_LINE_HEIGHT;
+	snprintf(line, sizeof(line), "vertices %u  entities %zu", last_frame_stats.vertices, frame.snapshot->entity_count);
+	print(row, white, false);
+	row.y += OVERLAY_LINE_HEIGHT * 2.f;
+
+	// name, last, average and max, as long as they fit on screen
+	const vec3 grey = vec3(0.75f);
+	for (const auto &section : profiler_stats())
+	{
+		if (row.y + OVERLAY_LINE_HEIGHT > window_height_px)
+			break;
+		const ProfileStat &stat = section.second;
+		snprintf(line, sizeof(line), "%-20.20s %6.2f %6.2f %6.2f", section.first.c_str(), stat.last_ms,
+			stat.count > 0 ? stat.total_ms / stat.count : 0.f, stat.max_ms);
+		print(row, grey, false);
+		row.y += OVERLAY_LINE_HEIGHT;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, overlay_text_vbo);
+	glBufferData(GL_ARRAY_BUFFER, overlay_text_vertices.size() * sizeof(TextVertex), overlay_text_vertices.data(), GL_STREAM_DRAW);
+	gl_has_errors();
+	drawTextVertices(overlay_text_vbo, (GLsizei)overlay_text_vertices.size(), projection);
+}
+
+// Largest 16:9 region of the framebuffer, centered, as x, y, width, height
+ivec4 RenderSystem::letterboxViewport(ivec2 framebuffer_size)
+{
+	int w = framebuffer_size.x, h = framebuffer_size.y;
+	int ox = 0, oy = 0;
+	float aspect_ratio = window_width_px / (float) window_height_px; // 16:9
+	float new_aspect_ratio = w / (float) h;
+	if (aspect_ratio < new_aspect_ratio) {
+		int new_w = h * aspect_ratio;
+		ox = (w-new_w)/2;
+		w = new_w;
+	} else {
+		int new_h = w / aspect_ratio;
+		oy = (h-new_h)/2;
+		h = new_h;
+	}
+	return ivec4(ox, oy, w, h);
+}
+
+void RenderSystem::resizeSceneTarget(ivec2 size)
+{
+	if (size == scene_target_size)
+		return;
+	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	bound_texture = off_screen_render_buffer_color;
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	gl_has_errors();
+	scene_target_size = size;
+	scene_target_bytes = (size_t)size.x * size.y * 4;
+}
+
+void RenderSystem::bindRenderTarget(RENDER_TARGET target)
+{
+	if (target == RENDER_TARGET::SCENE) {
+		resizeSceneTarget(ivec2(screen_viewport.z, screen_viewport.w));
+		glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+		glViewport(0, 0, frame.scene_size.x, frame.scene_size.y);
+		glClearColor(0, 0, 0, 1.0);
+		glClear(GL_COLOR_BUFFER_BIT);
+	} else {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(screen_viewport.x, screen_viewport.y, screen_viewport.z, screen_viewport.w);
+	}
+	gl_has_errors();
+}
+
+void RenderSystem::buildRenderGraph()
+{
+	auto always = [](const FrameContext&) { return true; };
+
+	render_graph = {
+		{ "background", RENDER_TARGET::SCENE,
+			[](const FrameContext& f) { return f.snapshot->parallax; },
+			[this](const FrameContext& f) { drawParallax(f.snapshot->parallax_ms); } },
+		{ "entities", RENDER_TARGET::SCENE, always,
+			[this](const FrameContext& f) {
+				for (const RenderItem &item : f.snapshot->world)
+					drawTexturedMesh(item, f.projection);
+				if (!f.snapshot->polylines.empty())
+					drawPolylines(*f.snapshot, f.projection);
+			} },
+		{ "particles", RENDER_TARGET::SCENE,
+			[](const FrameContext& f) { return f.snapshot->particles_active; },
+			[this](const FrameContext& f) { drawParticles(*f.snapshot, f.projection); } },
+		// pause, death fade and dialogue darkening of the world
+		{ "composite", RENDER_TARGET::BACKBUFFER,
+			[](const FrameContext& f) { return f.post_effects; },
+			[this](const FrameContext& f) { drawToScreen(f.world_brightness); } },
+		{ "dialogue", RENDER_TARGET::BACKBUFFER,
+			[](const FrameContext& f) { return !f.snapshot->dialogue_items.empty(); },
+			[this](const FrameContext& f) {
+				// still darkened by the pause and death fade, which used to be drawn over it
+				overlay_tint = vec3(f.overlay_brightness);
+				for (const RenderItem &item : f.snapshot->dialogue_items)
+					drawTexturedMesh(item, f.projection);
+				overlay_tint = vec3(1.f);
+			} },
+		// HUD, drawn on top of the screen effects
+		{ "on top", RENDER_TARGET::BACKBUFFER, always,
+			[this](const FrameContext& f) {
+				for (const RenderItem &item : f.snapshot->on_top)
+					drawTexturedMesh(item, f.projection);
+				if (!f.snapshot->texts.empty())
+					drawText(*f.snapshot, f.projection);
+			} },
+		{ "debug", RENDER_TARGET::BACKBUFFER,
+			[](const FrameContext& f) { return f.debug; },
+			[this](const FrameContext& f) {
+				for (const RenderItem &item : f.snapshot->debug_items)
+					drawTexturedMesh(item, f.projection);
+			} },
+		{ "overlay", RENDER_TARGET::BACKBUFFER,
+			[](const FrameContext& f) { return f.debug; },
+			[this](const FrameContext& f) { drawStatsOverlay(f.projection); } },
+	};
+
+	pass_timings = std::vector<PassTiming>(render_graph.size());
+	for (size_t i = 0; i < render_graph.size(); i++)
+	{
+		pass_timings[i].gpu_timer.init();
+		pass_timings[i].gpu_label = std::string("gpu ") + render_graph[i].name;
+		pass_timings[i].cpu_label = std::string("cpu ") + render_graph[i].name;
+	}
+
+	// white pixel for the overlay bars
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	glGenTextures(1, &overlay_texture);
+	bindTexture(overlay_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	gl_has_errors();
-	mat3 projection_2D = createProjectionMatrix();
-    std::vector<Entity> beyonders;
-    // separates what needs the screen effects and what doesn't need screen effect, Not the most efficient, could look into it later
-    // Truely render to the screen
-    drawToScreen();
+}
+
+void RenderSystem::executeRenderGraph()
+{
+	bool bound = false;
+	RENDER_TARGET current = RENDER_TARGET::BACKBUFFER;
+	for (size_t i = 0; i < render_graph.size(); i++)
+	{
+		const RenderPass& pass = render_graph[i];
+		PassTiming& timing = pass_timings[i];
+		if (!pass.enabled(frame)) {
+			timing.gpu_ms = timing.cpu_ms = 0.f;
+			continue;
+		}
+		// without a post effect there is nothing to composite, draw everything in place
+		RENDER_TARGET target = frame.post_effects ? pass.target : RENDER_TARGET::BACKBUFFER;
+		if (!bound || target != current) {
+			bindRenderTarget(target);
+			current = target;
+			bound = true;
+		}
+
+		// only one GL_TIME_ELAPSED query can run at a time, so passes are timed
+		// separately and the frame is their sum
+		auto start = std::chrono::high_resolution_clock::now();
+		timing.gpu_timer.begin();
+		pass.execute(frame);
+		timing.gpu_timer.end();
+		auto end = std::chrono::high_resolution_clock::now();
+		timing.cpu_ms = (float)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.f;
+		profiler_record(timing.cpu_label.c_str(), timing.cpu_ms);
+	}
+}
+
+// Picks up GPU pass timings that finished since the last frame, they lag a
+// few frames behind so reading them never stalls
+void RenderSystem::collectPassTimings()
+{
+	bool updated = false;
+	for (PassTiming& timing : pass_timings)
+	{
+		if (timing.gpu_timer.poll(timing.gpu_ms)) {
+			profiler_record(timing.gpu_label.c_str(), timing.gpu_ms);
+			updated = true;
+		}
+	}
+	if (!updated)
+		return;
+
+	float frame_ms = 0.f;
+	for (const PassTiming& timing : pass_timings)
+		frame_ms += timing.gpu_ms;
+	profiler_record("gpu frame", frame_ms);
+	if (dynamic_resolution)
+		updateRenderScale(frame_ms);
+}
+
+void RenderSystem::captureSnapshot(RenderSnapshot &snapshot, bool pause, bool debug, int dialogue)
+{
+	ScopedTimer timer("render capture");
+	HEAP_TAG_SCOPE(RENDER);
+
+	snapshot.pause = pause;
+	snapshot.debug = debug;
+	snapshot.dialogue = dialogue;
+	snapshot.screen_darken_factor = registry.screenStates.get(screen_state_entity).screen_darken_factor;
+	// Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	glfwGetFramebufferSize(window, &snapshot.framebuffer_size.x, &snapshot.framebuffer_size.y);
+
+	// separates what needs the screen effects and what doesn't need screen effect
+	snapshot.world.clear();
+	snapshot.on_top.clear();
 	for (Entity entity : registry.renderRequests.entities)
 	{
-        RenderRequest &render_request = registry.renderRequests.get(entity);
+		RenderRequest &render_request = registry.renderRequests.get(entity);
 		if (registry.dialogues.has(entity) || registry.dialogueTexts.has(entity))
 			continue;
 		if (!registry.motions.has(entity) || !render_request.visibility)
 			continue;
-		if (render_request.on_top_screen) {
-            beyonders.push_back(entity);
-        } else {
-            drawTexturedMesh(entity, projection_2D, pause);
-        }
+		captureItem(entity, pause, false, render_request.on_top_screen ? snapshot.on_top : snapshot.world);
+	}
+
+	snapshot.dialogue_items.clear();
+	if (registry.dialogues.entities.size() != 0)
+		captureItem(registry.dialogues.entities[0], pause, false, snapshot.dialogue_items);
+	if (registry.dialogueTexts.entities.size() != 0)
+		captureItem(registry.dialogueTexts.entities[0], pause, false, snapshot.dialogue_items);
+
+	snapshot.debug_items.clear();
+	if (debug)
+	{
+		for (Entity entity : registry.debugRenderRequests.entities)
+		{
+			if (registry.weaponHitBoxes.has(entity) && !registry.weaponHitBoxes.get(entity).isActive) {
+				continue;
+			}
+			captureItem(entity, pause, true, snapshot.debug_items);
+		}
+	}
+
+	snapshot.parallax = registry.parallaxBackgrounds.components.size() != 0;
+	snapshot.parallax_ms = snapshot.parallax ? registry.parallaxBackgrounds.components[0].scroll_ms : 0.f;
+
+	snapshot.particles_active = particles.any_active();
+	snapshot.particle_time = particles.time();
+	snapshot.particles = particles.emitters();
+
+	capturePolylines(snapshot);
+	captureTexts(snapshot);
+	snapshot.entity_count = registry.motions.size();
+}
+
+// Render our game world
+// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
+void RenderSystem::draw(bool pause, bool debug, int dialogue)
+{
+	captureSnapshot(snapshots.back(), pause, debug, dialogue);
+	snapshots.publish();
+	snapshots.acquire();
+	renderFrame(snapshots.front());
+}
+
+void RenderSystem::submit(bool pause, bool debug, int dialogue)
+{
+	captureSnapshot(snapshots.back(), pause, debug, dialogue);
+	{
+		std::lock_guard<std::mutex> lock(snapshot_mutex);
+		snapshots.publish();
 	}
+	snapshot_published.notify_one();
+}
 
-	drawDialogueLayer(projection_2D, dialogue);
+void RenderSystem::startRenderThread()
+{
+	if (render_thread.joinable())
+		return;
+	render_thread_stop = false;
+	// a context can only be current on one thread at a time
+	glfwMakeContextCurrent(nullptr);
+	render_thread = std::thread([this]() { renderLoop(); });
+}
+
+void RenderSystem::stopRenderThread()
+{
+	if (!render_thread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(snapshot_mutex);
+		render_thread_stop = true;
+	}
+	snapshot_published.notify_one();
+	render_thread.join();
+	glfwMakeContextCurrent(window);
+}
 
-	if (registry.dialogues.entities.size() != 0) {
-		drawTexturedMesh(registry.dialogues.entities[0], projection_2D, pause);
+void RenderSystem::renderLoop()
+{
+	glfwMakeContextCurrent(window);
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(snapshot_mutex);
+			snapshot_published.wait(lock, [this]() { return render_thread_stop || snapshots.acquire(); });
+			if (render_thread_stop)
+				break;
+		}
+		renderFrame(snapshots.front());
 	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+void RenderSystem::finishTextureLoading()
+{
+	if (render_thread.joinable())
+		texture_loading_requested = true;
+	else
+		uploadDecodedTextures(true);
+}
 
-	if (registry.dialogueTexts.entities.size() != 0) {
-		drawTexturedMesh(registry.dialogueTexts.entities[0], projection_2D, pause);
+void RenderSystem::renderFrame(const RenderSnapshot &snapshot)
+{
+	auto frame_start = std::chrono::high_resolution_clock::now();
+
+	// Pick up textures that finished decoding since the last frame
+	uploadDecodedTextures(texture_loading_requested.exchange(false));
+	// uploads bind textures behind our back
+	bound_texture = 0;
+	frame_stats = FrameStats();
+
+	if (dynamic_resolution_requested != dynamic_resolution)
+	{
+		dynamic_resolution = dynamic_resolution_requested;
+		target_frame_ms = 1000.f / dynamic_resolution_target_fps;
+		gpu_frame_ms = 0.f;
+		frames_since_rescale = 0;
+		if (!dynamic_resolution)
+			render_scale = 1.f;
 	}
 
-    drawScreenLayer(projection_2D, pause);
-    //draws whatever is filtered out as on top of the screen effects.
-    for (Entity e : beyonders) {
-        drawTexturedMesh(e, projection_2D, pause);
-    }
-    if (debug) {
-        for (Entity entity : registry.debugRenderRequests.entities)
-        {
-            if (registry.weaponHitBoxes.has(entity) && !registry.weaponHitBoxes.get(entity).isActive) {
-                continue;
-            }
-            drawTexturedMesh(entity, projection_2D, pause, true);
-        }
-    }
+	// Clearing backbuffer, black bar colors, can be changed
+	screen_viewport = letterboxViewport(snapshot.framebuffer_size);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDepthRange(0.00001, 10);
+	glClearColor(0, 0, 0, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
+							  // and alpha blending, one would have to sort
+							  // sprites back to front
+	gl_has_errors();
+
+	frame.snapshot = &snapshot;
+	frame.pause = snapshot.pause;
+	frame.debug = snapshot.debug;
+	frame.dialogue = snapshot.dialogue;
+	frame.projection = createProjectionMatrix();
+
+	// Same amounts the separate dialogue and screen layers used to blend in black
+	float screen_darken = (snapshot.pause ? 0.6f : 0.f) + (snapshot.screen_darken_factor > 0 ? 0.9f * snapshot.screen_darken_factor : 0.f);
+	frame.overlay_brightness = 1.f - clamp(screen_darken, 0.f, 1.f);
+	frame.world_brightness = (snapshot.dialogue != 0 ? 0.4f : 1.f) * frame.overlay_brightness;
+	frame.scene_size = max(ivec2(vec2(screen_viewport.z, screen_viewport.w) * render_scale + 0.5f), ivec2(1));
+	frame.post_effects = frame.world_brightness < 1.f || render_scale < 1.f;
+
+	executeRenderGraph();
+	collectPassTimings();
+
+	last_frame_stats = frame_stats;
+	profiler_count("draw calls", (float)frame_stats.draw_calls);
+	profiler_count("program switches", (float)frame_stats.program_switches);
+	profiler_count("texture binds", (float)frame_stats.texture_binds);
+	profiler_count("vertices", (float)frame_stats.vertices);
+	auto frame_end = std::chrono::high_resolution_clock::now();
+	cpu_frame_ms = (float)std::chrono::duration_cast<std::chrono::microseconds>(frame_end - frame_start).count() / 1000.f;
+	profiler_record("cpu frame", cpu_frame_ms);
 
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
 	gl_has_errors();
 }
 
+
+void RenderSystem::setRenderScale(float scale)
+{
+	render_scale = clamp(scale, MIN_RENDER_SCALE, 1.f);
+}
+
+void RenderSystem::setDynamicResolution(bool enabled, float target_fps)
+{
+	dynamic_resolution_target_fps = target_fps;
+	dynamic_resolution_requested = enabled;
+}
+
+// Lowers the world resolution while the GPU can't keep up with the target
+// frame time and raises it again once there is headroom
+void RenderSystem::updateRenderScale(float ms)
+{
+	gpu_frame_ms = (gpu_frame_ms == 0.f) ? ms : gpu_frame_ms * 0.9f + ms * 0.1f;
+
+	if (++frames_since_rescale < RENDER_SCALE_COOLDOWN_FRAMES)
+		return;
+	float scale = render_scale;
+	if (gpu_frame_ms > target_frame_ms * 0.9f)
+		scale -= RENDER_SCALE_STEP;
+	else if (gpu_frame_ms < target_frame_ms * 0.7f)
+		scale += RENDER_SCALE_STEP;
+	scale = clamp(scale, MIN_RENDER_SCALE, 1.f);
+	if (scale != render_scale) {
+		render_scale = scale;
+		frames_since_rescale = 0;
+	}
+}
+
 mat3 RenderSystem::createProjectionMatrix()
 {
 	// Fake projection matrix, scales with respect to window coordinates
@@ -464,4 +1039,4 @@ mat3 RenderSystem::createProjectionMatrix()
 	float tx = -(right + left) / (right - left);
 	float ty = -(top + bottom) / (top - bottom);
 	return {{sx, 0.f, 0.f}, {0.f, sy, 0.f}, {tx, ty, 1.f}};
-}
\ No newline at end of file
+}
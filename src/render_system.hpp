@@ -1,11 +1,76 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
+#include <functional>
 
 #include "common.hpp"
 #include "components.hpp"
 #include "tiny_ecs.hpp"
+#include "texture_loader.hpp"
+#include "texture_cache.hpp"
+#include "gpu_timer.hpp"
+#include "particle_system.hpp"
+#include "glyph_atlas.hpp"
+#include "render_snapshot.hpp"
+
+// Where a render pass draws. SCENE is the intermediate target read by the
+// composite pass; it is only used while a post effect is active; otherwise
+// SCENE passes draw straight to the backbuffer.
+enum class RENDER_TARGET
+{
+	SCENE = 0,
+	BACKBUFFER = SCENE + 1,
+};
+
+// Everything the render passes of one frame share
+struct FrameContext
+{
+	bool pause = false;
+	bool debug = false;
+	int dialogue = 0;
+	mat3 projection;
+	// World brightness applied by the composite, and the tint of what is drawn over it
+	float world_brightness = 1.f;
+	float overlay_brightness = 1.f;
+	bool post_effects = false;
+	// Size the world is rendered at inside the scene target
+	ivec2 scene_size;
+	const RenderSnapshot* snapshot = nullptr;
+};
+
+struct RenderPass
+{
+	const char* name;
+	RENDER_TARGET target;
+	std::function<bool(const FrameContext&)> enabled;
+	std::function<void(const FrameContext&)> execute;
+};
+
+// Measured cost of one render pass, from the last frame it ran
+struct PassTiming
+{
+	GpuTimer gpu_timer;
+	float gpu_ms = 0.f;
+	float cpu_ms = 0.f;
+	// profiler section names
+	std::string gpu_label;
+	std::string cpu_label;
+};
+
+// GL work submitted during one frame
+struct FrameStats
+{
+	unsigned int draw_calls = 0;
+	unsigned int program_switches = 0;
+	unsigned int texture_binds = 0;
+	unsigned int vertices = 0;
+};
 
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
@@ -21,6 +86,35 @@ class RenderSystem
 	std::array<GLuint, texture_count> texture_gl_handles;
 	std::array<ivec2, texture_count> texture_dimensions;
 
+	// Textures are decoded in the background; these are uploaded and usable
+	std::array<bool, texture_count> texture_ready;
+	std::array<bool, texture_count> texture_from_cache;
+	std::array<float, texture_count> texture_decode_ms;
+	std::array<float, texture_count> texture_upload_ms;
+	TextureLoader texture_loader;
+	double texture_load_start;
+	bool texture_loading_done = false;
+	// running totals over uploaded textures, read by reportMemory on the game thread
+	std::atomic<size_t> texture_bytes{ 0 };
+	std::atomic<unsigned int> textures_uploaded{ 0 };
+
+	// Decoded pixels of every texture, rewritten whenever something had to be decoded
+	TextureCache texture_cache;
+	bool texture_cache_dirty = false;
+	std::string texture_cache_path() const { return textures_path("texture_cache.bin"); }
+
+	// Everything the title screen draws, uploaded before init returns
+	const std::vector<TEXTURE_ASSET_ID> title_screen_textures = {
+		TEXTURE_ASSET_ID::TITLE_SCREEN_BG,
+		TEXTURE_ASSET_ID::TITLE_TEXT,
+		TEXTURE_ASSET_ID::PLAY,
+		TEXTURE_ASSET_ID::PLAY_PRESSED,
+		TEXTURE_ASSET_ID::ALMANAC,
+		TEXTURE_ASSET_ID::ALMANAC_PRESSED,
+		TEXTURE_ASSET_ID::QUIT,
+		TEXTURE_ASSET_ID::QUIT_PRESSED,
+	};
+
 	// Make sure these paths remain in sync with the associated enumerators.
 	// Associated id with .obj path
 	const std::vector < std::pair<GEOMETRY_BUFFER_ID, std::string>> mesh_paths =
@@ -152,17 +246,23 @@ class RenderSystem
 		shader_path("spitter"),
 		shader_path("spitter_bullet"),
 		shader_path("following_enemy"),
-        shader_path("screen_layer"),
 		shader_path("lava_pillar"),
         shader_path("boss"),
 		shader_path("boss_sword_small"),
 		shader_path("boss_sword_large"),
         shader_path("health_bar"),
-		shader_path("dialogue_layer"),
-		shader_path("grenade_orb")};
+		shader_path("grenade_orb"),
+		shader_path("particle"),
+		shader_path("parallax"),
+		shader_path("text")};
+
+	// Linked program binaries, next to the build (working directory)
+	const std::string shader_cache_path = "shader_cache.bin";
 
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
+	// vertex plus index bytes uploaded per geometry, for the memory report
+	std::array<size_t, geometry_count> geometry_bytes = {};
 	std::array<Mesh, geometry_count> meshes;
 	std::array<CollisionMesh, geometry_count> collisionMeshes;
 
@@ -175,6 +275,12 @@ public:
 
 	void initializeGlTextures();
 
+	// Uploads whatever the decode workers have finished; with wait set, blocks until all textures are in
+	void uploadDecodedTextures(bool wait);
+	// Blocks until every texture is uploaded, call before showing anything beyond the title screen.
+	// With the render thread running it only asks that thread to do so on its next frame.
+	void finishTextureLoading();
+
 	void initializeGlEffects();
 
 	void initializeGlMeshes();
@@ -185,8 +291,8 @@ public:
 
 	void initializeGlGeometryBuffers();
 	// Initialize the screen texture used as intermediate render target
-	// The draw loop first renders to this texture, then it is used for the water
-	// shader
+	// The world is rendered to this texture while a post effect is active, then
+	// composited to the screen
 	bool initScreenTexture();
 
 	// Destroy resources associated to one or all entities created by the system
@@ -195,14 +301,74 @@ public:
 	// Draw all entities
 	void draw(bool pause, bool debug, int dialogue);
 
+	// Pipelined mode: the GL context moves to a render thread that draws the
+	// newest submitted snapshot, so a slow GPU frame or vsync wait doesn't hold
+	// up the game and a slow step doesn't hold up presenting. Stopping hands
+	// the context back to the calling thread.
+	void startRenderThread();
+	void stopRenderThread();
+	// Snapshots the game state for the render thread, instead of draw
+	void submit(bool pause, bool debug, int dialogue);
+
 	mat3 createProjectionMatrix();
 
+	// Fraction of the screen resolution the world is rendered at, HUD stays native
+	void setRenderScale(float scale);
+	float getRenderScale() const { return render_scale; }
+	// Lets the render scale follow the measured GPU frame time to hold target_fps,
+	// from the next frame on
+	void setDynamicResolution(bool enabled, float target_fps = 60.f);
+	bool dynamicResolution() const { return dynamic_resolution_requested; }
+
+	// Bursts of GPU simulated particles, stepped with the game
+	ParticleSystem& getParticles() { return particles; }
+
+	// Logs what the renderer holds on the GPU. Sizes are what was uploaded,
+	// tracked CPU-side, so the game thread can ask without the GL context.
+	void reportMemory();
+
 private:
+	void uploadTexture(uint index, ivec2 size, const unsigned char* pixels);
+	void uploadDecodedImage(DecodedImage& image);
+	void writeTextureCache();
+	void printTextureReport();
+
+	// Game thread: copies what the next frame draws out of the registry
+	void captureSnapshot(RenderSnapshot &snapshot, bool pause, bool debug, int dialogue);
+	void captureItem(Entity entity, bool pause, bool is_debug, std::vector<RenderItem> &out);
+	void capturePolylines(RenderSnapshot &snapshot);
+	void captureTexts(RenderSnapshot &snapshot);
+	bool textBatchStale();
+
+	// Render thread (or the game thread outside pipelined mode)
+	void renderFrame(const RenderSnapshot &snapshot);
+	void renderLoop();
+
 	// Internal drawing functions for each entity type
-	void drawTexturedMesh(Entity entity, const mat3 &projection, bool pause, bool is_debug = false);
-	void drawToScreen();
-    void drawScreenLayer(const mat3 &projection, bool pause);
-	void drawDialogueLayer(const mat3 &projection, int dialogue);
+	void drawTexturedMesh(const RenderItem &item, const mat3 &projection);
+	void drawToScreen(float brightness);
+	void drawParticles(const RenderSnapshot &snapshot, const mat3 &projection);
+	void drawParallax(float time_ms);
+	void drawPolylines(const RenderSnapshot &snapshot, const mat3 &projection);
+	void drawStatsOverlay(const mat3 &projection);
+	void drawOverlayQuad(GLuint texture, vec2 position, vec2 scale, vec3 color, const mat3 &projection);
+	void drawText(const RenderSnapshot &snapshot, const mat3 &projection);
+	void drawTextVertices(GLuint vbo, GLsizei count, const mat3 &projection);
+
+	// GL calls that are counted in frame_stats; redundant program and texture binds are skipped
+	void useProgram(GLuint program);
+	void bindTexture(GLuint texture);
+	void drawElements(GLsizei num_indices);
+	void drawElementsInstanced(GLsizei num_indices, GLsizei instances);
+	void drawArrays(GLenum mode, GLint first, GLsizei count);
+
+	// Render graph: the passes of a frame in execution order
+	void buildRenderGraph();
+	void executeRenderGraph();
+	void collectPassTimings();
+	void bindRenderTarget(RENDER_TARGET target);
+	void resizeSceneTarget(ivec2 size);
+	ivec4 letterboxViewport(ivec2 framebuffer_size);
 
 	// Window handle
 	GLFWwindow *window;
@@ -210,10 +376,79 @@ private:
 	// Screen texture handles
 	GLuint frame_buffer;
 	GLuint off_screen_render_buffer_color;
-	GLuint off_screen_render_buffer_depth;
+	ivec2 scene_target_size = { 0, 0 };
+	// read by reportMemory on the game thread
+	std::atomic<size_t> scene_target_bytes{ 0 };
+
+	std::vector<RenderPass> render_graph;
+	std::vector<PassTiming> pass_timings;
+	FrameContext frame;
+	ivec4 screen_viewport;
+	// Multiplied into fcolor, lets overlays be darkened with the world below them
+	vec3 overlay_tint = vec3(1.f);
+
+	// Dynamic resolution
+	float render_scale = 1.f;
+	bool dynamic_resolution = false;
+	// set by the game, applied by the renderer at the start of its next frame
+	std::atomic<bool> dynamic_resolution_requested{ false };
+	std::atomic<float> dynamic_resolution_target_fps{ 60.f };
+	float target_frame_ms = 1000.f / 60.f;
+	float gpu_frame_ms = 0.f;
+	int frames_since_rescale = 0;
+	void updateRenderScale(float frame_ms);
+
+	// Instrumentation, shown by the debug overlay and recorded in the profiler
+	FrameStats frame_stats;
+	FrameStats last_frame_stats;
+	float cpu_frame_ms = 0.f;
+	GLuint bound_program = 0;
+	GLuint bound_texture = 0;
+	// 1x1 white, tinted for the overlay bars
+	GLuint overlay_texture = 0;
+
+	ParticleSystem particles;
+
+	// Extruded Polyline strips, streamed to polyline_vbo every frame
+	GLuint polyline_vbo = 0;
+
+	// Glyph quads of every Text entity, laid out again only when a text
+	// changed, the set of texts or their positions did, or the atlas filled in.
+	// The game side bumps text_generation for the first three.
+	struct TextKey
+	{
+		unsigned int entity;
+		vec2 position;
+		bool visible;
+	};
+	std::vector<TextKey> text_batch_keys;
+	unsigned int text_generation = 0;
+	GlyphAtlas glyphs;
+	GLuint text_vbo = 0;
+	GLsizei text_vertex_count = 0;
+	std::vector<TextVertex> text_vertices;
+	unsigned int text_batch_generation = 0;
+	unsigned int text_batch_revision = 0;
+	// Debug overlay labels, laid out every frame
+	GLuint overlay_text_vbo = 0;
+	std::vector<TextVertex> overlay_text_vertices;
 
 	Entity screen_state_entity;
+
+	// Pipelined mode. The game writes snapshots.back(), the render thread
+	// draws snapshots.front(); snapshot_mutex only guards the slot swap.
+	TripleBuffer<RenderSnapshot> snapshots;
+	std::thread render_thread;
+	std::mutex snapshot_mutex;
+	std::condition_variable snapshot_published;
+	bool render_thread_stop = false;
+	std::atomic<bool> texture_loading_requested{ false };
 };
 
 bool loadEffectFromFile(
 	const std::string &vs_path, const std::string &fs_path, GLuint &out_program);
+
+// loadEffectFromFile in steps, so many programs can be compiled before any is waited on
+bool readShaderSources(const std::string &vs_path, const std::string &fs_path, std::string &out_vs, std::string &out_fs);
+GLuint beginEffectProgram(const std::string &vs_src, const std::string &fs_src);
+bool finishEffectProgram(GLuint program);
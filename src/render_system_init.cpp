@@ -1,8 +1,14 @@
 // internal
 #include "render_system.hpp"
+#include "mesh_cache.hpp"
+#include "profiler.hpp"
+#include "texture_cache.hpp"
+#include "shader_cache.hpp"
+#include "logger.hpp"
 
 #include <array>
 #include <fstream>
+#include <algorithm>
 
 #include "../ext/stb_image/stb_image.h"
 
@@ -37,9 +43,9 @@ bool RenderSystem::init(GLFWwindow *window_arg)
 	glfwGetFramebufferSize(window, &frame_buffer_width_px, &frame_buffer_height_px); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 	if (frame_buffer_width_px != window_width_px)
 	{
-		printf("WARNING: retina display! https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value\n");
-		printf("glfwGetFramebufferSize = %d,%d\n", frame_buffer_width_px, frame_buffer_height_px);
-		printf("window width_height = %d,%d\n", window_width_px, window_height_px);
+		LOG_WARN(RENDER, "retina display! https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value");
+		LOG_WARN(RENDER, "glfwGetFramebufferSize = %d,%d", frame_buffer_width_px, frame_buffer_height_px);
+		LOG_WARN(RENDER, "window width_height = %d,%d", window_width_px, window_height_px);
 	}
 
 	// Hint: Ask your TA for how to setup pretty OpenGL error callbacks.
@@ -56,51 +62,243 @@ bool RenderSystem::init(GLFWwindow *window_arg)
 	gl_has_errors();
 
 	initScreenTexture();
+	glyphs.init();
 	initializeGlTextures();
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
+	buildRenderGraph();
 
 	return true;
 }
 
 void RenderSystem::initializeGlTextures()
 {
+	HEAP_TAG_SCOPE(TEXTURES);
 	glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	texture_ready.fill(false);
+	texture_from_cache.fill(false);
+	texture_decode_ms.fill(0.f);
+	texture_upload_ms.fill(0.f);
+	texture_load_start = glfwGetTime();
+
+	// Anything still valid in the packed cache goes straight from the mapping to the GPU
+	if (texture_cache.open(texture_cache_path(), texture_paths.size()))
+	{
+		for (uint i = 0; i < texture_paths.size(); i++)
+		{
+			ivec2 size;
+			const unsigned char* pixels = texture_cache.lookup(i, texture_paths[i], size);
+			if (pixels == nullptr)
+				continue;
+			uploadTexture(i, size, pixels);
+			texture_from_cache[i] = true;
+		}
+	}
 
+	// Decode the rest, title screen first
+	std::vector<int> jobs;
+	for (TEXTURE_ASSET_ID id : title_screen_textures)
+		if (!texture_ready[(uint)id])
+			jobs.push_back((int)id);
 	for (uint i = 0; i < texture_paths.size(); i++)
+		if (!texture_ready[i] && std::find(jobs.begin(), jobs.end(), (int)i) == jobs.end())
+			jobs.push_back(i);
+	texture_cache_dirty = !jobs.empty();
+	texture_loader.start(std::vector<std::string>(texture_paths.begin(), texture_paths.end()), jobs);
+
+	// Only the title screen has to be ready before the first frame, the rest is
+	// uploaded from draw() as the workers finish
+	bool title_ready = false;
+	while (!title_ready)
 	{
-		const std::string &path = texture_paths[i];
-		ivec2 &dimensions = texture_dimensions[i];
+		title_ready = true;
+		for (TEXTURE_ASSET_ID id : title_screen_textures)
+			title_ready = title_ready && texture_ready[(uint)id];
+
+		DecodedImage image;
+		if (title_ready || !texture_loader.pop(image, true))
+			break;
+		uploadDecodedImage(image);
+	}
+	LOG_INFO(RENDER, "Title screen textures ready after %.1f ms", (glfwGetTime() - texture_load_start) * 1000.0);
+	uploadDecodedTextures(false);
+}
 
-		stbi_uc *data;
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+void RenderSystem::uploadTexture(uint index, ivec2 size, const unsigned char* pixels)
+{
+	double start = glfwGetTime();
+	texture_dimensions[index] = size;
+	glBindTexture(GL_TEXTURE_2D, texture_gl_handles[index]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl_has_errors();
 
-		if (data == NULL)
-		{
-			const std::string message = "Could not load the file " + path + ".";
-			fprintf(stderr, "%s", message.c_str());
-			assert(false);
-		}
-		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		gl_has_errors();
-		stbi_image_free(data);
+	// the score digits are also text glyphs
+	if (index >= (uint)TEXTURE_ASSET_ID::ZERO && index <= (uint)TEXTURE_ASSET_ID::NINE)
+		glyphs.uploadScoreDigit(index - (uint)TEXTURE_ASSET_ID::ZERO, size, pixels);
+
+	texture_upload_ms[index] = (float)((glfwGetTime() - start) * 1000.0);
+	texture_ready[index] = true;
+	texture_bytes += (size_t)size.x * size.y * 4;
+	textures_uploaded++;
+	profiler_record("texture upload", texture_upload_ms[index]);
+}
+
+void RenderSystem::uploadDecodedImage(DecodedImage& image)
+{
+	const std::string &path = texture_paths[image.index];
+	if (image.pixels == NULL)
+	{
+		const std::string message = "Could not load the file " + path + ".";
+		LOG_ERROR(RENDER, "%s", message.c_str());
+		assert(false);
+		return;
+	}
+
+	uploadTexture(image.index, image.size, image.pixels);
+	stbi_image_free(image.pixels);
+	image.pixels = NULL;
+
+	texture_decode_ms[image.index] = image.decode_ms;
+	profiler_record("texture decode", image.decode_ms);
+}
+
+void RenderSystem::uploadDecodedTextures(bool wait)
+{
+	if (texture_loading_done)
+		return;
+	HEAP_TAG_SCOPE(TEXTURES);
+
+	DecodedImage image;
+	while (texture_loader.pop(image, wait))
+		uploadDecodedImage(image);
+
+	if (texture_loader.finished())
+	{
+		texture_loader.join();
+		texture_loading_done = true;
+		printTextureReport();
+
+		texture_cache.close();
+		if (texture_cache_dirty)
+			writeTextureCache();
 	}
+}
+
+void RenderSystem::writeTextureCache()
+{
+	// Read the pixels back from the GPU rather than keeping every decoded image alive until now
+	double start = glfwGetTime();
+	std::vector<ivec2> sizes(texture_dimensions.begin(), texture_dimensions.end());
+	bool ok = write_texture_cache(texture_cache_path(), std::vector<std::string>(texture_paths.begin(), texture_paths.end()), sizes,
+		[this](size_t i, unsigned char* out) {
+			glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, out);
+		});
 	gl_has_errors();
+	if (ok)
+		LOG_INFO(RENDER, "Wrote texture cache in %.1f ms", (glfwGetTime() - start) * 1000.0);
+}
+
+void RenderSystem::printTextureReport()
+{
+	float total_decode = 0.f, total_upload = 0.f;
+	LOG_INFO(RENDER, "%-48s %6s %10s %10s %10s", "texture", "source", "size", "decode ms", "upload ms");
+	for (uint i = 0; i < texture_paths.size(); i++)
+	{
+		std::string name = texture_paths[i].substr(texture_paths[i].find_last_of("/\\") + 1);
+		std::string size = std::to_string(texture_dimensions[i].x) + "x" + std::to_string(texture_dimensions[i].y);
+		LOG_INFO(RENDER, "%-48s %6s %10s %10.2f %10.2f", name.c_str(), texture_from_cache[i] ? "cache" : "png", size.c_str(), texture_decode_ms[i], texture_upload_ms[i]);
+		total_decode += texture_decode_ms[i];
+		total_upload += texture_upload_ms[i];
+	}
+	LOG_INFO(RENDER, "%u textures: %.1f ms decode (summed over workers), %.1f ms upload, %.1f ms wall",
+		(uint)texture_paths.size(), total_decode, total_upload, (glfwGetTime() - texture_load_start) * 1000.0);
+}
+
+void RenderSystem::reportMemory()
+{
+	size_t uploaded_bytes = texture_bytes.load();
+	size_t target_bytes = scene_target_bytes.load();
+	size_t mesh_bytes = 0;
+	for (size_t bytes : geometry_bytes)
+		mesh_bytes += bytes;
+
+	LOG_INFO(RENDER, "%-24s %10.1f KB  (%u of %u loaded, RGBA8)", "textures", uploaded_bytes / 1024.f, textures_uploaded.load(), (uint)texture_count);
+	LOG_INFO(RENDER, "%-24s %10.1f KB  (%u geometries)", "vertex/index buffers", mesh_bytes / 1024.f, (uint)geometry_count);
+	LOG_INFO(RENDER, "%-24s %10.1f KB", "glyph atlas", glyphs.memory_bytes() / 1024.f);
+	LOG_INFO(RENDER, "%-24s %10.1f KB", "scene target", target_bytes / 1024.f);
+	LOG_INFO(RENDER, "%-24s %10u", "shader programs", (uint)effects.size());
+	LOG_INFO(RENDER, "%-24s %10.1f KB  (streamed buffers and particles not included)", "total",
+		(uploaded_bytes + mesh_bytes + glyphs.memory_bytes() + target_bytes) / 1024.f);
 }
 
 void RenderSystem::initializeGlEffects()
 {
+	double start = glfwGetTime();
+	// GL 3.3 only has program binaries through ARB_get_program_binary, and some
+	// drivers expose it with zero formats
+	GLint binary_formats = 0;
+	if (glGetProgramBinary && glProgramBinary)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+	const bool use_cache = binary_formats > 0;
+	ProgramBinaryCache cache;
+	if (use_cache)
+		cache.load(shader_cache_path, gl_driver_id());
+
+	std::array<std::string, effect_count> vs_sources, fs_sources;
+	std::array<uint64_t, effect_count> source_hashes;
+	std::vector<uint> misses;
 	for (uint i = 0; i < effect_paths.size(); i++)
 	{
-		const std::string vertex_shader_name = effect_paths[i] + ".vs.glsl";
-		const std::string fragment_shader_name = effect_paths[i] + ".fs.glsl";
+		bool is_valid = readShaderSources(effect_paths[i] + ".vs.glsl", effect_paths[i] + ".fs.glsl", vs_sources[i], fs_sources[i]);
+		assert(is_valid);
+		source_hashes[i] = fnv1a_hash(fs_sources[i].data(), fs_sources[i].size(), fnv1a_hash(vs_sources[i].data(), vs_sources[i].size()));
+
+		if (!use_cache || !cache.restore(i, source_hashes[i], effects[i]))
+			misses.push_back(i);
+	}
+	double cache_ms = (glfwGetTime() - start) * 1000.0;
+
+	if (!misses.empty())
+	{
+		double compile_start = glfwGetTime();
+
+		// Let the driver compile on its own threads; issue every compile and link
+		// first and only query the results afterwards so they can overlap
+		bool parallel = false;
+		if (glMaxShaderCompilerThreadsKHR && gl_has_extension("GL_KHR_parallel_shader_compile"))
+		{
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			parallel = true;
+		}
+		else if (glMaxShaderCompilerThreadsARB && gl_has_extension("GL_ARB_parallel_shader_compile"))
+		{
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			parallel = true;
+		}
+
+		for (uint i : misses)
+			effects[i] = beginEffectProgram(vs_sources[i], fs_sources[i]);
+		for (uint i : misses)
+		{
+			bool is_valid = finishEffectProgram(effects[i]);
+			assert(is_valid && (GLuint)effects[i] != 0);
+			if (use_cache)
+				cache.store(i, source_hashes[i], effects[i]);
+		}
+		if (use_cache)
+			cache.save(shader_cache_path);
 
-		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
-		assert(is_valid && (GLuint)effects[i] != 0);
+		double compile_ms = (glfwGetTime() - compile_start) * 1000.0;
+		profiler_record("shader compile", (float)compile_ms);
+		LOG_INFO(RENDER, "Shaders: %u compiled from source in %.1f ms%s", (uint)misses.size(), compile_ms, parallel ? " (parallel)" : "");
 	}
+	profiler_record("shader cache", (float)cache_ms);
+	LOG_INFO(RENDER, "Shaders: %u loaded from binary cache in %.1f ms", (uint)(effect_paths.size() - misses.size()), cache_ms);
+	gl_has_errors();
 }
 
 // One could merge the following two functions as a template function...
@@ -116,16 +314,18 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 				 sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
 	gl_has_errors();
+	geometry_bytes[(uint)gid] = sizeof(vertices[0]) * vertices.size() + sizeof(indices[0]) * indices.size();
 }
 
 void RenderSystem::initializeGlMeshes()
 {
+	HEAP_TAG_SCOPE(MESHES);
 	for (uint i = 0; i < mesh_paths.size(); i++)
 	{
 		// Initialize meshes
 		GEOMETRY_BUFFER_ID geom_index = mesh_paths[i].first;
 		std::string name = mesh_paths[i].second;
-		Mesh::loadFromOBJFile(name,
+		load_mesh_cached(name,
 			meshes[(int)geom_index].vertices,
 			meshes[(int)geom_index].vertex_indices,
 			meshes[(int)geom_index].original_size);
@@ -138,12 +338,13 @@ void RenderSystem::initializeGlMeshes()
 
 void RenderSystem::initializeCollisionMeshes()
 {
+	HEAP_TAG_SCOPE(MESHES);
 	for (uint i = 0; i < collision_mesh_paths.size(); i++)
 	{
 		// Initialize meshes
 		GEOMETRY_BUFFER_ID geom_index = collision_mesh_paths[i].first;
 		std::string name = collision_mesh_paths[i].second;
-		CollisionMesh::loadFromOBJFile(name,
+		load_collision_mesh_cached(name,
 			collisionMeshes[(int)geom_index].vertices,
 			collisionMeshes[(int)geom_index].edges,
 			collisionMeshes[(int)geom_index].original_size);
@@ -213,17 +414,33 @@ void RenderSystem::initializeGlGeometryBuffers()
 	// Counterclockwise as it's the default opengl front winding direction.
 	const std::vector<uint16_t> screen_indices = {0, 1, 2};
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE, screen_vertices, screen_indices);
+
+	// Filled every frame by drawPolylines
+	glGenBuffers(1, &polyline_vbo);
+	// Text batches, see drawText and drawStatsOverlay
+	glGenBuffers(1, &text_vbo);
+	glGenBuffers(1, &overlay_text_vbo);
+	gl_has_errors();
 }
 
 RenderSystem::~RenderSystem()
 {
+	// the GL calls below need the context back on this thread
+	stopRenderThread();
+
 	// Don't need to free gl resources since they last for as long as the program,
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	glDeleteBuffers(1, &polyline_vbo);
+	glDeleteBuffers(1, &text_vbo);
+	glDeleteBuffers(1, &overlay_text_vbo);
+	glyphs.destroy();
 	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 	glDeleteTextures(1, &off_screen_render_buffer_color);
-	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
+	glDeleteTextures(1, &overlay_texture);
+	for (PassTiming& timing : pass_timings)
+		timing.gpu_timer.destroy();
 	gl_has_errors();
 
 	for (uint i = 0; i < effect_count; i++)
@@ -247,18 +464,15 @@ bool RenderSystem::initScreenTexture()
 	int framebuffer_width, framebuffer_height;
 	glfwGetFramebufferSize(const_cast<GLFWwindow *>(window), &framebuffer_width, &framebuffer_height); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 
+	// No depth attachment, sprites are drawn in order without depth testing.
+	// The texture follows the letterboxed screen size, see bindRenderTarget
 	glGenTextures(1, &off_screen_render_buffer_color);
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	resizeSceneTarget(ivec2(framebuffer_width, framebuffer_height));
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	gl_has_errors();
-
-	glGenRenderbuffers(1, &off_screen_render_buffer_depth);
-	glBindRenderbuffer(GL_RENDERBUFFER, off_screen_render_buffer_depth);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, off_screen_render_buffer_color, 0);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, framebuffer_width, framebuffer_height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, off_screen_render_buffer_depth);
 	gl_has_errors();
 
 	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
@@ -266,10 +480,9 @@ bool RenderSystem::initScreenTexture()
 	return true;
 }
 
-bool gl_compile_shader(GLuint shader)
+// Prints the info log of a shader that failed to compile
+bool gl_compile_shader_status(GLuint shader)
 {
-	glCompileShader(shader);
-	gl_has_errors();
 	GLint success = 0;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (success == GL_FALSE)
@@ -278,10 +491,10 @@ bool gl_compile_shader(GLuint shader)
 		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_len);
 		std::vector<char> log(log_len);
 		glGetShaderInfoLog(shader, log_len, &log_len, log.data());
-		glDeleteShader(shader);
 
 		gl_has_errors();
 
+		// compiler logs run longer than a log message
 		fprintf(stderr, "GLSL: %s", log.data());
 		return false;
 	}
@@ -289,15 +502,14 @@ bool gl_compile_shader(GLuint shader)
 	return true;
 }
 
-bool loadEffectFromFile(
-	const std::string &vs_path, const std::string &fs_path, GLuint &out_program)
+bool readShaderSources(const std::string &vs_path, const std::string &fs_path, std::string &out_vs, std::string &out_fs)
 {
 	// Opening files
 	std::ifstream vs_is(vs_path);
 	std::ifstream fs_is(fs_path);
 	if (!vs_is.good() || !fs_is.good())
 	{
-		fprintf(stderr, "Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
+		LOG_ERROR(RENDER, "Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
 		assert(false);
 		return false;
 	}
@@ -306,8 +518,13 @@ bool loadEffectFromFile(
 	std::stringstream vs_ss, fs_ss;
 	vs_ss << vs_is.rdbuf();
 	fs_ss << fs_is.rdbuf();
-	std::string vs_str = vs_ss.str();
-	std::string fs_str = fs_ss.str();
+	out_vs = vs_ss.str();
+	out_fs = fs_ss.str();
+	return true;
+}
+
+GLuint beginEffectProgram(const std::string &vs_str, const std::string &fs_str)
+{
 	const char *vs_src = vs_str.c_str();
 	const char *fs_src = fs_str.c_str();
 	GLsizei vs_len = (GLsizei)vs_str.size();
@@ -317,53 +534,67 @@ bool loadEffectFromFile(
 	glShaderSource(vertex, 1, &vs_src, &vs_len);
 	GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment, 1, &fs_src, &fs_len);
+	glCompileShader(vertex);
+	glCompileShader(fragment);
 	gl_has_errors();
 
-	// Compiling
-	if (!gl_compile_shader(vertex))
-	{
-		fprintf(stderr, "Vertex compilation failed");
-		assert(false);
-		return false;
-	}
-	if (!gl_compile_shader(fragment))
-	{
-		fprintf(stderr, "Vertex compilation failed");
-		assert(false);
-		return false;
-	}
-
-	// Linking
-	out_program = glCreateProgram();
-	glAttachShader(out_program, vertex);
-	glAttachShader(out_program, fragment);
-	glLinkProgram(out_program);
+	// Linking, the status is only looked at in finishEffectProgram
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	if (glProgramParameteri)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
 	gl_has_errors();
+	return program;
+}
+
+bool finishEffectProgram(GLuint program)
+{
+	GLuint shaders[2];
+	GLsizei shader_count = 0;
+	glGetAttachedShaders(program, 2, &shader_count, shaders);
 
+	GLint is_linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+	if (is_linked == GL_FALSE)
 	{
-		GLint is_linked = GL_FALSE;
-		glGetProgramiv(out_program, GL_LINK_STATUS, &is_linked);
-		if (is_linked == GL_FALSE)
+		for (GLsizei i = 0; i < shader_count; i++)
 		{
-			GLint log_len;
-			glGetProgramiv(out_program, GL_INFO_LOG_LENGTH, &log_len);
-			std::vector<char> log(log_len);
-			glGetProgramInfoLog(out_program, log_len, &log_len, log.data());
-			gl_has_errors();
-
-			fprintf(stderr, "Link error: %s", log.data());
-			assert(false);
-			return false;
+			if (!gl_compile_shader_status(shaders[i]))
+				LOG_ERROR(RENDER, "%s compilation failed", i == 0 ? "Vertex" : "Fragment");
 		}
+
+		GLint log_len;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_len);
+		std::vector<char> log(log_len);
+		glGetProgramInfoLog(program, log_len, &log_len, log.data());
+		gl_has_errors();
+
+		fprintf(stderr, "Link error: %s", log.data());
+		assert(false);
+		return false;
 	}
 
 	// No need to carry this around. Keeping these objects is only useful if we recycle
 	// the same shaders over and over, which we don't, so no need and this is simpler.
-	glDetachShader(out_program, vertex);
-	glDetachShader(out_program, fragment);
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+	for (GLsizei i = 0; i < shader_count; i++)
+	{
+		glDetachShader(program, shaders[i]);
+		glDeleteShader(shaders[i]);
+	}
 	gl_has_errors();
 
 	return true;
 }
+
+bool loadEffectFromFile(
+	const std::string &vs_path, const std::string &fs_path, GLuint &out_program)
+{
+	std::string vs_str, fs_str;
+	if (!readShaderSources(vs_path, fs_path, vs_str, fs_str))
+		return false;
+
+	out_program = beginEffectProgram(vs_str, fs_str);
+	return finishEffectProgram(out_program);
+}
@@ -0,0 +1,143 @@
+// Header
+#include "shader_cache.hpp"
+#include "mesh_cache.hpp" // fnv1a_hash, read_file_bytes
+#include "logger.hpp"
+
+// stlib
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const uint32_t SHADER_CACHE_MAGIC = 0x43535454; // "TTSC"
+	const uint32_t SHADER_CACHE_VERSION = 1;
+
+	struct ShaderCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t driver_hash;
+		uint32_t count;
+		uint32_t reserved;
+	};
+
+	struct ShaderCacheEntryHeader
+	{
+		uint64_t source_hash;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	std::string gl_string(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? std::string((const char*)value) : std::string();
+	}
+}
+
+std::string gl_driver_id()
+{
+	return gl_string(GL_VENDOR) + "|" + gl_string(GL_RENDERER) + "|" + gl_string(GL_VERSION);
+}
+
+bool gl_has_extension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp((const char*)extension, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+void ProgramBinaryCache::load(const std::string& path, const std::string& driver_id)
+{
+	driver_hash = fnv1a_hash(driver_id.data(), driver_id.size());
+	entries.clear();
+
+	std::vector<char> bytes;
+	if (!read_file_bytes(path, bytes) || bytes.size() < sizeof(ShaderCacheHeader))
+		return;
+
+	ShaderCacheHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION || header.driver_hash != driver_hash)
+		return;
+
+	size_t offset = sizeof(header);
+	entries.resize(header.count);
+	for (Entry& entry : entries)
+	{
+		ShaderCacheEntryHeader entry_header;
+		if (offset + sizeof(entry_header) > bytes.size())
+			break;
+		memcpy(&entry_header, bytes.data() + offset, sizeof(entry_header));
+		offset += sizeof(entry_header);
+		if (offset + entry_header.length > bytes.size())
+			break;
+		entry.source_hash = entry_header.source_hash;
+		entry.format = entry_header.format;
+		entry.binary.assign(bytes.data() + offset, bytes.data() + offset + entry_header.length);
+		offset += entry_header.length;
+	}
+}
+
+bool ProgramBinaryCache::save(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		LOG_ERROR(RENDER, "Failed to write shader cache %s", path.c_str());
+		return false;
+	}
+	ShaderCacheHeader header = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, driver_hash, (uint32_t)entries.size(), 0 };
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (const Entry& entry : entries)
+	{
+		ShaderCacheEntryHeader entry_header = { entry.source_hash, entry.format, (uint32_t)entry.binary.size() };
+		ok = ok && fwrite(&entry_header, sizeof(entry_header), 1, file) == 1;
+		ok = ok && fwrite(entry.binary.data(), 1, entry.binary.size(), file) == entry.binary.size();
+	}
+	ok = (fclose(file) == 0) && ok;
+	return ok;
+}
+
+bool ProgramBinaryCache::restore(size_t slot, uint64_t source_hash, GLuint& out_program) const
+{
+	if (slot >= entries.size() || entries[slot].binary.empty() || entries[slot].source_hash != source_hash)
+		return false;
+
+	const Entry& entry = entries[slot];
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, entry.format, entry.binary.data(), (GLsizei)entry.binary.size());
+
+	// a driver may still reject a binary it produced (e.g. after a silent update)
+	GLint is_linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+	if (is_linked == GL_FALSE)
+	{
+		// swallow the error a rejected binary raises, we fall back to source
+		while (glGetError() != GL_NO_ERROR);
+		glDeleteProgram(program);
+		return false;
+	}
+	out_program = program;
+	return true;
+}
+
+void ProgramBinaryCache::store(size_t slot, uint64_t source_hash, GLuint program)
+{
+	if (slot >= entries.size())
+		entries.resize(slot + 1);
+
+	Entry& entry = entries[slot];
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	entry.binary.resize(length);
+	entry.source_hash = source_hash;
+	if (length > 0)
+		glGetProgramBinary(program, length, nullptr, &entry.format, entry.binary.data());
+}
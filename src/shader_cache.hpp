@@ -0,0 +1,41 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <string>
+#include <vector>
+
+// Identifies the GL implementation (vendor, renderer, version); program
+// binaries are only valid for the driver that produced them
+std::string gl_driver_id();
+
+bool gl_has_extension(const char* name);
+
+// On-disk cache of linked program binaries (glGetProgramBinary), one slot per
+// effect. Slots are keyed by a hash of the shader sources and the whole file
+// by the driver id, so editing a shader or updating the driver falls back to
+// compiling from source.
+class ProgramBinaryCache
+{
+public:
+	void load(const std::string& path, const std::string& driver_id);
+	bool save(const std::string& path) const;
+
+	// Creates out_program from the cached binary if slot matches source_hash and the driver accepts it
+	bool restore(size_t slot, uint64_t source_hash, GLuint& out_program) const;
+	// Retrieves the binary of a freshly linked program into slot
+	void store(size_t slot, uint64_t source_hash, GLuint program);
+
+private:
+	struct Entry
+	{
+		uint64_t source_hash = 0;
+		GLenum format = 0;
+		std::vector<char> binary;
+	};
+
+	uint64_t driver_hash = 0;
+	std::vector<Entry> entries;
+};
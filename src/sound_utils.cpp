@@ -1,84 +1,205 @@
 #include "sound_utils.hpp"
+#include "logger.hpp"
+#include "heap_counter.hpp"
+#include "music_stream.hpp"
+
+#include <array>
 
-// music references
-Mix_Music *background_music;
 std::vector<Mix_Chunk *> sound_effects;
-Mix_Music *dialogue_background_music;
-Mix_Music *main_menu_background_music;
+// streamed, see MusicStream
+MusicStream music_stream;
 
 bool is_music_muted;
 
+namespace
+{
+	// Mixer channels, music plays outside of them. Enough for a heavy fight;
+	// beyond that the least important sound is replaced.
+	const int VOICE_COUNT = 24;
+
+	// A new sound may take the voice of one with the same or lower priority
+	const int PRIORITY_LOW = 0;    // reloads, pick ups
+	const int PRIORITY_NORMAL = 1; // weapons and their hits
+	const int PRIORITY_HIGH = 2;   // the hero, the boss, UI and dialogue
+
+	// Emitters this far from the listener get SDL_mixer distance FAR_DISTANCE;
+	// 255 would be silence, this keeps the far side of the arena audible
+	const float AUDIBLE_RANGE = (float)window_width_px;
+	const float FAR_DISTANCE = 160.f;
+
+	const float MUSIC_VOLUME = 60.f / MIX_MAX_VOLUME;
+	// crossfade between tracks
+	const int MUSIC_FADE_MS = 300;
+	const char* const MUSIC_FILE = "music.ogg";
+	const char* const DIALOGUE_MUSIC_FILE = "dialogue_bg_music.ogg";
+	const char* const MAIN_MENU_MUSIC_FILE = "main_menu_bg_music.ogg";
+
+	struct SoundEffectInfo
+	{
+		const char* file;
+		int priority;
+		// voices it may take at once, the oldest restarts past that
+		int max_instances;
+	};
+
+	// In SOUND_EFFECT order
+	const SoundEffectInfo sound_effect_info[] = {
+		{ "hero_hurt.wav", PRIORITY_HIGH, 1 },
+		{ "hero_jump.wav", PRIORITY_HIGH, 1 },
+		{ "sword_swing.wav", PRIORITY_NORMAL, 2 },
+		{ "bow_shoot.wav", PRIORITY_NORMAL, 4 },
+		{ "bow_loading.wav", PRIORITY_LOW, 1 },
+		{ "staff_fire.wav", PRIORITY_NORMAL, 2 },
+		{ "recharge.wav", PRIORITY_LOW, 1 },
+		{ "swoosh.wav", PRIORITY_NORMAL, 2 },
+		//Sound Effect by <a href="https://pixabay.com/users/jigokukarano_sisya-39731529/?utm_source=link-attribution&utm_medium=referral&utm_campaign=music&utm_content=168857">jigokukarano_sisya</a> from <a href="https://pixabay.com/sound-effects//?utm_source=link-attribution&utm_medium=referral&utm_campaign=music&utm_content=168857">Pixabay</a>
+		{ "charge.wav", PRIORITY_LOW, 1 },
+		{ "explosion.wav", PRIORITY_NORMAL, 4 },
+		{ "laser_fire.wav", PRIORITY_NORMAL, 3 },
+		{ "laser_reload.wav", PRIORITY_LOW, 1 },
+		{ "heal.wav", PRIORITY_HIGH, 1 },
+		{ "pickaxe.wav", PRIORITY_NORMAL, 2 },
+		{ "dash.wav", PRIORITY_NORMAL, 1 },
+		{ "equipment_drop.wav", PRIORITY_LOW, 1 },
+		{ "button_click.wav", PRIORITY_HIGH, 1 },
+		{ "teleport.wav", PRIORITY_HIGH, 2 },
+		{ "hades_laugh.wav", PRIORITY_HIGH, 1 },
+		{ "water_ball_shoot.wav", PRIORITY_NORMAL, 3 },
+		{ "boss_slam.wav", PRIORITY_HIGH, 1 },
+		{ "boss_teleport.wav", PRIORITY_HIGH, 1 },
+		{ "boss_summon.wav", PRIORITY_HIGH, 1 },
+		{ "boss_death.wav", PRIORITY_HIGH, 1 },
+		{ "bell.wav", PRIORITY_HIGH, 1 }
+	};
+	static_assert(sizeof(sound_effect_info) / sizeof(sound_effect_info[0]) == (size_t)SOUND_EFFECT::BELL + 1,
+		"sound_effect_info out of sync with SOUND_EFFECT");
+
+	// What each mixer channel was last given; only meaningful while it plays
+	struct Voice
+	{
+		int effect = -1;
+		int priority = PRIORITY_LOW;
+		// order the sounds were started in, lower is older
+		unsigned int serial = 0;
+	};
+	std::array<Voice, VOICE_COUNT> voices;
+	unsigned int next_serial = 0;
+
+	int audio_buffer_samples = 512;
+	vec2 listener_position = { window_width_px / 2.f, window_height_px / 2.f };
+
+	// The channel to play id on, -1 to drop it because every voice is taken by something more important
+	int pick_voice(SOUND_EFFECT id)
+	{
+		const SoundEffectInfo& info = sound_effect_info[(uint)id];
+		int free_voice = -1;
+		int oldest_instance = -1;
+		int instances = 0;
+		int victim = -1;
+		for (int channel = 0; channel < VOICE_COUNT; channel++)
+		{
+			if (!Mix_Playing(channel))
+			{
+				if (free_voice < 0)
+					free_voice = channel;
+				continue;
+			}
+			const Voice& voice = voices[channel];
+			if (voice.effect == (int)id)
+			{
+				instances++;
+				if (oldest_instance < 0 || voice.serial < voices[oldest_instance].serial)
+					oldest_instance = channel;
+			}
+			// lowest priority first, the oldest of those
+			if (voice.priority <= info.priority && (victim < 0 || voice.priority < voices[victim].priority ||
+				(voice.priority == voices[victim].priority && voice.serial < voices[victim].serial)))
+				victim = channel;
+		}
+		if (instances >= info.max_instances)
+			return oldest_instance;
+		if (free_voice >= 0)
+			return free_voice;
+		if (victim >= 0)
+			LOG_EVERY_MS(1000, DEBUG, AUDIO, "All %d voices busy, %s replaces %s", VOICE_COUNT, info.file,
+				sound_effect_info[voices[victim].effect].file);
+		else
+			LOG_EVERY_MS(1000, DEBUG, AUDIO, "All %d voices busy, dropped %s", VOICE_COUNT, info.file);
+		return victim;
+	}
+
+	int start_voice(SOUND_EFFECT id)
+	{
+		int channel = pick_voice(id);
+		if (channel < 0)
+			return -1;
+		if (Mix_Playing(channel))
+			Mix_HaltChannel(channel);
+		channel = Mix_PlayChannel(channel, sound_effects[(uint)id], 0);
+		if (channel < 0)
+			return -1;
+		Voice& voice = voices[channel];
+		voice.effect = (int)id;
+		voice.priority = sound_effect_info[(uint)id].priority;
+		voice.serial = next_serial++;
+		return channel;
+	}
+}
+
+void set_audio_buffer_samples(int samples)
+{
+	// SDL wants a power of two; small enough for tight feedback, large enough not to underrun
+	int rounded = 128;
+	while (rounded < samples && rounded < 4096)
+		rounded *= 2;
+	audio_buffer_samples = rounded;
+}
+
+void set_listener_position(vec2 position)
+{
+	listener_position = position;
+}
+
 uint init_sound()
 {
 	if (SDL_Init(SDL_INIT_AUDIO) < 0)
 	{
-		fprintf(stderr, "Failed to initialize SDL Audio");
+		LOG_ERROR(AUDIO, "Failed to initialize SDL Audio");
 		return 1;
 	}
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1)
+	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, audio_buffer_samples) == -1)
 	{
-		fprintf(stderr, "Failed to open audio device");
+		LOG_ERROR(AUDIO, "Failed to open audio device");
 		return 1;
 	}
-	Mix_VolumeMusic(60);
+	LOG_INFO(AUDIO, "Mixing %d voices in %d sample buffers (%.1f ms)", VOICE_COUNT, audio_buffer_samples,
+		audio_buffer_samples * 1000.f / 44100.f);
+	Mix_AllocateChannels(VOICE_COUNT);
 	Mix_Volume(-1, 60);
 
-	background_music = Mix_LoadMUS(audio_path("music.wav").c_str());
-	dialogue_background_music = Mix_LoadMUS(audio_path("dialogue_bg_music.wav").c_str());
-	main_menu_background_music = Mix_LoadMUS(audio_path("main_menu_bg_music.wav").c_str());
-	sound_effects.push_back(Mix_LoadWAV(audio_path("hero_hurt.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("hero_jump.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("sword_swing.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("bow_shoot.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("bow_loading.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("staff_fire.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("recharge.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("swoosh.wav").c_str()));
-	//Sound Effect by <a href="https://pixabay.com/users/jigokukarano_sisya-39731529/?utm_source=link-attribution&utm_medium=referral&utm_campaign=music&utm_content=168857">jigokukarano_sisya</a> from <a href="https://pixabay.com/sound-effects//?utm_source=link-attribution&utm_medium=referral&utm_campaign=music&utm_content=168857">Pixabay</a>
-	sound_effects.push_back(Mix_LoadWAV(audio_path("charge.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("explosion.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("laser_fire.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("laser_reload.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("heal.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("pickaxe.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("dash.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("equipment_drop.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("button_click.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("teleport.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("hades_laugh.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("water_ball_shoot.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("boss_slam.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("boss_teleport.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("boss_summon.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("boss_death.wav").c_str()));
-	sound_effects.push_back(Mix_LoadWAV(audio_path("bell.wav").c_str()));
-
-	if (background_music == nullptr || dialogue_background_music == nullptr || std::any_of(sound_effects.begin(), sound_effects.end(), [](Mix_Chunk *effect)
+	HEAP_TAG_SCOPE(AUDIO);
+
+	// only the headers are read here, the worker streams the rest
+	bool music_ok = MusicStream::can_play(audio_path(MUSIC_FILE)) && MusicStream::can_play(audio_path(DIALOGUE_MUSIC_FILE)) &&
+		MusicStream::can_play(audio_path(MAIN_MENU_MUSIC_FILE));
+	music_stream.set_volume(MUSIC_VOLUME);
+	if (!music_stream.start())
+	{
+		LOG_ERROR(AUDIO, "Failed to start the music stream");
+		return 1;
+	}
+	for (const SoundEffectInfo& info : sound_effect_info)
+		sound_effects.push_back(Mix_LoadWAV(audio_path(info.file).c_str()));
+
+	if (!music_ok || std::any_of(sound_effects.begin(), sound_effects.end(), [](Mix_Chunk *effect)
 												   { return effect == nullptr; }))
 	{
-		fprintf(stderr, "Failed to load sounds\n %s\n %s\n %s\n make sure the data directory is present",
-				audio_path("music.wav").c_str(),
-				audio_path("hero_hurt.wav").c_str(),
-				audio_path("sword_swing.wav").c_str(),
-				audio_path("hero_jump.wav").c_str(),
-				audio_path("bullet_shoot.wav").c_str(),
-				audio_path("gun_lever.wav").c_str(),
-				audio_path("rocket_launcher_fire.wav").c_str(),
-				audio_path("rocket_launcher_reload.wav").c_str(),
-				audio_path("grenade_launcher_fire.wav").c_str(),
-				audio_path("grenade_launcher_reload.wav").c_str(),
-				audio_path("explosion.wav").c_str(),
-				audio_path("laser_rifle_fire.wav").c_str(),
-				audio_path("laser_rifle_reload.wav").c_str(),
-				audio_path("heal.wav").c_str(),
-				audio_path("pickaxe.wav").c_str(),
-				audio_path("dash.wav").c_str(),
-				audio_path("equipment_drop.wav").c_str(),
-				audio_path("button_click.wav").c_str(),
-				audio_path("button_click.wav").c_str(),
-				audio_path("teleport.wav").c_str(),
-				audio_path("hades_laugh.wav").c_str(),
-				audio_path("water_ball_shoot.wav").c_str());
+		LOG_ERROR(AUDIO, "Failed to load sounds from %s, make sure the data directory is present", audio_path("").c_str());
+		for (uint i = 0; i < sound_effects.size(); i++)
+			if (sound_effects[i] == nullptr)
+				LOG_ERROR(AUDIO, " %s", audio_path(sound_effect_info[i].file).c_str());
+		if (!music_ok)
+			LOG_ERROR(AUDIO, " %s, %s or %s", MUSIC_FILE, DIALOGUE_MUSIC_FILE, MAIN_MENU_MUSIC_FILE);
 		return 1;
 	}
 
@@ -87,11 +208,7 @@ uint init_sound()
 
 void destroy_sound()
 {
-	// Destroy music components
-	if (background_music != nullptr)
-		Mix_FreeMusic(background_music);
-	if (dialogue_background_music != nullptr)
-		Mix_FreeMusic(dialogue_background_music);
+	music_stream.stop();
 	for (Mix_Chunk *effect : sound_effects)
 	{
 		if (effect != nullptr)
@@ -102,41 +219,70 @@ void destroy_sound()
 	Mix_CloseAudio();
 }
 
+void report_sound_memory()
+{
+	size_t total = 0;
+	for (uint i = 0; i < sound_effects.size(); i++)
+	{
+		if (sound_effects[i] == nullptr)
+			continue;
+		LOG_INFO(AUDIO, "%-24s %8.1f KB", sound_effect_info[i].file, sound_effects[i]->alen / 1024.f);
+		total += sound_effects[i]->alen;
+	}
+	LOG_INFO(AUDIO, "%u sound effects: %.1f KB decoded", (uint)sound_effects.size(), total / 1024.f);
+	LOG_INFO(AUDIO, "music stream buffers: %.1f KB", music_stream.memory_bytes() / 1024.f);
+}
+
 void play_main_menu_music() {
-	Mix_PlayMusic(main_menu_background_music, -1);
-	fprintf(stderr, "Loaded main menu music\n");
+	music_stream.play(audio_path(MAIN_MENU_MUSIC_FILE), MUSIC_FADE_MS);
+	LOG_INFO(AUDIO, "Loaded main menu music");
 }
 
 void play_music()
 {
-	Mix_FadeOutMusic(300);
-	Mix_PlayMusic(background_music, -1);
-	fprintf(stderr, "Loaded music\n");
+	music_stream.play(audio_path(MUSIC_FILE), MUSIC_FADE_MS);
+	LOG_INFO(AUDIO, "Loaded music");
 }
 
 void set_mute_music(bool muted)
 {
 	if (muted)
 	{
-		Mix_VolumeMusic(0);
+		music_stream.set_volume(0.f);
 	}
 	else
 	{
-		Mix_VolumeMusic(60);
+		music_stream.set_volume(MUSIC_VOLUME);
 	}
 }
 
 void play_sound(SOUND_EFFECT id)
 {
-	Mix_PlayChannel(-1, sound_effects[(uint)id], 0);
+	int channel = start_voice(id);
+	// a voice that was positioned before plays centered again
+	if (channel >= 0)
+		Mix_SetPosition(channel, 0, 0);
+}
+
+void play_sound(SOUND_EFFECT id, vec2 emitter_position)
+{
+	int channel = start_voice(id);
+	if (channel < 0)
+		return;
+	// side view: left and right of the listener pan, distance in any direction attenuates
+	vec2 offset = emitter_position - listener_position;
+	float pan = clamp(offset.x / (window_width_px * 0.5f), -1.f, 1.f);
+	int angle = (int)(pan * 90.f);
+	if (angle < 0)
+		angle += 360;
+	float falloff = clamp(length(offset) / AUDIBLE_RANGE, 0.f, 1.f);
+	Mix_SetPosition(channel, (Sint16)angle, (Uint8)(falloff * FAR_DISTANCE));
 }
 
 void play_dialogue_music() {
-	Mix_FadeOutMusic(300);
-	Mix_PlayMusic(dialogue_background_music, -1);
+	music_stream.play(audio_path(DIALOGUE_MUSIC_FILE), MUSIC_FADE_MS);
 }
 
 void stop_dialogue_music() {
-	Mix_FadeOutMusic(100);
 	play_music();
 }
\ No newline at end of file
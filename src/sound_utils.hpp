@@ -16,8 +16,13 @@ extern bool is_music_muted;
 
 #endif
 
+// Mixer buffer length, applied by init_sound. Lower is tighter feedback but
+// more wakeups of the audio thread; rounded to a power of two in [128, 4096].
+void set_audio_buffer_samples(int samples);
 uint init_sound();
 void destroy_sound();
+// Logs the decoded size of every sound effect
+void report_sound_memory();
 
 
 enum class SOUND_EFFECT {
@@ -50,7 +55,14 @@ enum class SOUND_EFFECT {
 
 void play_main_menu_music();
 void play_music();
+// Plays on a pooled voice. Past an effect's instance limit its oldest
+// instance restarts; with every voice busy the oldest of the lowest priority
+// sounds no more important than this one gives up its voice, or this is dropped.
 void play_sound(SOUND_EFFECT id);
+// Same, panned and attenuated by where the emitter is relative to the listener
+void play_sound(SOUND_EFFECT id, vec2 emitter_position);
+// Where sounds are heard from, the hero
+void set_listener_position(vec2 position);
 void set_mute_music(bool mute);
 void play_dialogue_music();
 void stop_dialogue_music();
\ No newline at end of file
@@ -0,0 +1,218 @@
+// Header
+#include "spawn_director.hpp"
+#include "json.hpp"
+#include "logger.hpp"
+
+// stlib
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	const char* const enemy_names[ENEMY_COUNT] = { "fireling", "ghoul", "spitter", "boulder" };
+
+	int enemy_index(const std::string& name)
+	{
+		for (int i = 0; i < ENEMY_COUNT; i++)
+		{
+			if (name == enemy_names[i])
+				return i;
+		}
+		return -1;
+	}
+}
+
+void AliasTable::build(const float weights[ENEMY_COUNT])
+{
+	float total = 0.f;
+	for (int i = 0; i < ENEMY_COUNT; i++)
+		total += weights[i];
+	empty = total <= 0.f;
+	if (empty)
+		return;
+
+	// scaled so the average column holds exactly 1
+	float scaled[ENEMY_COUNT];
+	int small[ENEMY_COUNT], large[ENEMY_COUNT];
+	int small_count = 0, large_count = 0;
+	for (int i = 0; i < ENEMY_COUNT; i++)
+	{
+		scaled[i] = weights[i] * ENEMY_COUNT / total;
+		if (scaled[i] < 1.f)
+			small[small_count++] = i;
+		else
+			large[large_count++] = i;
+	}
+	// each under-full column is topped up from an over-full one
+	while (small_count > 0 && large_count > 0)
+	{
+		int less = small[--small_count];
+		int more = large[--large_count];
+		probability[less] = scaled[less];
+		alias[less] = more;
+		scaled[more] -= 1.f - scaled[less];
+		if (scaled[more] < 1.f)
+			small[small_count++] = more;
+		else
+			large[large_count++] = more;
+	}
+	// what is left is full up to rounding
+	while (large_count > 0)
+	{
+		int column = large[--large_count];
+		probability[column] = 1.f;
+		alias[column] = column;
+	}
+	while (small_count > 0)
+	{
+		int column = small[--small_count];
+		probability[column] = 1.f;
+		alias[column] = column;
+	}
+}
+
+int AliasTable::sample(float column_draw, float alias_draw) const
+{
+	if (empty)
+		return -1;
+	int column = std::min((int)(column_draw * ENEMY_COUNT), ENEMY_COUNT - 1);
+	return alias_draw < probability[column] ? column : alias[column];
+}
+
+SpawnDirector::SpawnDirector()
+	: rng(std::random_device()())
+{
+}
+
+bool SpawnDirector::load(const std::string& path)
+{
+	tiers.clear();
+	tier = nullptr;
+	level = -1;
+
+	std::ifstream in(path);
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	std::string text = buffer.str();
+	json::Document doc;
+	if (text == "" || !doc.Parse(std::move(text)))
+	{
+		LOG_ERROR(SPAWN, "could not read spawn tiers from %s", path.c_str());
+		return false;
+	}
+
+	json::Document::Value root = doc.Root();
+	if (root.hasKey("spawn_delay_variance"))
+		spawn_delay_variance = (float)root["spawn_delay_variance"].ToFloat();
+	if (root.hasKey("max_spawns_per_step"))
+		max_spawns_per_step = std::max(1, (int)root["max_spawns_per_step"].ToInt());
+
+	json::Document::Value tier_list = root["tiers"];
+	for (int t = 0; t < tier_list.size(); t++)
+	{
+		json::Document::Value entry = tier_list[t];
+		SpawnTier loaded;
+		loaded.spawn_delay_ms = (float)entry["spawn_delay_ms"].ToFloat();
+		loaded.wave_size = std::max(1, (int)entry["wave_size"].ToInt());
+		loaded.spitter_shot_delay_ms = (float)entry["spitter_shot_delay_ms"].ToFloat();
+
+		float weights[ENEMY_COUNT] = {};
+		json::Document::Value enemies = entry["enemies"];
+		for (int e = 0; e < enemies.size(); e++)
+		{
+			std::string name = enemies.key(e).ToString();
+			int type = enemy_index(name);
+			if (type < 0)
+			{
+				LOG_WARN(SPAWN, "tier %d: unknown enemy \"%s\"", t, name.c_str());
+				continue;
+			}
+			weights[type] = (float)enemies.value(e)["weight"].ToFloat();
+			loaded.max_alive[type] = (int)enemies.value(e)["max_alive"].ToInt();
+		}
+		loaded.table.build(weights);
+		tiers.push_back(loaded);
+	}
+	if (tiers.empty())
+	{
+		LOG_ERROR(SPAWN, "%s defines no spawn tiers", path.c_str());
+		return false;
+	}
+	LOG_INFO(SPAWN, "loaded %zu spawn tiers", tiers.size());
+	return true;
+}
+
+void SpawnDirector::set_level(int ddl)
+{
+	if ((tier && ddl == level) || tiers.empty())
+		return;
+	level = ddl;
+	// the last tier is the fallback for any other level, like the default of the old switch
+	bool listed = ddl >= 0 && ddl < (int)tiers.size();
+	tier = &tiers[listed ? ddl : tiers.size() - 1];
+	// a wave picked for the old caps may not fit the new ones
+	pending.clear();
+	for (int& count : pending_count)
+		count = 0;
+	LOG_DEBUG(SPAWN, "spawn tier %d", ddl);
+}
+
+void SpawnDirector::reset()
+{
+	pending.clear();
+	for (int& count : pending_count)
+		count = 0;
+	next_wave_ms = 0.f;
+}
+
+void SpawnDirector::step(float elapsed_ms, size_t enemy_count, const size_t alive[ENEMY_COUNT])
+{
+	step_budget = max_spawns_per_step;
+	if (!tier)
+		return;
+
+	// the timer runs faster while few enemies are around
+	next_wave_ms -= elapsed_ms * (5.f / (enemy_count + 1) + 0.5f);
+	LOG_EVERY_MS(1000, DEBUG, SPAWN, "next enemy spawn in %.0f", next_wave_ms);
+	if (next_wave_ms > 0.f)
+		return;
+
+	for (int i = 0; i < tier->wave_size; i++)
+	{
+		SpawnableEnemyType type = pick(alive);
+		if (type == ENEMY_COUNT)
+			break;
+		pending.push_back(type);
+		pending_count[type]++;
+	}
+	float delay = tier->spawn_delay_ms;
+	next_wave_ms = delay * spawn_delay_variance + uniform_dist(rng) * delay * (1.f - spawn_delay_variance);
+}
+
+SpawnableEnemyType SpawnDirector::pick(const size_t alive[ENEMY_COUNT])
+{
+	int selected = tier->table.sample(uniform_dist(rng), uniform_dist(rng));
+	if (selected < 0)
+		return ENEMY_COUNT;
+	// a type at its cap hands the spawn on to the next type in order
+	while (selected < ENEMY_COUNT && alive[selected] + (size_t)pending_count[selected] >= (size_t)tier->max_alive[selected])
+		selected++;
+	return SpawnableEnemyType(selected);
+}
+
+bool SpawnDirector::next_spawn(SpawnableEnemyType& type)
+{
+	if (step_budget <= 0 || pending.empty())
+		return false;
+	type = pending.front();
+	pending.pop_front();
+	pending_count[type]--;
+	step_budget--;
+	return true;
+}
+
+float SpawnDirector::spitter_shot_delay_ms() const
+{
+	return tier ? tier->spitter_shot_delay_ms : 5000.f;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// stlib
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+enum SpawnableEnemyType {
+        FIRELINGS = 0,
+        GHOULS = FIRELINGS + 1,
+        SPITTERS = GHOULS + 1,
+        BOULDERS = SPITTERS + 1,
+        ENEMY_COUNT = BOULDERS + 1
+};
+
+// Walker's alias method: one uniform draw picks a column, a second one picks
+// between the column and its alias, so a pick costs the same for any weights
+class AliasTable
+{
+public:
+	// weights need not sum to one; all zero leaves every pick at -1
+	void build(const float weights[ENEMY_COUNT]);
+	int sample(float column_draw, float alias_draw) const;
+
+private:
+	float probability[ENEMY_COUNT] = {};
+	int alias[ENEMY_COUNT] = {};
+	bool empty = true;
+};
+
+// One difficulty level of data/spawns.json
+struct SpawnTier
+{
+	float spawn_delay_ms = 6000.f;
+	// enemies queued each time the spawn timer runs out
+	int wave_size = 1;
+	float spitter_shot_delay_ms = 5000.f;
+	int max_alive[ENEMY_COUNT] = {};
+	AliasTable table;
+};
+
+// Decides when and what to spawn from the tiers loaded at startup. A wave is
+// picked when the timer runs out and queued; creating the entities is left to
+// the caller, at most max_spawns_per_step of them per step.
+class SpawnDirector
+{
+public:
+	SpawnDirector();
+
+	// false when the file is missing or has no tiers, nothing spawns then
+	bool load(const std::string& path);
+
+	// Switches tier when ddl changed; a ddl without a tier of its own, negative
+	// or past the end, uses the last one
+	void set_level(int ddl);
+	// Forgets queued spawns and restarts the timer, for a new game
+	void reset();
+
+	// Counts the timer down and queues the next wave when it runs out. alive
+	// holds the enemies of each type already in the world.
+	void step(float elapsed_ms, size_t enemy_count, const size_t alive[ENEMY_COUNT]);
+	// Pops the next queued spawn while this step's budget lasts
+	bool next_spawn(SpawnableEnemyType& type);
+
+	float spitter_shot_delay_ms() const;
+
+private:
+	// the enemy to queue or ENEMY_COUNT when every candidate is at its cap
+	SpawnableEnemyType pick(const size_t alive[ENEMY_COUNT]);
+
+	std::vector<SpawnTier> tiers;
+	float spawn_delay_variance = 0.6f;
+	int max_spawns_per_step = 1;
+
+	int level = -1;
+	const SpawnTier* tier = nullptr;
+	float next_wave_ms = 0.f;
+	int step_budget = 0;
+	std::deque<SpawnableEnemyType> pending;
+	int pending_count[ENEMY_COUNT] = {};
+
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> uniform_dist;
+};
@@ -0,0 +1,189 @@
+// Header
+#include "texture_cache.hpp"
+#include "mesh_cache.hpp" // fnv1a_hash, read_file_bytes
+#include "logger.hpp"
+
+// stlib
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const uint32_t TEXTURE_CACHE_MAGIC = 0x43545454; // "TTTC"
+	const uint32_t TEXTURE_CACHE_VERSION = 1;
+	const uint64_t PIXEL_ALIGNMENT = 16;
+
+	struct TextureCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t count;
+		uint32_t reserved;
+	};
+
+	struct TextureCacheEntry
+	{
+		uint64_t path_hash;
+		uint64_t source_size;
+		int64_t source_mtime;
+		uint64_t offset;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	bool source_stat(const std::string& path, uint64_t& out_size, int64_t& out_mtime)
+	{
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+			return false;
+		out_size = (uint64_t)st.st_size;
+		out_mtime = (int64_t)st.st_mtime;
+		return true;
+	}
+
+	uint64_t align(uint64_t offset)
+	{
+		return (offset + PIXEL_ALIGNMENT - 1) & ~(PIXEL_ALIGNMENT - 1);
+	}
+}
+
+bool TextureCache::open(const std::string& path, size_t texture_count)
+{
+	close();
+#ifdef _WIN32
+	if (!read_file_bytes(path, fallback))
+		return false;
+	data = (const unsigned char*)fallback.data();
+	size = fallback.size();
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+	data = (const unsigned char*)mapped;
+	size = (size_t)st.st_size;
+#endif
+
+	TextureCacheHeader header;
+	if (size < sizeof(header))
+	{
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION || header.count != texture_count ||
+		size < sizeof(header) + texture_count * sizeof(TextureCacheEntry))
+	{
+		close();
+		return false;
+	}
+	count = texture_count;
+	return true;
+}
+
+void TextureCache::close()
+{
+#ifndef _WIN32
+	if (data != nullptr)
+		munmap((void*)data, size);
+#endif
+	fallback = std::vector<char>();
+	data = nullptr;
+	size = 0;
+	count = 0;
+}
+
+const unsigned char* TextureCache::lookup(size_t index, const std::string& source_path, ivec2& out_size) const
+{
+	if (data == nullptr || index >= count)
+		return nullptr;
+
+	TextureCacheEntry entry;
+	memcpy(&entry, data + sizeof(TextureCacheHeader) + index * sizeof(TextureCacheEntry), sizeof(entry));
+
+	uint64_t source_size;
+	int64_t source_mtime;
+	if (!source_stat(source_path, source_size, source_mtime) ||
+		entry.path_hash != fnv1a_hash(source_path.data(), source_path.size()) ||
+		entry.source_size != source_size || entry.source_mtime != source_mtime)
+		return nullptr;
+
+	uint64_t bytes = (uint64_t)entry.width * entry.height * 4;
+	if (entry.offset + bytes > size)
+		return nullptr;
+
+	out_size = { (int)entry.width, (int)entry.height };
+	return data + entry.offset;
+}
+
+bool write_texture_cache(const std::string& path, const std::vector<std::string>& sources, const std::vector<ivec2>& sizes,
+	const std::function<void(size_t, unsigned char*)>& fetch_pixels)
+{
+	TextureCacheHeader header = { TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, (uint32_t)sources.size(), 0 };
+	std::vector<TextureCacheEntry> entries(sources.size());
+
+	uint64_t offset = align(sizeof(header) + entries.size() * sizeof(TextureCacheEntry));
+	size_t largest = 0;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		TextureCacheEntry& entry = entries[i];
+		if (!source_stat(sources[i], entry.source_size, entry.source_mtime))
+			return false;
+		entry.path_hash = fnv1a_hash(sources[i].data(), sources[i].size());
+		entry.width = (uint32_t)sizes[i].x;
+		entry.height = (uint32_t)sizes[i].y;
+		entry.offset = offset;
+		size_t bytes = (size_t)entry.width * entry.height * 4;
+		largest = (bytes > largest) ? bytes : largest;
+		offset = align(offset + bytes);
+	}
+
+	std::string tmp_path = path + ".tmp";
+	FILE* file = fopen(tmp_path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		LOG_ERROR(RENDER, "Failed to write texture cache %s", tmp_path.c_str());
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fwrite(entries.data(), sizeof(TextureCacheEntry), entries.size(), file) == entries.size();
+	std::vector<unsigned char> pixels(largest);
+	const char zeros[PIXEL_ALIGNMENT] = {};
+	for (size_t i = 0; ok && i < entries.size(); i++)
+	{
+		long pad = (long)entries[i].offset - ftell(file);
+		ok = pad >= 0 && fwrite(zeros, 1, (size_t)pad, file) == (size_t)pad;
+		size_t bytes = (size_t)entries[i].width * entries[i].height * 4;
+		fetch_pixels(i, pixels.data());
+		ok = ok && fwrite(pixels.data(), 1, bytes, file) == bytes;
+	}
+	ok = (fclose(file) == 0) && ok;
+
+#ifdef _WIN32
+	// rename doesn't replace on Windows
+	remove(path.c_str());
+#endif
+	ok = ok && rename(tmp_path.c_str(), path.c_str()) == 0;
+	if (!ok)
+	{
+		LOG_ERROR(RENDER, "Failed to write texture cache %s", path.c_str());
+		remove(tmp_path.c_str());
+	}
+	return ok;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <string>
+#include <vector>
+#include <functional>
+
+// Packed cache of decoded RGBA8 textures, so launches after the first skip PNG
+// decoding entirely.
+//
+// Layout: a header, one entry per texture, then the raw pixels of every
+// texture (16-byte aligned). Each entry records the source path hash and the
+// PNG's size and modification time; a texture whose PNG changed (or moved in
+// texture_paths) misses and is decoded again, and the file is rewritten once
+// loading finishes. The file is memory mapped and pixels are uploaded straight
+// from the mapping.
+class TextureCache
+{
+public:
+	// Maps the cache; false if it's missing or has the wrong format or count
+	bool open(const std::string& path, size_t texture_count);
+	void close();
+
+	// Pixels of texture index if the entry matches source_path as it is on disk now
+	const unsigned char* lookup(size_t index, const std::string& source_path, ivec2& out_size) const;
+
+	~TextureCache() { close(); }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	size_t count = 0;
+	std::vector<char> fallback; // used where mmap isn't available
+};
+
+// Writes a fresh cache for sources with the given sizes. fetch_pixels(i, out)
+// fills out with width * height * 4 bytes of texture i. The file is written
+// to path.tmp and renamed over path.
+bool write_texture_cache(const std::string& path, const std::vector<std::string>& sources, const std::vector<ivec2>& sizes,
+	const std::function<void(size_t, unsigned char*)>& fetch_pixels);
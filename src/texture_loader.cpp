@@ -0,0 +1,82 @@
+// Header
+#include "texture_loader.hpp"
+#include "heap_counter.hpp"
+
+// stlib
+#include <chrono>
+#include <algorithm>
+
+#include "../ext/stb_image/stb_image.h"
+
+void TextureLoader::start(const std::vector<std::string>& paths_arg, const std::vector<int>& jobs, unsigned int thread_count)
+{
+	join();
+	paths = paths_arg;
+	order = jobs;
+	handed_out = 0;
+	next_job = 0;
+
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	thread_count = std::min<unsigned int>(thread_count, (unsigned int)order.size());
+	for (unsigned int i = 0; i < thread_count; i++)
+		workers.emplace_back(&TextureLoader::run, this);
+}
+
+void TextureLoader::run()
+{
+	HEAP_TAG_SCOPE(TEXTURES);
+	while (true)
+	{
+		size_t job = next_job++;
+		if (job >= order.size())
+			return;
+
+		DecodedImage image;
+		image.index = order[job];
+		auto start = std::chrono::high_resolution_clock::now();
+		image.pixels = stbi_load(paths[image.index].c_str(), &image.size.x, &image.size.y, NULL, 4);
+		auto end = std::chrono::high_resolution_clock::now();
+		image.decode_ms = (float)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.f;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(image);
+		}
+		ready.notify_one();
+	}
+}
+
+bool TextureLoader::pop(DecodedImage& out, bool wait)
+{
+	if (finished())
+		return false;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if (wait)
+		ready.wait(lock, [this]() { return !decoded.empty(); });
+	if (decoded.empty())
+		return false;
+
+	out = decoded.front();
+	decoded.pop_front();
+	handed_out++;
+	return true;
+}
+
+void TextureLoader::join()
+{
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+
+	// anything decoded but never collected
+	for (DecodedImage& image : decoded)
+		stbi_image_free(image.pixels);
+	decoded.clear();
+}
+
+TextureLoader::~TextureLoader()
+{
+	join();
+}
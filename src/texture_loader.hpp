@@ -0,0 +1,57 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+
+// stlib
+#include <vector>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// One decoded image, handed from a decode worker to the GL thread.
+// pixels is RGBA8 owned by stb_image; free it with stbi_image_free after upload.
+struct DecodedImage
+{
+	int index = -1;
+	ivec2 size = { 0, 0 };
+	unsigned char* pixels = nullptr;
+	float decode_ms = 0.f;
+};
+
+// Decodes images on a small pool of worker threads. jobs lists the indices of
+// paths to decode, in the order they should be started, so the caller can put
+// what it needs first up front and leave out anything it already has. Results
+// arrive in completion order through pop(); GL work stays on the caller.
+class TextureLoader
+{
+public:
+	// thread_count 0 picks the hardware concurrency
+	void start(const std::vector<std::string>& paths, const std::vector<int>& jobs, unsigned int thread_count = 0);
+
+	// Takes the next decoded image. If wait is set, blocks until one is ready;
+	// returns false once every image has been handed out (or nothing is ready and !wait).
+	bool pop(DecodedImage& out, bool wait);
+
+	// true once every image has been handed out through pop()
+	bool finished() const { return handed_out == order.size(); }
+
+	void join();
+	~TextureLoader();
+
+private:
+	void run();
+
+	std::vector<std::string> paths;
+	std::vector<int> order;
+	std::atomic<size_t> next_job{ 0 };
+	size_t handed_out = 0;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<DecodedImage> decoded;
+};
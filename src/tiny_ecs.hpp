@@ -8,6 +8,8 @@
 #include <typeindex>
 #include <assert.h>
 
+#include "heap_counter.hpp"
+
 // Unique identifyer for all entities
 class Entity
 {
@@ -20,6 +22,59 @@ public:
 		// Note, indices of already deleted entities arent re-used in this simple implementation.
 	}
 	operator unsigned int() { return id; } // this enables automatic casting to int
+	// Ids handed out so far; they are never re-used, so this only grows
+	static unsigned int created() { return id_count - 1; }
+};
+
+// Hands freed single objects, in practice hash map nodes, back out on the next
+// allocation instead of returning them to the heap, so a container that keeps
+// gaining and losing entities stops allocating once it reached its peak size.
+// The free list is shared by every map with the same node type and never
+// released; only the main thread changes the registry.
+template <typename T>
+struct RecyclingAllocator
+{
+	using value_type = T;
+
+	RecyclingAllocator() = default;
+	template <typename U>
+	RecyclingAllocator(const RecyclingAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		void*& head = free_list();
+		if (n == 1 && head)
+		{
+			void* recycled = head;
+			head = *static_cast<void**>(recycled);
+			return static_cast<T*>(recycled);
+		}
+		return static_cast<T*>(::operator new(std::max(n * sizeof(T), sizeof(void*))));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		if (n != 1)
+		{
+			::operator delete(p);
+			return;
+		}
+		void*& head = free_list();
+		*reinterpret_cast<void**>(p) = head;
+		head = p;
+	}
+
+	template <typename U>
+	bool operator==(const RecyclingAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const RecyclingAllocator<U>&) const { return false; }
+
+private:
+	static void*& free_list()
+	{
+		static void* head = nullptr;
+		return head;
+	}
 };
 
 // Common interface to refer to all containers in the ECS registry
@@ -29,6 +84,8 @@ struct ContainerInterface
 	virtual size_t size() = 0;
 	virtual void remove(Entity e) = 0;
 	virtual bool has(Entity entity) = 0;
+	// Bytes held by the container itself; heap memory owned by the components is not followed
+	virtual size_t memory_bytes() = 0;
 };
 
 // A container that stores components of type 'Component' and associated entities
@@ -37,7 +94,8 @@ class ComponentContainer : public ContainerInterface
 {
 private:
 	// The hash map from Entity -> array index.
-	std::unordered_map<unsigned int, unsigned int> map_entity_componentID; // the entity is cast to uint to be hashable.
+	std::unordered_map<unsigned int, unsigned int, std::hash<unsigned int>, std::equal_to<unsigned int>,
+		RecyclingAllocator<std::pair<const unsigned int, unsigned int>>> map_entity_componentID; // the entity is cast to uint to be hashable.
 	bool registered = false;
 public:
 	// Container of all components of type 'Component'
@@ -57,6 +115,7 @@ public:
 		// Usually, every entity should only have one instance of each component type
 		assert(!(check_for_duplicates && has(e)) && "Entity already contained in ECS registry");
 
+		HEAP_TAG_SCOPE(ECS);
 		map_entity_componentID[e] = (unsigned int)components.size();
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
@@ -73,6 +132,22 @@ public:
 		return insert(e, Component(std::forward<Args>(args)...), false);
 	};
 
+	// Makes room for n more components ahead of a batch of inserts. Grows
+	// geometrically like push_back, so reserving for a single insert is cheap.
+	void reserve_more(size_t n)
+	{
+		HEAP_TAG_SCOPE(ECS);
+		size_t needed = components.size() + n;
+		if (needed > components.capacity())
+		{
+			size_t capacity = std::max(needed, components.capacity() * 2);
+			components.reserve(capacity);
+			entities.reserve(capacity);
+		}
+		if (needed > map_entity_componentID.bucket_count() * map_entity_componentID.max_load_factor())
+			map_entity_componentID.reserve(std::max(needed, map_entity_componentID.size() * 2));
+	}
+
 	// A wrapper to return the component of an entity
 	Component& get(Entity e) {
 		assert(has(e) && "Entity not contained in ECS registry");
@@ -120,6 +195,14 @@ public:
 		return components.size();
 	}
 
+	size_t memory_bytes()
+	{
+		// a node is the key/value pair plus the next pointer, a bucket is one pointer
+		size_t node_bytes = sizeof(std::pair<const unsigned int, unsigned int>) + sizeof(void*);
+		return components.capacity() * sizeof(Component) + entities.capacity() * sizeof(Entity)
+			+ map_entity_componentID.bucket_count() * sizeof(void*) + map_entity_componentID.size() * node_bytes;
+	}
+
 	// Sort the components and associated entity assignment structures by the comparisonFunction, see std::sort
 	template <class Compare>
 	void sort(Compare comparisonFunction)
@@ -1,9 +1,18 @@
 #pragma once
 #include <vector>
+#include <typeinfo>
 
 #include "tiny_ecs.hpp"
 #include "components.hpp"
 
+// One line of the registry's memory report
+struct ContainerMemory
+{
+	const char* type;
+	size_t components;
+	size_t bytes;
+};
+
 class ECSRegistry
 {
 	// Callbacks to remove a particular or all entities in the system
@@ -50,6 +59,8 @@ public:
 	ComponentContainer<Laser> lasers;
 	ComponentContainer<Trident> tridents;
 	ComponentContainer<WaterBall> waterBalls;
+	ComponentContainer<Polyline> polylines;
+	ComponentContainer<Text> texts;
 	ComponentContainer<Weapon> weapons;
 	ComponentContainer<WeaponHitBox> weaponHitBoxes;
 	ComponentContainer<DebugComponent> debugComponents;
@@ -59,6 +70,7 @@ public:
     ComponentContainer<ShowWhenPaused> showWhenPaused;
 	ComponentContainer<InGameGUI> inGameGUIs;
 	ComponentContainer<LavaPillar> lavaPillars;
+	ComponentContainer<Lava> lava;
 	ComponentContainer<Dialogue> dialogues;
 	ComponentContainer<DialogueText> dialogueTexts;
 
@@ -105,6 +117,8 @@ public:
 		registry_list.push_back(&lasers);
 		registry_list.push_back(&tridents);
 		registry_list.push_back(&waterBalls);
+		registry_list.push_back(&polylines);
+		registry_list.push_back(&texts);
 		registry_list.push_back(&weapons);
 		registry_list.push_back(&weaponHitBoxes);
 		registry_list.push_back(&debugComponents);
@@ -113,6 +127,7 @@ public:
         registry_list.push_back(&buttons);
         registry_list.push_back(&showWhenPaused);
 		registry_list.push_back(&lavaPillars);
+		registry_list.push_back(&lava);
         registry_list.push_back(&dialogues);
 		registry_list.push_back(&dialogueTexts);
 		registry_list.push_back(&inGameGUIs);
@@ -132,6 +147,16 @@ public:
 				printf("%4d components of type %s\n", (int)reg->size(), typeid(*reg).name());
 	}
 
+	// Every container in registration order, empty ones included so reports line up
+	std::vector<ContainerMemory> memory_usage()
+	{
+		std::vector<ContainerMemory> usage;
+		usage.reserve(registry_list.size());
+		for (ContainerInterface *reg : registry_list)
+			usage.push_back({ typeid(*reg).name(), reg->size(), reg->memory_bytes() });
+		return usage;
+	}
+
 	void list_all_components_of(Entity e)
 	{
 		printf("Debug info on components of entity %u:\n", (unsigned int)e);
@@ -0,0 +1,1040 @@
+// Header
+#include "vorbis_decoder.hpp"
+
+// stlib
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const double PI = 3.14159265358979323846;
+
+	const int PACKET_IDENTIFICATION = 1;
+	const int PACKET_COMMENT = 3;
+	const int PACKET_SETUP = 5;
+	const int CODEBOOK_SYNC = 0x564342;
+	const int MAX_FLOOR1_VALUES = 65;
+	const long long MAX_CODEBOOK_VALUES = 1 << 20;
+	const int FLOOR1_RANGES[4] = { 256, 128, 86, 64 };
+
+	// number of bits needed to hold value, 0 for 0
+	int ilog(unsigned int value)
+	{
+		int bits = 0;
+		while (value > 0)
+		{
+			bits++;
+			value >>= 1;
+		}
+		return bits;
+	}
+
+	float float32_unpack(uint32_t word)
+	{
+		double mantissa = word & 0x1fffff;
+		if (word & 0x80000000u)
+			mantissa = -mantissa;
+		int exponent = (int)((word & 0x7fe00000u) >> 21);
+		return (float)ldexp(mantissa, exponent - 788);
+	}
+
+	// the largest r with r^dimensions <= entries
+	int lookup1_values(int entries, int dimensions)
+	{
+		int r = (int)floor(exp(log((double)entries) / dimensions));
+		auto fits = [&](long long root)
+		{
+			long long power = 1;
+			for (int i = 0; i < dimensions; i++)
+			{
+				power *= root;
+				if (power > entries)
+					return false;
+			}
+			return true;
+		};
+		while (fits(r + 1))
+			r++;
+		while (r > 0 && !fits(r))
+			r--;
+		return r;
+	}
+
+	// floor1 amplitudes are 256 steps over 140 dB
+	float inverse_db(int step)
+	{
+		static float table[256];
+		static bool filled = false;
+		if (!filled)
+		{
+			for (int i = 0; i < 256; i++)
+				table[i] = (float)pow(10.0, (i - 255) * 0.546875 / 20.0);
+			filled = true;
+		}
+		return table[std::min(std::max(step, 0), 255)];
+	}
+
+	int render_point(int x0, int y0, int x1, int y1, int x)
+	{
+		int dy = y1 - y0;
+		int adx = x1 - x0;
+		int offset = std::abs(dy) * (x - x0) / adx;
+		return dy < 0 ? y0 - offset : y0 + offset;
+	}
+
+	// Bresenham style line of floor steps from x0 up to, not including, x1,
+	// clipped to the half block
+	void render_line(int x0, int y0, int x1, int y1, int* steps, int half)
+	{
+		int dy = y1 - y0;
+		int adx = x1 - x0;
+		if (adx <= 0)
+			return;
+		int base = dy / adx;
+		int sy = dy < 0 ? base - 1 : base + 1;
+		int ady = std::abs(dy) - std::abs(base) * adx;
+		int y = y0;
+		int err = 0;
+		if (x0 < half)
+			steps[x0] = y;
+		for (int x = x0 + 1; x < x1 && x < half; x++)
+		{
+			err += ady;
+			if (err >= adx)
+			{
+				err -= adx;
+				y += sy;
+			}
+			else
+			{
+				y += base;
+			}
+			steps[x] = y;
+		}
+	}
+}
+
+// Vorbis packs its fields least significant bit first. Reading past the end
+// yields zeros and sets overrun, which ends the packet early.
+struct VorbisDecoder::BitReader
+{
+	const unsigned char* data;
+	size_t bytes;
+	size_t position = 0;
+	bool overrun = false;
+
+	BitReader(const unsigned char* data, size_t bytes) : data(data), bytes(bytes) {}
+
+	int bit()
+	{
+		if (position >= bytes * 8)
+		{
+			overrun = true;
+			return 0;
+		}
+		int value = (data[position >> 3] >> (position & 7)) & 1;
+		position++;
+		return value;
+	}
+
+	uint32_t read(int count)
+	{
+		uint32_t value = 0;
+		int got = 0;
+		while (got < count)
+		{
+			if (position >= bytes * 8)
+			{
+				overrun = true;
+				return 0;
+			}
+			int offset = (int)(position & 7);
+			int take = std::min(count - got, 8 - offset);
+			uint32_t part = (data[position >> 3] >> offset) & ((1u << take) - 1);
+			value |= part << got;
+			got += take;
+			position += take;
+		}
+		return value;
+	}
+};
+
+int VorbisDecoder::Codebook::decode_scalar(BitReader& bits) const
+{
+	if (tree.empty())
+		return -1;
+	int node = 0;
+	while (true)
+	{
+		int child = tree[node * 2 + bits.bit()];
+		if (bits.overrun || child == 0)
+			return -1;
+		if (child < 0)
+			return ~child;
+		node = child;
+	}
+}
+
+const float* VorbisDecoder::Codebook::decode_vector(BitReader& bits) const
+{
+	int entry = decode_scalar(bits);
+	if (entry < 0)
+		return nullptr;
+	return &values[(size_t)entry * dimensions];
+}
+
+bool VorbisDecoder::read_identification(const unsigned char* packet, size_t bytes)
+{
+	identified = false;
+	set_up = false;
+	if (bytes < 30 || packet[0] != PACKET_IDENTIFICATION || memcmp(packet + 1, "vorbis", 6) != 0)
+		return false;
+	BitReader bits(packet + 7, bytes - 7);
+	uint32_t version = bits.read(32);
+	channel_count = (int)bits.read(8);
+	sample_rate = (int)bits.read(32);
+	bits.read(32); // bitrates: maximum, nominal, minimum
+	bits.read(32);
+	bits.read(32);
+	int short_exponent = (int)bits.read(4);
+	int long_exponent = (int)bits.read(4);
+	bool framing = bits.read(1) == 1;
+	if (version != 0 || channel_count < 1 || sample_rate < 1 || !framing ||
+		short_exponent < 6 || long_exponent > 13 || short_exponent > long_exponent)
+		return false;
+	block_size[0] = 1 << short_exponent;
+	block_size[1] = 1 << long_exponent;
+	identified = true;
+	return true;
+}
+
+bool VorbisDecoder::read_comment(const unsigned char* packet, size_t bytes)
+{
+	// the tags are of no use to the game
+	return identified && bytes >= 7 && packet[0] == PACKET_COMMENT && memcmp(packet + 1, "vorbis", 6) == 0;
+}
+
+bool VorbisDecoder::read_setup(const unsigned char* packet, size_t bytes)
+{
+	set_up = false;
+	if (!identified || bytes < 7 || packet[0] != PACKET_SETUP || memcmp(packet + 1, "vorbis", 6) != 0)
+		return false;
+	BitReader bits(packet + 7, bytes - 7);
+
+	codebooks.assign(bits.read(8) + 1, Codebook());
+	for (Codebook& book : codebooks)
+		if (!read_codebook(bits, book))
+			return false;
+
+	// time domain transforms, placeholders that must be zero
+	int time_count = (int)bits.read(6) + 1;
+	for (int i = 0; i < time_count; i++)
+		if (bits.read(16) != 0)
+			return false;
+
+	floors.assign(bits.read(6) + 1, Floor());
+	for (Floor& floor : floors)
+		if (!read_floor(bits, floor))
+			return false;
+
+	residues.assign(bits.read(6) + 1, Residue());
+	for (Residue& residue : residues)
+		if (!read_residue(bits, residue))
+			return false;
+
+	mappings.assign(bits.read(6) + 1, Mapping());
+	for (Mapping& mapping : mappings)
+		if (!read_mapping(bits, mapping))
+			return false;
+
+	modes.assign(bits.read(6) + 1, Mode());
+	for (Mode& mode : modes)
+	{
+		mode.long_block = bits.read(1) == 1;
+		int window_type = (int)bits.read(16);
+		int transform_type = (int)bits.read(16);
+		mode.mapping = (int)bits.read(8);
+		if (window_type != 0 || transform_type != 0 || mode.mapping >= (int)mappings.size())
+			return false;
+	}
+	if (bits.read(1) != 1 || bits.overrun)
+		return false;
+
+	transforms[0].init(block_size[0]);
+	transforms[1].init(block_size[1]);
+
+	size_t half = block_size[1] / 2;
+	spectrum.assign(channel_count * half, 0.f);
+	previous.assign(channel_count * half, 0.f);
+	output_stride = half;
+	output.assign(channel_count * half, 0.f);
+	floor_y.assign(channel_count * MAX_FLOOR1_VALUES, 0);
+	floor_steps.assign(half, 0);
+	block.assign(block_size[1], 0.f);
+	scratch.assign(block_size[1], 0.f);
+	interleaved.assign(channel_count * half, 0.f);
+	// residue 2 classifies the channels interleaved, one long vector
+	size_t most_partitions = 0;
+	for (const Residue& residue : residues)
+		most_partitions = std::max(most_partitions, channel_count * half / residue.partition_size);
+	int widest_classbook = 1;
+	for (const Residue& residue : residues)
+		widest_classbook = std::max(widest_classbook, codebooks[residue.classbook].dimensions);
+	classification_stride = most_partitions + widest_classbook;
+	classifications.assign(channel_count * classification_stride, 0);
+
+	have_previous = false;
+	set_up = true;
+	return true;
+}
+
+bool VorbisDecoder::read_codebook(BitReader& bits, Codebook& book)
+{
+	if ((int)bits.read(24) != CODEBOOK_SYNC)
+		return false;
+	book.dimensions = (int)bits.read(16);
+	book.entries = (int)bits.read(24);
+	// encoders stay far below this; a corrupt header would ask for gigabytes
+	if (book.dimensions < 1 || book.entries < 1 || (long long)book.entries * book.dimensions > MAX_CODEBOOK_VALUES || bits.overrun)
+		return false;
+
+	std::vector<int> lengths(book.entries, 0);
+	if (bits.read(1) == 1)
+	{
+		// ordered: runs of entries sharing a length, the length going up by one per run
+		int entry = 0;
+		int length = (int)bits.read(5) + 1;
+		while (entry < book.entries)
+		{
+			int run = (int)bits.read(ilog(book.entries - entry));
+			if (run > book.entries - entry || length > 32 || bits.overrun)
+				return false;
+			std::fill(lengths.begin() + entry, lengths.begin() + entry + run, length);
+			entry += run;
+			length++;
+		}
+	}
+	else
+	{
+		bool sparse = bits.read(1) == 1;
+		for (int& length : lengths)
+		{
+			if (!sparse || bits.read(1) == 1)
+				length = (int)bits.read(5) + 1;
+			if (bits.overrun)
+				return false;
+		}
+	}
+
+	// Codewords go out in entry order, each the lowest one still free at its
+	// length. available[l] is the next free codeword of length l, left aligned.
+	book.tree.assign(2, 0);
+	uint32_t available[33] = {};
+	int used = 0;
+	for (int entry = 0; entry < book.entries; entry++)
+	{
+		int length = lengths[entry];
+		if (length == 0)
+			continue;
+		uint32_t code;
+		if (used == 0)
+		{
+			code = 0;
+			for (int l = 1; l <= length; l++)
+				available[l] = 1u << (32 - l);
+		}
+		else
+		{
+			int free_length = length;
+			while (free_length > 0 && available[free_length] == 0)
+				free_length--;
+			if (free_length == 0)
+				return false;
+			code = available[free_length];
+			available[free_length] = 0;
+			for (int l = length; l > free_length; l--)
+				available[l] = code + (1u << (32 - l));
+		}
+		used++;
+
+		int node = 0;
+		for (int b = 0; b < length; b++)
+		{
+			int slot = node * 2 + (int)((code >> (31 - b)) & 1);
+			if (book.tree[slot] < 0)
+				return false;
+			if (b == length - 1)
+			{
+				if (book.tree[slot] != 0)
+					return false;
+				book.tree[slot] = ~entry;
+			}
+			else
+			{
+				if (book.tree[slot] == 0)
+				{
+					book.tree[slot] = (int)book.tree.size() / 2;
+					book.tree.push_back(0);
+					book.tree.push_back(0);
+				}
+				node = book.tree[slot];
+			}
+		}
+	}
+	// a book with a single entry decodes it from either bit
+	if (used == 1)
+		book.tree[0] = book.tree[1] = std::min(book.tree[0], book.tree[1]);
+	if (used == 0)
+		book.tree.clear();
+
+	int lookup_type = (int)bits.read(4);
+	if (lookup_type == 0)
+		return !bits.overrun;
+	if (lookup_type > 2)
+		return false;
+	float minimum = float32_unpack(bits.read(32));
+	float delta = float32_unpack(bits.read(32));
+	int value_bits = (int)bits.read(4) + 1;
+	bool sequence = bits.read(1) == 1;
+	long long lookup_values = lookup_type == 1 ? lookup1_values(book.entries, book.dimensions)
+		: (long long)book.entries * book.dimensions;
+	if (bits.overrun || lookup_values < 1 || (size_t)lookup_values * value_bits > (bits.bytes * 8 - bits.position))
+		return false;
+	std::vector<uint32_t> multiplicands(lookup_values);
+	for (uint32_t& multiplicand : multiplicands)
+		multiplicand = bits.read(value_bits);
+
+	// unpacked once here rather than per decoded vector
+	book.values.assign((size_t)book.entries * book.dimensions, 0.f);
+	for (int entry = 0; entry < book.entries; entry++)
+	{
+		float last = 0.f;
+		long long divisor = 1;
+		for (int i = 0; i < book.dimensions; i++)
+		{
+			long long offset = lookup_type == 1 ? (entry / divisor) % lookup_values
+				: (long long)entry * book.dimensions + i;
+			float value = multiplicands[offset] * delta + minimum + last;
+			if (sequence)
+				last = value;
+			book.values[(size_t)entry * book.dimensions + i] = value;
+			divisor *= lookup_values;
+		}
+	}
+	return !bits.overrun;
+}
+
+bool VorbisDecoder::read_floor(BitReader& bits, Floor& floor)
+{
+	int type = (int)bits.read(16);
+	if (type != 1)
+		return false;
+
+	int book_count = (int)codebooks.size();
+	floor.partitions = (int)bits.read(5);
+	int classes = 0;
+	for (int i = 0; i < floor.partitions; i++)
+	{
+		floor.partition_class[i] = (int)bits.read(4);
+		classes = std::max(classes, floor.partition_class[i] + 1);
+	}
+	for (int c = 0; c < classes; c++)
+	{
+		floor.class_dimensions[c] = (int)bits.read(3) + 1;
+		floor.class_subclasses[c] = (int)bits.read(2);
+		if (floor.class_subclasses[c] > 0)
+		{
+			floor.class_masterbook[c] = (int)bits.read(8);
+			if (floor.class_masterbook[c] >= book_count)
+				return false;
+		}
+		for (int j = 0; j < (1 << floor.class_subclasses[c]); j++)
+		{
+			floor.subclass_books[c][j] = (int)bits.read(8) - 1;
+			if (floor.subclass_books[c][j] >= book_count)
+				return false;
+		}
+	}
+	floor.multiplier = (int)bits.read(2) + 1;
+	floor.range = FLOOR1_RANGES[floor.multiplier - 1];
+	int range_bits = (int)bits.read(4);
+	floor.x.assign({ 0, 1 << range_bits });
+	for (int i = 0; i < floor.partitions; i++)
+	{
+		int c = floor.partition_class[i];
+		for (int j = 0; j < floor.class_dimensions[c]; j++)
+			floor.x.push_back((int)bits.read(range_bits));
+	}
+	int values = (int)floor.x.size();
+	if (values > MAX_FLOOR1_VALUES || bits.overrun)
+		return false;
+
+	floor.sorted.resize(values);
+	for (int i = 0; i < values; i++)
+		floor.sorted[i] = i;
+	std::sort(floor.sorted.begin(), floor.sorted.end(), [&](int a, int b) { return floor.x[a] < floor.x[b]; });
+	floor.low_neighbor.assign(values, 0);
+	floor.high_neighbor.assign(values, 1);
+	for (int i = 2; i < values; i++)
+	{
+		int low = 0, high = 1;
+		for (int j = 0; j < i; j++)
+		{
+			if (floor.x[j] < floor.x[i] && floor.x[j] > floor.x[low])
+				low = j;
+			if (floor.x[j] > floor.x[i] && floor.x[j] < floor.x[high])
+				high = j;
+		}
+		floor.low_neighbor[i] = low;
+		floor.high_neighbor[i] = high;
+	}
+	return true;
+}
+
+bool VorbisDecoder::read_residue(BitReader& bits, Residue& residue)
+{
+	residue.type = (int)bits.read(16);
+	residue.begin = (int)bits.read(24);
+	residue.end = (int)bits.read(24);
+	residue.partition_size = (int)bits.read(24) + 1;
+	residue.classifications = (int)bits.read(6) + 1;
+	residue.classbook = (int)bits.read(8);
+	if (residue.type > 2 || residue.classbook >= (int)codebooks.size())
+		return false;
+	int cascade[64];
+	for (int c = 0; c < residue.classifications; c++)
+	{
+		int low = (int)bits.read(3);
+		int high = bits.read(1) == 1 ? (int)bits.read(5) : 0;
+		cascade[c] = high * 8 + low;
+	}
+	for (int c = 0; c < residue.classifications; c++)
+	{
+		for (int pass = 0; pass < 8; pass++)
+		{
+			residue.books[c][pass] = -1;
+			if (cascade[c] & (1 << pass))
+			{
+				int book = (int)bits.read(8);
+				// residue books are read as vectors
+				if (book >= (int)codebooks.size() || codebooks[book].values.empty())
+					return false;
+				residue.books[c][pass] = book;
+			}
+		}
+	}
+	return !bits.overrun;
+}
+
+bool VorbisDecoder::read_mapping(BitReader& bits, Mapping& mapping)
+{
+	if (bits.read(16) != 0)
+		return false;
+	mapping.submaps = bits.read(1) == 1 ? (int)bits.read(4) + 1 : 1;
+	if (bits.read(1) == 1)
+	{
+		int steps = (int)bits.read(8) + 1;
+		int channel_bits = ilog(channel_count - 1);
+		for (int i = 0; i < steps; i++)
+		{
+			int magnitude = (int)bits.read(channel_bits);
+			int angle = (int)bits.read(channel_bits);
+			if (magnitude == angle || magnitude >= channel_count || angle >= channel_count)
+				return false;
+			mapping.magnitude.push_back(magnitude);
+			mapping.angle.push_back(angle);
+		}
+	}
+	if (bits.read(2) != 0)
+		return false;
+	mapping.mux.assign(channel_count, 0);
+	if (mapping.submaps > 1)
+	{
+		for (int& mux : mapping.mux)
+		{
+			mux = (int)bits.read(4);
+			if (mux >= mapping.submaps)
+				return false;
+		}
+	}
+	for (int i = 0; i < mapping.submaps; i++)
+	{
+		bits.read(8); // unused time configuration
+		mapping.submap_floor[i] = (int)bits.read(8);
+		mapping.submap_residue[i] = (int)bits.read(8);
+		if (mapping.submap_floor[i] >= (int)floors.size() || mapping.submap_residue[i] >= (int)residues.size())
+			return false;
+	}
+	return !bits.overrun;
+}
+
+void VorbisDecoder::Transform::init(int block_size)
+{
+	n = block_size;
+	int half = n / 2;
+	int quarter = n / 4;
+	pre_cos.resize(quarter);
+	pre_sin.resize(quarter);
+	post_cos.resize(quarter);
+	post_sin.resize(quarter);
+	for (int k = 0; k < quarter; k++)
+	{
+		double pre = -PI * (k + 0.25) / half;
+		double post = -PI * k / half;
+		pre_cos[k] = (float)cos(pre);
+		pre_sin[k] = (float)sin(pre);
+		post_cos[k] = (float)cos(post);
+		post_sin[k] = (float)sin(post);
+	}
+	fft_cos.resize(quarter / 2);
+	fft_sin.resize(quarter / 2);
+	for (int k = 0; k < quarter / 2; k++)
+	{
+		fft_cos[k] = (float)cos(-2.0 * PI * k / quarter);
+		fft_sin[k] = (float)sin(-2.0 * PI * k / quarter);
+	}
+	int levels = ilog(quarter) - 1;
+	bit_reverse.resize(quarter);
+	for (int k = 0; k < quarter; k++)
+	{
+		int reversed = 0;
+		for (int b = 0; b < levels; b++)
+			reversed |= ((k >> b) & 1) << (levels - 1 - b);
+		bit_reverse[k] = reversed;
+	}
+	slope.resize(half);
+	for (int i = 0; i < half; i++)
+	{
+		double s = sin((i + 0.5) / half * PI / 2.0);
+		slope[i] = (float)sin(PI / 2.0 * s * s);
+	}
+}
+
+// The inverse MDCT is a DCT-IV of the n / 2 coefficients, unfolded to n
+// samples by its symmetries. The DCT-IV runs as an n / 4 point complex FFT
+// between two twiddles.
+void VorbisDecoder::Transform::inverse(const float* in, float* out, float* scratch) const
+{
+	int half = n / 2;
+	int quarter = n / 4;
+	float* re = scratch;
+	float* im = scratch + quarter;
+
+	for (int k = 0; k < quarter; k++)
+	{
+		float a = in[2 * k];
+		float b = in[half - 1 - 2 * k];
+		int at = bit_reverse[k];
+		re[at] = a * pre_cos[k] - b * pre_sin[k];
+		im[at] = a * pre_sin[k] + b * pre_cos[k];
+	}
+	for (int size = 2; size <= quarter; size *= 2)
+	{
+		int stride = quarter / size;
+		for (int start = 0; start < quarter; start += size)
+		{
+			for (int k = 0; k < size / 2; k++)
+			{
+				float wr = fft_cos[k * stride];
+				float wi = fft_sin[k * stride];
+				int even = start + k;
+				int odd = even + size / 2;
+				float tr = re[odd] * wr - im[odd] * wi;
+				float ti = re[odd] * wi + im[odd] * wr;
+				re[odd] = re[even] - tr;
+				im[odd] = im[even] - ti;
+				re[even] += tr;
+				im[even] += ti;
+			}
+		}
+	}
+
+	// the DCT-IV lands in the second half of scratch, out of the FFT's way
+	float* u = scratch + half;
+	for (int k = 0; k < quarter; k++)
+	{
+		float r = re[k] * post_cos[k] - im[k] * post_sin[k];
+		float i = re[k] * post_sin[k] + im[k] * post_cos[k];
+		u[2 * k] = r;
+		u[half - 1 - 2 * k] = -i;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		int m = i + quarter;
+		if (m < half)
+			out[i] = u[m];
+		else if (m < n)
+			out[i] = -u[n - 1 - m];
+		else
+			out[i] = -u[m - n];
+	}
+}
+
+bool VorbisDecoder::decode_floor(BitReader& bits, const Floor& floor, int* y)
+{
+	if (bits.read(1) == 0)
+		return false;
+	int range_bits = ilog(floor.range - 1);
+	y[0] = (int)bits.read(range_bits);
+	y[1] = (int)bits.read(range_bits);
+	int offset = 2;
+	for (int i = 0; i < floor.partitions; i++)
+	{
+		int c = floor.partition_class[i];
+		int dimensions = floor.class_dimensions[c];
+		int subclass_bits = floor.class_subclasses[c];
+		int subclass_mask = (1 << subclass_bits) - 1;
+		int value = 0;
+		if (subclass_bits > 0)
+		{
+			value = codebooks[floor.class_masterbook[c]].decode_scalar(bits);
+			if (value < 0)
+				return false;
+		}
+		for (int j = 0; j < dimensions; j++)
+		{
+			int book = floor.subclass_books[c][value & subclass_mask];
+			value >>= subclass_bits;
+			int decoded = 0;
+			if (book >= 0)
+			{
+				decoded = codebooks[book].decode_scalar(bits);
+				if (decoded < 0)
+					return false;
+			}
+			y[offset + j] = decoded;
+		}
+		offset += dimensions;
+	}
+	return !bits.overrun;
+}
+
+// Turns the decoded points into the floor curve and multiplies it into the
+// spectrum, which holds the residue by then
+void VorbisDecoder::render_floor(const Floor& floor, const int* y, float* spectrum_out, int half)
+{
+	int values = (int)floor.x.size();
+	int final_y[MAX_FLOOR1_VALUES];
+	bool used[MAX_FLOOR1_VALUES];
+	final_y[0] = y[0];
+	final_y[1] = y[1];
+	used[0] = used[1] = true;
+	for (int i = 2; i < values; i++)
+	{
+		int low = floor.low_neighbor[i];
+		int high = floor.high_neighbor[i];
+		int predicted = render_point(floor.x[low], final_y[low], floor.x[high], final_y[high], floor.x[i]);
+		int value = y[i];
+		int high_room = floor.range - predicted;
+		int low_room = predicted;
+		int room = std::min(high_room, low_room) * 2;
+		if (value == 0)
+		{
+			used[i] = false;
+			final_y[i] = predicted;
+			continue;
+		}
+		used[low] = used[high] = used[i] = true;
+		if (value >= room)
+			final_y[i] = high_room > low_room ? value - low_room + predicted : predicted - value + high_room - 1;
+		else if (value & 1)
+			final_y[i] = predicted - (value + 1) / 2;
+		else
+			final_y[i] = predicted + value / 2;
+	}
+
+	int* steps = floor_steps.data();
+	int lx = 0;
+	int ly = final_y[floor.sorted[0]] * floor.multiplier;
+	int hx = 0;
+	int hy = ly;
+	for (int s = 1; s < values; s++)
+	{
+		int i = floor.sorted[s];
+		if (!used[i])
+			continue;
+		hx = floor.x[i];
+		hy = final_y[i] * floor.multiplier;
+		render_line(lx, ly, hx, hy, steps, half);
+		lx = hx;
+		ly = hy;
+	}
+	for (int x = std::max(hx, 0); x < half; x++)
+		steps[x] = hy;
+	for (int x = 0; x < half; x++)
+		spectrum_out[x] *= inverse_db(steps[x]);
+}
+
+void VorbisDecoder::decode_residue(BitReader& bits, const Residue& residue, float** vectors, const bool* skip, int count, int half)
+{
+	for (int i = 0; i < count; i++)
+		std::fill(vectors[i], vectors[i] + half, 0.f);
+	if (residue.type != 2)
+	{
+		decode_partitions(bits, residue, vectors, skip, count, half);
+		return;
+	}
+
+	// type 2 codes the channels as one vector, interleaved
+	bool all_skipped = true;
+	for (int i = 0; i < count; i++)
+		all_skipped = all_skipped && skip[i];
+	if (all_skipped)
+		return;
+	float* together = interleaved.data();
+	std::fill(together, together + half * count, 0.f);
+	bool decode_it = false;
+	decode_partitions(bits, residue, &together, &decode_it, 1, half * count);
+	for (int i = 0; i < half; i++)
+		for (int c = 0; c < count; c++)
+			vectors[c][i] = together[i * count + c];
+}
+
+void VorbisDecoder::decode_partitions(BitReader& bits, const Residue& residue, float** vectors, const bool* skip, int count, int size)
+{
+	const Codebook& classbook = codebooks[residue.classbook];
+	int classwords = classbook.dimensions;
+	int begin = std::min(residue.begin, size);
+	int end = std::min(residue.end, size);
+	if (end <= begin)
+		return;
+	int partitions = (end - begin) / residue.partition_size;
+	// format 1 and 2 read each vector's values in order, format 0 interleaved by the dimensions
+	bool interleave = residue.type == 0;
+
+	for (int pass = 0; pass < 8; pass++)
+	{
+		int partition = 0;
+		while (partition < partitions)
+		{
+			if (pass == 0)
+			{
+				for (int v = 0; v < count; v++)
+				{
+					if (skip[v])
+						continue;
+					int word = classbook.decode_scalar(bits);
+					if (word < 0)
+						return;
+					int* classes = &classifications[v * classification_stride + partition];
+					for (int i = classwords - 1; i >= 0; i--)
+					{
+						classes[i] = word % residue.classifications;
+						word /= residue.classifications;
+					}
+				}
+			}
+			for (int i = 0; i < classwords && partition < partitions; i++, partition++)
+			{
+				for (int v = 0; v < count; v++)
+				{
+					if (skip[v])
+						continue;
+					int vq_class = classifications[v * classification_stride + partition];
+					int book_index = residue.books[vq_class][pass];
+					if (book_index < 0)
+						continue;
+					const Codebook& book = codebooks[book_index];
+					float* target = vectors[v] + begin + partition * residue.partition_size;
+					if (interleave)
+					{
+						int step = residue.partition_size / book.dimensions;
+						for (int j = 0; j < step; j++)
+						{
+							const float* values = book.decode_vector(bits);
+							if (values == nullptr)
+								return;
+							for (int d = 0; d < book.dimensions; d++)
+								target[j + d * step] += values[d];
+						}
+					}
+					else
+					{
+						for (int j = 0; j < residue.partition_size;)
+						{
+							const float* values = book.decode_vector(bits);
+							if (values == nullptr)
+								return;
+							for (int d = 0; d < book.dimensions && j < residue.partition_size; d++, j++)
+								target[j] += values[d];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+int VorbisDecoder::decode(const unsigned char* packet, size_t bytes)
+{
+	if (!set_up)
+		return -1;
+	BitReader bits(packet, bytes);
+	if (bits.read(1) != 0)
+		return -1;
+	int mode_index = (int)bits.read(ilog((unsigned int)modes.size() - 1));
+	if (bits.overrun || mode_index >= (int)modes.size())
+		return -1;
+	const Mode& mode = modes[mode_index];
+	const Mapping& mapping = mappings[mode.mapping];
+	int n = block_size[mode.long_block ? 1 : 0];
+	int half = n / 2;
+	bool previous_long = false;
+	bool next_long = false;
+	if (mode.long_block)
+	{
+		previous_long = bits.read(1) == 1;
+		next_long = bits.read(1) == 1;
+		if (bits.overrun)
+			return -1;
+	}
+
+	// floors first, a channel without one is silent this packet
+	bool used[256];
+	bool skip[256];
+	for (int c = 0; c < channel_count; c++)
+	{
+		const Floor& floor = floors[mapping.submap_floor[mapping.mux[c]]];
+		used[c] = decode_floor(bits, floor, &floor_y[c * MAX_FLOOR1_VALUES]);
+	}
+	// coupled channels are decoded together if either has a floor
+	for (size_t i = 0; i < mapping.magnitude.size(); i++)
+	{
+		if (used[mapping.magnitude[i]] || used[mapping.angle[i]])
+			used[mapping.magnitude[i]] = used[mapping.angle[i]] = true;
+	}
+
+	float* vectors[256];
+	for (int submap = 0; submap < mapping.submaps; submap++)
+	{
+		int count = 0;
+		for (int c = 0; c < channel_count; c++)
+		{
+			if (mapping.mux[c] != submap)
+				continue;
+			vectors[count] = &spectrum[c * output_stride];
+			skip[count] = !used[c];
+			count++;
+		}
+		decode_residue(bits, residues[mapping.submap_residue[submap]], vectors, skip, count, half);
+	}
+
+	// undo the square polar coupling, last step first
+	for (int i = (int)mapping.magnitude.size() - 1; i >= 0; i--)
+	{
+		float* magnitudes = &spectrum[mapping.magnitude[i] * output_stride];
+		float* angles = &spectrum[mapping.angle[i] * output_stride];
+		for (int j = 0; j < half; j++)
+		{
+			float m = magnitudes[j];
+			float a = angles[j];
+			if (m > 0.f)
+			{
+				if (a > 0.f)
+				{
+					angles[j] = m - a;
+				}
+				else
+				{
+					angles[j] = m;
+					magnitudes[j] = m + a;
+				}
+			}
+			else
+			{
+				if (a > 0.f)
+				{
+					angles[j] = m + a;
+				}
+				else
+				{
+					angles[j] = m;
+					magnitudes[j] = m - a;
+				}
+			}
+		}
+	}
+
+	// window slopes: a side next to a short block uses the short slope
+	const Transform& transform = transforms[mode.long_block ? 1 : 0];
+	int short_half = block_size[0] / 2;
+	int left_n = (mode.long_block && previous_long) ? half : short_half;
+	int right_n = (mode.long_block && next_long) ? half : short_half;
+	int left_start = n / 4 - left_n / 2;
+	int right_start = n * 3 / 4 - right_n / 2;
+	const float* left_slope = transforms[left_n == short_half ? 0 : 1].slope.data();
+	const float* right_slope = transforms[right_n == short_half ? 0 : 1].slope.data();
+
+	int finished = have_previous ? previous_size / 4 + n / 4 : 0;
+	for (int c = 0; c < channel_count; c++)
+	{
+		float* channel_spectrum = &spectrum[c * output_stride];
+		if (used[c])
+		{
+			const Floor& floor = floors[mapping.submap_floor[mapping.mux[c]]];
+			render_floor(floor, &floor_y[c * MAX_FLOOR1_VALUES], channel_spectrum, half);
+		}
+		else
+		{
+			std::fill(channel_spectrum, channel_spectrum + half, 0.f);
+		}
+
+		float* samples = block.data();
+		transform.inverse(channel_spectrum, samples, scratch.data());
+		for (int i = 0; i < n; i++)
+		{
+			float weight;
+			if (i < left_start)
+				weight = 0.f;
+			else if (i < left_start + left_n)
+				weight = left_slope[i - left_start];
+			else if (i < right_start)
+				weight = 1.f;
+			else if (i < right_start + right_n)
+				weight = right_slope[right_n - 1 - (i - right_start)];
+			else
+				weight = 0.f;
+			samples[i] *= weight;
+		}
+
+		// this block's first half overlaps the previous block's second half,
+		// lined up on the slopes, which meet between the two centres
+		float* overlap = &previous[c * output_stride];
+		float* out = &output[c * output_stride];
+		if (have_previous)
+		{
+			int shift = n / 4 - previous_size / 4;
+			for (int j = 0; j < finished; j++)
+			{
+				float sum = j < previous_size / 2 ? overlap[j] : 0.f;
+				int at = j + shift;
+				if (at >= 0)
+					sum += samples[at];
+				out[j] = sum;
+			}
+		}
+		std::copy(samples + half, samples + n, overlap);
+	}
+	previous_size = n;
+	have_previous = true;
+	return finished;
+}
+
+size_t VorbisDecoder::memory_bytes() const
+{
+	size_t bytes = 0;
+	for (const Codebook& book : codebooks)
+		bytes += book.tree.capacity() * sizeof(int) + book.values.capacity() * sizeof(float);
+	for (const Floor& floor : floors)
+		bytes += (floor.x.capacity() + floor.sorted.capacity() + floor.low_neighbor.capacity() + floor.high_neighbor.capacity()) * sizeof(int);
+	for (const Transform& transform : transforms)
+	{
+		bytes += (transform.pre_cos.capacity() * 4 + transform.fft_cos.capacity() * 2 + transform.slope.capacity()) * sizeof(float);
+		bytes += transform.bit_reverse.capacity() * sizeof(int);
+	}
+	bytes += (spectrum.capacity() + previous.capacity() + output.capacity() + block.capacity() + scratch.capacity() +
+		interleaved.capacity()) * sizeof(float);
+	bytes += (floor_y.capacity() + floor_steps.capacity() + classifications.capacity()) * sizeof(int);
+	return bytes;
+}
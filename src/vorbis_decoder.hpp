@@ -0,0 +1,151 @@
+#pragma once
+
+// stlib
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decodes the packets of a Vorbis I stream, the codec inside .ogg files, to
+// float samples, following the Vorbis I specification. The container is left
+// to the caller: it hands over the three header packets, then audio packets in
+// order. Floor type 0 is refused at the setup header, no encoder has written
+// it since libvorbis 1.0.
+class VorbisDecoder
+{
+public:
+	// The header packets, in stream order. False if the packet is not the
+	// expected header or describes a stream this decoder can't play.
+	bool read_identification(const unsigned char* packet, size_t bytes);
+	bool read_comment(const unsigned char* packet, size_t bytes);
+	bool read_setup(const unsigned char* packet, size_t bytes);
+
+	int channels() const { return channel_count; }
+	int rate() const { return sample_rate; }
+
+	// Decodes one audio packet and returns how many frames it finished, which
+	// stay in pcm(channel) until the next call. The first packet after
+	// reset() finishes none, it only primes the overlap. Negative if the
+	// packet is not audio this stream can decode; the stream goes on with the
+	// next one.
+	int decode(const unsigned char* packet, size_t bytes);
+	const float* pcm(int channel) const { return &output[channel * output_stride]; }
+	// Forgets the previous packet, for decoding from the start again
+	void reset() { have_previous = false; }
+
+	// Codebooks, tables and sample buffers held for the open stream
+	size_t memory_bytes() const;
+
+private:
+	struct BitReader;
+
+	struct Codebook
+	{
+		int dimensions = 0;
+		int entries = 0;
+		// pairs of children: 0 is empty, positive the next pair, negative ~entry
+		std::vector<int> tree;
+		// dimensions values per entry, empty for scalar only books
+		std::vector<float> values;
+
+		int decode_scalar(BitReader& bits) const;
+		const float* decode_vector(BitReader& bits) const;
+	};
+
+	struct Floor
+	{
+		int partitions = 0;
+		int partition_class[31] = {};
+		int class_dimensions[16] = {};
+		int class_subclasses[16] = {};
+		int class_masterbook[16] = {};
+		int subclass_books[16][8] = {};
+		int multiplier = 1;
+		int range = 256;
+		std::vector<int> x;
+		// x sorted, and for each point its neighbours among the earlier ones
+		std::vector<int> sorted;
+		std::vector<int> low_neighbor;
+		std::vector<int> high_neighbor;
+	};
+
+	struct Residue
+	{
+		int type = 0;
+		int begin = 0;
+		int end = 0;
+		int partition_size = 1;
+		int classifications = 1;
+		int classbook = 0;
+		int books[64][8] = {};
+	};
+
+	struct Mapping
+	{
+		int submaps = 1;
+		std::vector<int> magnitude;
+		std::vector<int> angle;
+		std::vector<int> mux;
+		int submap_floor[16] = {};
+		int submap_residue[16] = {};
+	};
+
+	struct Mode
+	{
+		bool long_block = false;
+		int mapping = 0;
+	};
+
+	// FFT based inverse MDCT of one block size, plus its window slope
+	struct Transform
+	{
+		int n = 0;
+		std::vector<float> pre_cos, pre_sin, post_cos, post_sin;
+		std::vector<float> fft_cos, fft_sin;
+		std::vector<int> bit_reverse;
+		std::vector<float> slope;
+
+		void init(int block_size);
+		// n / 2 coefficients in, n samples out; scratch holds n floats
+		void inverse(const float* in, float* out, float* scratch) const;
+	};
+
+	bool read_codebook(BitReader& bits, Codebook& book);
+	bool read_floor(BitReader& bits, Floor& floor);
+	bool read_residue(BitReader& bits, Residue& residue);
+	bool read_mapping(BitReader& bits, Mapping& mapping);
+
+	// false if the channel's floor is unused this packet
+	bool decode_floor(BitReader& bits, const Floor& floor, int* y);
+	void render_floor(const Floor& floor, const int* y, float* spectrum, int half);
+	void decode_residue(BitReader& bits, const Residue& residue, float** vectors, const bool* skip, int count, int half);
+	void decode_partitions(BitReader& bits, const Residue& residue, float** vectors, const bool* skip, int count, int size);
+
+	int channel_count = 0;
+	int sample_rate = 0;
+	int block_size[2] = { 0, 0 };
+	bool identified = false;
+	bool set_up = false;
+
+	std::vector<Codebook> codebooks;
+	std::vector<Floor> floors;
+	std::vector<Residue> residues;
+	std::vector<Mapping> mappings;
+	std::vector<Mode> modes;
+	Transform transforms[2];
+
+	// per channel, sized for the long block at setup
+	std::vector<float> spectrum;
+	std::vector<float> previous;
+	std::vector<float> output;
+	std::vector<int> floor_y;
+	std::vector<int> floor_steps;
+	std::vector<float> block;
+	std::vector<float> scratch;
+	std::vector<float> interleaved;
+	std::vector<int> classifications;
+	size_t classification_stride = 0;
+	size_t output_stride = 0;
+
+	bool have_previous = false;
+	int previous_size = 0;
+};
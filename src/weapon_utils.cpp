@@ -4,6 +4,7 @@
 #include "sound_utils.hpp"
 #include "physics_system.hpp"
 #include "world_system.hpp"
+#include "projectile_pool.hpp"
 
 float next_collectable_spawn = 600.f;
 vec2 mouse_click_pos = {-1.f, -1.f};
@@ -67,10 +68,8 @@ void collect_weapon(Entity weapon, Entity hero) {
 			registry.remove_all_components_of(weapon);
 		} else {
 			if (registry.players.get(hero).hasWeapon) {
-				if (registry.grenadeLaunchers.has(registry.players.get(hero).weapon)) {
-					for(Entity line: registry.grenadeLaunchers.get(registry.players.get(hero).weapon).trajectory)
-						registry.remove_all_components_of(line);
-				} else if (registry.tridents.has(weapon)) {
+				// a grenade launcher's trajectory polyline goes with it
+				if (!registry.grenadeLaunchers.has(registry.players.get(hero).weapon) && registry.tridents.has(weapon)) {
 					for (WaterBall& water_ball: registry.waterBalls.components)
 						water_ball.drawing = false;
 				}
@@ -164,36 +163,39 @@ void rotate_weapon(Entity weapon, vec2 mouse_pos) {
 	}
 }
 
-std::vector<Entity> create_grenade_trajectory(RenderSystem* renderer, vec2 launch_start, vec2 velocity) {
-	std::vector<Entity> lines;
-	vec2 start_point = launch_start;
-	vec2 end_point = launch_start;
+// Arc of a grenade launched with velocity, relative to the launch point,
+// until it has fallen 1.5 screens below it
+void sample_grenade_trajectory(vec2 velocity, std::vector<vec2>& points) {
+	points.clear();
+	vec2 point = {0.f, 0.f};
+	points.push_back(point);
 	float velocity_change = GRAVITY_ACCELERATION_FACTOR * GRENADE_TRAJECTORY_SEGMENT_TIME;
 	float segment_seconds = GRENADE_TRAJECTORY_SEGMENT_TIME / 1000.f;
-	while(end_point.y - launch_start.y < 1.5 * window_height_px) {
-		start_point = end_point;
+	while(point.y < 1.5 * window_height_px) {
 		velocity.y += velocity_change;
-		end_point = start_point + velocity * segment_seconds;
-		vec2 line_position = launch_start;
-		vec2 line_offset = (start_point + end_point) / 2.f - launch_start;
-		vec2 line_scale = {sqrt(dot(end_point - start_point, end_point - start_point)), TRAJECTORY_WIDTH};
-		float line_angle = atan2(end_point.y - start_point.y, end_point.x - start_point.x);
-		lines.push_back(createLine(renderer, line_position, line_offset, line_scale, line_angle));
+		point += velocity * segment_seconds;
+		points.push_back(point);
 	}
-	return lines;
 }
 
 void update_weapon_angle(RenderSystem* renderer, Entity weapon, vec2 mouse_pos, bool mouse_clicked) {
 	mouse_cur_pos = mouse_pos;
 	if (mouse_click_pos != vec2(-1.f, -1.f) && drag_delay <= 0) {
 		rotate_weapon(weapon, registry.motions.get(weapon).position + mouse_click_pos - mouse_cur_pos);
-		for (Entity line: registry.grenadeLaunchers.get(weapon).trajectory) {
-			registry.remove_all_components_of(line);
-		}
 		Motion& motion = registry.motions.get(weapon);
 		float angle = motion.angle;
 		mat2 rot_mat = {{cos(angle), -sin(angle)}, {sin(angle), cos(angle)}};
-		registry.grenadeLaunchers.get(weapon).trajectory = create_grenade_trajectory(renderer, motion.position + vec2(motion.positionOffset.x + abs(motion.scale.x) / 2.f, 0) * rot_mat, (mouse_click_pos - mouse_cur_pos) * GRENADE_SPEED_FACTOR);
+		GrenadeLauncher& launcher = registry.grenadeLaunchers.get(weapon);
+		vec2 velocity = (mouse_click_pos - mouse_cur_pos) * GRENADE_SPEED_FACTOR;
+		// only resample the arc when the aim changed
+		bool resample = !registry.polylines.has(weapon) || velocity != launcher.trajectory_velocity;
+		Polyline& trajectory = registry.polylines.has(weapon) ? registry.polylines.get(weapon) : projectile_pool.add_polyline(weapon);
+		trajectory.width = TRAJECTORY_WIDTH;
+		trajectory.origin = motion.position + vec2(motion.positionOffset.x + abs(motion.scale.x) / 2.f, 0) * rot_mat;
+		if (resample) {
+			sample_grenade_trajectory(velocity, trajectory.points);
+			launcher.trajectory_velocity = velocity;
+		}
 	} else if (registry.weapons.get(weapon).type == COLLECTABLE_TYPE::TRIDENT && mouse_clicked) {
 		for (Entity entity: registry.waterBalls.entities) {
 			WaterBall& water_ball = registry.waterBalls.get(entity);
@@ -205,8 +207,12 @@ void update_weapon_angle(RenderSystem* renderer, Entity weapon, vec2 mouse_pos,
 				vec2 betweener = (last + mouse_pos) / 2.f;
 				water_ball.points.push_back(betweener);
 				water_ball.points.push_back(mouse_pos);
-				float angle = atan2(mouse_pos.y - water_ball.points[water_ball.points.size() - 3].y, mouse_pos.x - water_ball.points[water_ball.points.size() - 3].x);
-				water_ball.trajectory.push_back(createLine(renderer, betweener, {0, 0}, {dist, TRAJECTORY_WIDTH}, angle));
+				if (!registry.polylines.has(entity)) {
+					Polyline& trajectory = projectile_pool.add_polyline(entity);
+					trajectory.width = TRAJECTORY_WIDTH;
+					trajectory.points.push_back(last);
+				}
+				registry.polylines.get(entity).points.push_back(mouse_pos);
 			}
 		}
 		rotate_weapon(weapon, mouse_pos);
@@ -249,13 +255,13 @@ void update_grenades(RenderSystem* renderer, float elapsed_ms) {
 		explode_timer -= elapsed_ms;
 		if (explode_timer <= 0) {
 			explode(renderer, registry.motions.get(grenade).position, grenade);
-			registry.remove_all_components_of(grenade);
+			projectile_pool.release(grenade);
 		}
 	}
 }
 
 void explode(RenderSystem* renderer, vec2 position, Entity explodable) {
-	play_sound(SOUND_EFFECT::EXPLOSION);
+	play_sound(SOUND_EFFECT::EXPLOSION, position);
 	if (registry.rockets.has(explodable))
 		createExplosion(renderer, position, ROCKET_EXPLOSION_FACTOR);
 	else if (registry.grenades.has(explodable))
@@ -266,7 +272,7 @@ void update_explosions(float elapsed_ms) {
 	for (Entity explosion: registry.explosions.entities) {
 		int frame = (int)floor(registry.animated.get(explosion).oneTimer * ANIMATION_SPEED_FACTOR);
 		if (frame == 6)
-			registry.remove_all_components_of(explosion);
+			projectile_pool.release(explosion);
 		else if (frame == 2)
 			registry.weaponHitBoxes.get(explosion).isActive = false;
 	}
@@ -326,10 +332,11 @@ void update_water_balls(float elapsed_ms, COLLECTABLE_TYPE weapon_type, bool mou
 			animation.curState = 1;
 			hit_box.isActive = true;
 			play_sound(SOUND_EFFECT::WATER_BALL_SHOOT);
-			for (Entity line: water_ball.trajectory)
-				registry.remove_all_components_of(line);
+			// more than one segment drawn
+			bool has_path = registry.polylines.has(entity) && registry.polylines.get(entity).points.size() > 2;
+			projectile_pool.release_polyline(entity);
 
-			if (water_ball.trajectory.size() > 1) {
+			if (has_path) {
 				water_ball.state++;
 			} else {
 				motion.velocity = vec2(WATER_BALL_SPEED, 0) * mat2({cos(motion.angleBackup), -sin(motion.angleBackup)}, {sin(motion.angleBackup), cos(motion.angleBackup)});
@@ -366,19 +373,19 @@ void update_water_balls(float elapsed_ms, COLLECTABLE_TYPE weapon_type, bool mou
 			}
 		}
 
-		if (animation.oneTimeState == 2 && (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR) == animation.stateFrameLength[2])
-			registry.remove_all_components_of(entity);
+		if (animation.oneTimeState == 2 && (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR) == animation.clip->stateFrameLength[2])
+			projectile_pool.release(entity);
 	}
 }
 
 void weapon_mouse_release() {
-	for (WaterBall& water_ball: registry.waterBalls.components) {
+	for (Entity entity: registry.waterBalls.entities) {
+		WaterBall& water_ball = registry.waterBalls.get(entity);
 		if (water_ball.drawing && drag_delay > 0) {
 			vec2 start = water_ball.points[0];
 			water_ball.points.clear();
 			water_ball.points.push_back(start);
-			for (Entity line: water_ball.trajectory)
-				registry.remove_all_components_of(line);
+			projectile_pool.release_polyline(entity);
 		}
 		water_ball.drawing = false;
 	}
@@ -437,21 +444,18 @@ void update_weapon(RenderSystem* renderer, float elapsed_ms, Entity hero, bool m
 			mat2 rot_mat = mat2({cos(launcher_motion.angle), -sin(launcher_motion.angle)}, {sin(launcher_motion.angle), cos(launcher_motion.angle)});
 			vec2 position = launcher_motion.position + vec2(launcher_motion.positionOffset.x + abs(launcher_motion.scale.x) / 2.f, 0) * rot_mat;
 			vec2 velocity = (mouse_click_pos - mouse_cur_pos) * GRENADE_SPEED_FACTOR;
-			if (registry.grenadeLaunchers.get(weapon).trajectory.empty() || drag_delay > 0)
+			if (!registry.polylines.has(weapon) || drag_delay > 0)
 				velocity = vec2(500.f, 0) * rot_mat;
 			createGrenade(renderer, position, velocity);
 			play_sound(SOUND_EFFECT::GRENADE_LAUNCHER_FIRE);
-			for (Entity line: launcher.trajectory)
-				registry.remove_all_components_of(line);
-			launcher.trajectory.clear();
+			projectile_pool.release_polyline(weapon);
 			launcher.cooldown = GRENADE_COOLDOWN;
 			launcher.loaded = false;
 			mouse_click_pos = {-1.f, -1.f};
-		} else if (mouse_click_pos != vec2({-1.f, -1.f}) && !launcher.trajectory.empty()) {
-			for (Entity line: launcher.trajectory) {
-				float angle = weaponMot.angle;
-				registry.motions.get(line).position = weaponMot.position + vec2(weaponMot.positionOffset.x + abs(weaponMot.scale.x) / 2.f, 0) * mat2({cos(angle), -sin(angle)}, {sin(angle), cos(angle)});
-			}
+		} else if (mouse_click_pos != vec2({-1.f, -1.f}) && registry.polylines.has(weapon)) {
+			// follow the hero, the arc itself only changes with the aim
+			float angle = weaponMot.angle;
+			registry.polylines.get(weapon).origin = weaponMot.position + vec2(weaponMot.positionOffset.x + abs(weaponMot.scale.x) / 2.f, 0) * mat2({cos(angle), -sin(angle)}, {sin(angle), cos(angle)});
 		} 
 	} else if (registry.tridents.has(weapon)) {
 		Trident& trident = registry.tridents.get(weapon);
@@ -2,6 +2,8 @@
 #include "world_init.hpp"
 #include "world_system.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "prefab.hpp"
+#include "projectile_pool.hpp"
 
 
 Entity createHero(RenderSystem *renderer, vec2 pos)
@@ -21,7 +23,7 @@ Entity createHero(RenderSystem *renderer, vec2 pos)
 
 	registry.players.emplace(entity);
 	registry.solids.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::HERO));
+	registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::HERO));
 	registry.renderRequests.insert(
 		entity,
 		{TEXTURE_ASSET_ID::HERO,
@@ -68,47 +70,136 @@ Entity createBoulder(RenderSystem* renderer, vec2 position, vec2 velocity, float
 	return entity;
 }
 
-Entity createFireing(RenderSystem *renderer, vec2 position)
+namespace
 {
-	auto entity = Entity();
+	// Built on first use, the collision meshes live as long as the renderer
+	const Prefab& fireling_prefab(RenderSystem* renderer)
+	{
+		static const Prefab prefab = [renderer]()
+		{
+			Prefab fireling;
+			fireling.motion.angle = 0.f;
+			fireling.motion.velocity = vec2(0.0, 0.0);
+			fireling.motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::FIRE_ENEMY);
+			fireling.motion.dir = -1;
+			fireling
+				.with(registry.collisionMeshPtrs, &renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE))
+				.with(registry.colors, { 1, .8f, .8f })
+				.with(registry.enemies, { 1, 2, FIRELING_HP, FIRELING_HP })
+				.with(registry.fireEnemies)
+				.with(registry.animated, AnimationInfo(ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::FIRE_ENEMY)))
+				.with(registry.renderRequests,
+					{ TEXTURE_ASSET_ID::FIRE_ENEMY,
+					 EFFECT_ASSET_ID::FIRE_ENEMY,
+					 GEOMETRY_BUFFER_ID::SPRITE,
+					 false,
+					 true,
+					 SPRITE_SCALE.at(TEXTURE_ASSET_ID::FIRE_ENEMY),
+					 SPRITE_OFFSET.at(TEXTURE_ASSET_ID::FIRE_ENEMY) })
+				.with(registry.debugRenderRequests)
+				.with(registry.testAIs);
+			return fireling;
+		}();
+		return prefab;
+	}
 
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	CollisionMesh &mesh = renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.collisionMeshPtrs.emplace(entity, &mesh);
+	const Prefab& ghoul_prefab(RenderSystem* renderer)
+	{
+		static const Prefab prefab = [renderer]()
+		{
+			Prefab ghoul;
+			ghoul.motion.angle = 0.f;
+			ghoul.motion.velocity = vec2(0.f, -0.1f);
+			ghoul.motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY);
+			ghoul
+				.with(registry.collisionMeshPtrs, &renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE))
+				.with(registry.enemies, { 3, 4, GHOUL_HP, GHOUL_HP })
+				.with(registry.ghouls)
+				.with(registry.gravities)
+				.with(registry.solids)
+				.with(registry.animated, AnimationInfo(ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::GHOUL_ENEMY)))
+				.with(registry.renderRequests,
+					{ TEXTURE_ASSET_ID::GHOUL_ENEMY,
+					 EFFECT_ASSET_ID::GHOUL,
+					 GEOMETRY_BUFFER_ID::SPRITE,
+					 false,
+					 true,
+					 SPRITE_SCALE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY),
+					 SPRITE_OFFSET.at(TEXTURE_ASSET_ID::GHOUL_ENEMY) })
+				.with(registry.debugRenderRequests);
+			return ghoul;
+		}();
+		return prefab;
+	}
 
-	// Initialize the motion
-	auto &motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	// Setting initial values, scale is negative to make it face the opposite way
-	motion.velocity = vec2(0.0, 0.0);
-	motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::FIRE_ENEMY);
-    motion.position = position;
-	motion.dir = -1;
-
-	registry.colors.insert(entity, {1, .8f, .8f});
-	registry.enemies.insert(entity, {
-        1,
-        2,
-        FIRELING_HP,
-        FIRELING_HP
-    });
+	const Prefab& spitter_prefab(RenderSystem* renderer)
+	{
+		static const Prefab prefab = [renderer]()
+		{
+			Prefab spitter;
+			spitter.motion.angle = 0.f;
+			spitter.motion.velocity = { 0.f, 0.f };
+			spitter.motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY);
+			spitter
+				.with(registry.collisionMeshPtrs, &renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE))
+				// wait 1s for first shot
+				.with(registry.spitterEnemies, { INITIAL_SPITTER_PROJECTILE_DELAY_MS, false })
+				.with(registry.enemies, { 3, 4, SPITTER_HP, SPITTER_HP })
+				.with(registry.colors, { 1, .8f, .8f })
+				.with(registry.solids)
+				.with(registry.animated, AnimationInfo(ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::SPITTER_ENEMY)))
+				.with(registry.renderRequests,
+					{ TEXTURE_ASSET_ID::SPITTER_ENEMY,
+					 EFFECT_ASSET_ID::SPITTER_ENEMY,
+					 GEOMETRY_BUFFER_ID::SPRITE,
+					 false,
+					 true,
+					 SPRITE_SCALE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY),
+					 SPRITE_OFFSET.at(TEXTURE_ASSET_ID::SPITTER_ENEMY) })
+				.with(registry.debugRenderRequests)
+				.with(registry.gravities);
+			return spitter;
+		}();
+		return prefab;
+	}
 
-	registry.fireEnemies.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::FIRE_ENEMY));
-	registry.renderRequests.insert(
-		entity,
-		{TEXTURE_ASSET_ID::FIRE_ENEMY,
-		 EFFECT_ASSET_ID::FIRE_ENEMY,
-		 GEOMETRY_BUFFER_ID::SPRITE,
-         false,
-         true,
-		 SPRITE_SCALE.at(TEXTURE_ASSET_ID::FIRE_ENEMY),
-		 SPRITE_OFFSET.at(TEXTURE_ASSET_ID::FIRE_ENEMY) });
+	const Prefab& spitter_bullet_prefab(RenderSystem* renderer)
+	{
+		static const Prefab prefab = [renderer]()
+		{
+			Prefab bullet;
+			bullet.motion.scale = SPITTER_BULLET_BB;
+			bullet
+				.with(registry.collisionMeshPtrs, &renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE))
+				.with(registry.spitterBullets, { 1.f })
+				.with(registry.projectiles)
+				.with(registry.animated, AnimationInfo(ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::SPITTER_ENEMY_BULLET)))
+				.with(registry.renderRequests,
+					{ TEXTURE_ASSET_ID::SPITTER_ENEMY_BULLET,
+					 EFFECT_ASSET_ID::SPITTER_ENEMY_BULLET,
+					 GEOMETRY_BUFFER_ID::SPRITE,
+					 false,
+					 true,
+					 SPITTER_BULLET_BB })
+				.with(registry.debugRenderRequests);
+			return bullet;
+		}();
+		return prefab;
+	}
 
-    registry.debugRenderRequests.emplace(entity);
-	registry.testAIs.emplace(entity);
+	// a spitter shot leaves left or right at full speed with a random upward or downward drift
+	void aim_spitter_bullet(Motion& motion, float angle)
+	{
+		auto dir = []() -> int
+		{ return rand() % 2 == 0 ? 1 : -1; };
+		motion.angle = angle;
+		motion.velocity = {dir() * 300, dir() * (rand() % 300)};
+	}
+}
 
-	return entity;
+Entity createFireing(RenderSystem *renderer, vec2 position)
+{
+	return fireling_prefab(renderer).spawn(position);
 }
 
 
@@ -136,7 +227,7 @@ Entity createBossEnemy(RenderSystem *renderer, vec2 position)
         BOSS_HEALTH
     });
 
-    AnimationInfo& aniInfo = registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::BOSS));
+    AnimationInfo& aniInfo = registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::BOSS));
     aniInfo.oneTimeState = 9;
     registry.renderRequests.insert(
             entity,
@@ -198,7 +289,7 @@ Entity create_boss_sword(RenderSystem* renderer, vec2 position, int type) {
 	if (type == 1)
 	{
 		motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::BOSS_SWORD_S);
-		registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::BOSS_SWORD_S));
+		registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::BOSS_SWORD_S));
 		registry.renderRequests.insert(
 			entity,
 			{ TEXTURE_ASSET_ID::BOSS_SWORD_S,
@@ -211,7 +302,7 @@ Entity create_boss_sword(RenderSystem* renderer, vec2 position, int type) {
 	}
 	else {
 		motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::BOSS_SWORD_L);
-		registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::BOSS_SWORD_L));
+		registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::BOSS_SWORD_L));
 		registry.renderRequests.insert(
 			entity,
 			{ TEXTURE_ASSET_ID::BOSS_SWORD_L,
@@ -230,44 +321,12 @@ Entity create_boss_sword(RenderSystem* renderer, vec2 position, int type) {
 
 Entity createGhoul(RenderSystem* renderer, vec2 position)
 {
-	auto entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	CollisionMesh& mesh = renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.collisionMeshPtrs.emplace(entity, &mesh);
-
-	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	// Setting initial values, scale is negative to make it face the opposite way
-	motion.velocity = vec2(0.f, -0.1f);
-	motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY);
-    motion.position = position;
-
-	registry.enemies.insert(entity, {
-        3,
-        4,
-        GHOUL_HP,
-        GHOUL_HP
-    });
-
-	registry.ghouls.emplace(entity);
-	registry.gravities.emplace(entity);
-	registry.solids.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::GHOUL_ENEMY));
-	registry.renderRequests.insert(
-		entity,
-		{ TEXTURE_ASSET_ID::GHOUL_ENEMY,
-		 EFFECT_ASSET_ID::GHOUL,
-		 GEOMETRY_BUFFER_ID::SPRITE,
-		 false,
-		 true,
-		 SPRITE_SCALE.at(TEXTURE_ASSET_ID::GHOUL_ENEMY),
-		 SPRITE_OFFSET.at(TEXTURE_ASSET_ID::GHOUL_ENEMY) });
-
-	registry.debugRenderRequests.emplace(entity);
+	return ghoul_prefab(renderer).spawn(position);
+}
 
-	return entity;
+std::vector<Entity> createGhouls(RenderSystem* renderer, const std::vector<vec2>& positions)
+{
+	return ghoul_prefab(renderer).spawn_n(positions);
 }
 
 Entity createFollowingEnemy(RenderSystem* renderer, vec2 position)
@@ -289,7 +348,7 @@ Entity createFollowingEnemy(RenderSystem* renderer, vec2 position)
 	registry.enemies.emplace(entity).hittable = false;
 
 	registry.followingEnemies.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::FOLLOWING_ENEMY));
+	registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::FOLLOWING_ENEMY));
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::FOLLOWING_ENEMY,
@@ -307,83 +366,28 @@ Entity createFollowingEnemy(RenderSystem* renderer, vec2 position)
 
 Entity createSpitterEnemy(RenderSystem *renderer, vec2 pos)
 {
-	auto entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object
-	CollisionMesh &mesh = renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.collisionMeshPtrs.emplace(entity, &mesh);
-
-	// Setting initial motion values
-	Motion &motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	motion.velocity = {0.f, 0.f};
-	motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY);
-    motion.position = pos;
-
-	SpitterEnemy &spitterEnemy = registry.spitterEnemies.emplace(entity);
-	// wait 1s for first shot
-	spitterEnemy.timeUntilNextShotMs = INITIAL_SPITTER_PROJECTILE_DELAY_MS;
-
-	registry.enemies.insert(entity, {
-        3,
-        4,
-        SPITTER_HP,
-        SPITTER_HP
-    });
-	registry.colors.insert(entity, {1, .8f, .8f});
-
-	registry.solids.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::SPITTER_ENEMY));
-	registry.renderRequests.insert(
-		entity,
-		{TEXTURE_ASSET_ID::SPITTER_ENEMY,
-		 EFFECT_ASSET_ID::SPITTER_ENEMY,
-		 GEOMETRY_BUFFER_ID::SPRITE,
-         false,
-         true,
-         SPRITE_SCALE.at(TEXTURE_ASSET_ID::SPITTER_ENEMY),
-         SPRITE_OFFSET.at(TEXTURE_ASSET_ID::SPITTER_ENEMY)});
+	return spitter_prefab(renderer).spawn(pos);
+}
 
-    registry.debugRenderRequests.emplace(entity);
-	registry.gravities.emplace(entity);
+std::vector<Entity> createSpitterEnemies(RenderSystem* renderer, const std::vector<vec2>& positions)
+{
+	return spitter_prefab(renderer).spawn_n(positions);
+}
 
-	return entity;
+std::vector<Entity> createSpitterEnemyBullets(RenderSystem *renderer, vec2 pos, float angle, size_t count)
+{
+	return spitter_bullet_prefab(renderer).spawn_n(std::vector<vec2>(count, pos), [angle](size_t, Motion& motion)
+	{
+		aim_spitter_bullet(motion, angle);
+	});
 }
 
 Entity createSpitterEnemyBullet(RenderSystem *renderer, vec2 pos, float angle)
 {
-	auto entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object
-	CollisionMesh &mesh = renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.collisionMeshPtrs.emplace(entity, &mesh);
-
-	// Setting initial motion values
-	Motion &motion = registry.motions.emplace(entity);
-	motion.position = pos;
-	motion.angle = angle;
-	auto dir = []() -> int
-	{ return rand() % 2 == 0 ? 1 : -1; };
-	motion.velocity = {dir() * 300, dir() * (rand() % 300)};
-	motion.scale = SPITTER_BULLET_BB;
-
-	SpitterBullet &bullet = registry.spitterBullets.emplace(entity);
-
-	bullet.mass = 1;
-
-	registry.projectiles.emplace(entity);
-	AnimationInfo &animationInfo = registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::SPITTER_ENEMY_BULLET));
-	registry.renderRequests.insert(
-		entity,
-		{TEXTURE_ASSET_ID::SPITTER_ENEMY_BULLET,
-		 EFFECT_ASSET_ID::SPITTER_ENEMY_BULLET,
-		 GEOMETRY_BUFFER_ID::SPRITE,
-         false,
-         true,
-         motion.scale});
-    registry.debugRenderRequests.emplace(entity);
-
-	return entity;
+	return spitter_bullet_prefab(renderer).spawn(pos, [angle](Motion& motion)
+	{
+		aim_spitter_bullet(motion, angle);
+	});
 }
 
 Entity createMainMenuBackground(RenderSystem *renderer) {
@@ -406,77 +410,37 @@ Entity createMainMenuBackground(RenderSystem *renderer) {
     return entity;
 }
 
-Entity createParallaxItem(RenderSystem *renderer, vec2 pos, TEXTURE_ASSET_ID texture_id)
+Entity createParallaxBackground()
 {
+	// no motion, the layers only move in the parallax shader
 	Entity entity = Entity();
-	vec2 vel;
-	if (texture_id == TEXTURE_ASSET_ID::BACKGROUND || texture_id == TEXTURE_ASSET_ID::BACKGROUND_COLOR || texture_id == TEXTURE_ASSET_ID::PARALLAX_MOON)
-	{
-		vel = vec2();
-	}
-	else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_CLOUDS_CLOSE)
-	{
-		// moves to the right
-		vel = vec2(10, 0);
-	}
-	else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_CLOUDS_FAR)
-	{
-		// moves to the right slowly
-		vel = vec2(5, 0);
-	}
-	else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_RAIN)
-	{
-		vel = vec2(40, 120);
-	} else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_LAVA) 
-	{
-		vel = vec2(10, 0);
-		CollisionMesh &mesh = renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE);
-		registry.collisionMeshPtrs.emplace(entity, &mesh);
-	}
-	vel *= 5;
+	registry.parallaxBackgrounds.emplace(entity);
+	return entity;
+}
 
-	auto &motion = registry.motions.emplace(entity);
+Entity createLava(RenderSystem *renderer, vec2 pos)
+{
+	Entity entity = Entity();
+	CollisionMesh &mesh = renderer->getCollisionMesh(GEOMETRY_BUFFER_ID::SPRITE);
+	registry.collisionMeshPtrs.emplace(entity, &mesh);
 
+	auto &motion = registry.motions.emplace(entity);
 	motion.angle = 0.f;
-	motion.velocity = vel;
+	motion.velocity = { 0.f, 0.f };
 	motion.position = pos;
-	if (texture_id == TEXTURE_ASSET_ID::BACKGROUND ||
-		texture_id == TEXTURE_ASSET_ID::BACKGROUND_COLOR ||
-		texture_id == TEXTURE_ASSET_ID::PARALLAX_MOON ||
-		texture_id == TEXTURE_ASSET_ID::PARALLAX_CLOUDS_CLOSE ||
-		texture_id == TEXTURE_ASSET_ID::PARALLAX_CLOUDS_FAR)
-	{
-		motion.scale = {pos.x * 2, pos.y * 2};
-	}
-	else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_LAVA) {
-		motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::PARALLAX_LAVA);
-	}
-	else
-	{
-		motion.scale = {1200, 800};
-	}
-
-	ParallaxBackground &bg = registry.parallaxBackgrounds.emplace(entity);
-	if (texture_id == TEXTURE_ASSET_ID::PARALLAX_CLOUDS_CLOSE || texture_id == TEXTURE_ASSET_ID::PARALLAX_CLOUDS_FAR) {
-		bg.resetPosition = vec2(-800, 400);
-	} else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_RAIN) {
-		bg.resetPosition = vec2(400, 0);
-	} else if (texture_id == TEXTURE_ASSET_ID::PARALLAX_LAVA) {
-		bg.resetPosition = vec2(-600, 813);
-	}
+	motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::PARALLAX_LAVA);
 
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
+	registry.lava.emplace(entity);
+	// never drawn itself (the parallax shows the lava), only its debug box
 	registry.renderRequests.insert(
 		entity,
-		{texture_id,
+		{TEXTURE_ASSET_ID::PARALLAX_LAVA,
 		 EFFECT_ASSET_ID::TEXTURED,
 		 GEOMETRY_BUFFER_ID::SPRITE,
 		 false,
-		 true,
-		 texture_id == TEXTURE_ASSET_ID::PARALLAX_LAVA ? SPRITE_SCALE.at(TEXTURE_ASSET_ID::PARALLAX_LAVA) : motion.scale,
-		 texture_id == TEXTURE_ASSET_ID::PARALLAX_LAVA ? SPRITE_OFFSET.at(TEXTURE_ASSET_ID::PARALLAX_LAVA) : vec2({0, 0})});
-	if (texture_id == TEXTURE_ASSET_ID::PARALLAX_LAVA)
-		registry.debugRenderRequests.emplace(entity);
+		 false,
+		 motion.scale});
+	registry.debugRenderRequests.emplace(entity);
 	return entity;
 }
 
@@ -707,7 +671,7 @@ Entity createGrenadeLauncher(RenderSystem *renderer, vec2 position)
 	registry.grenadeLaunchers.emplace(entity);
 	registry.gravities.emplace(entity);
 	registry.solids.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::GRENADE_LAUNCHER));
+	registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::GRENADE_LAUNCHER));
 	registry.renderRequests.insert(
 		entity,
 		{TEXTURE_ASSET_ID::GRENADE_LAUNCHER,
@@ -742,7 +706,7 @@ Entity createGrenade(RenderSystem* renderer, vec2 position, vec2 velocity) {
 	registry.grenades.emplace(entity);
 	registry.weaponHitBoxes.emplace(entity).damage = DIR_EXPLOSIVE_DMG;
 	registry.gravities.emplace(entity);
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::GRENADE));
+	registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::GRENADE));
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::GRENADE,
@@ -775,7 +739,7 @@ Entity createExplosion(RenderSystem *renderer, vec2 position, float size)
 	hitbox.hurtsHero = true;
     hitbox.damage = EXPLOSIVE_DMG;
 
-	AnimationInfo& info = registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::EXPLOSION));
+	AnimationInfo& info = registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::EXPLOSION));
 	info.oneTimeState = 0;
 
 	registry.renderRequests.insert(
@@ -789,6 +753,9 @@ Entity createExplosion(RenderSystem *renderer, vec2 position, float size)
 		 size * SPRITE_OFFSET.at(TEXTURE_ASSET_ID::EXPLOSION)});
     registry.debugRenderRequests.emplace(entity);
 
+	// size is the sprite factor (2.5 to 3.5), the effect is tuned for about 1
+	renderer->getParticles().emit(PARTICLE_EFFECT::EXPLOSION, position, size / 3.f);
+
 	return entity;
 }
 
@@ -893,10 +860,10 @@ Entity createWaterBall(RenderSystem* renderer, vec2 position, float angle) {
 	motion.angle = angle;
 	motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::WATER_BALL);
 
-	AnimationInfo& animation = registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::WATER_BALL));
+	AnimationInfo& animation = registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::WATER_BALL));
 	animation.curState = 1;
 
-	registry.waterBalls.emplace(entity);
+	projectile_pool.add_water_ball(entity);
 	registry.solids.emplace(entity);
 	registry.weaponHitBoxes.emplace(entity).damage = WATER_BALL_DMG;
 	registry.renderRequests.insert(
@@ -1256,29 +1223,43 @@ Entity createScore(RenderSystem* renderer, vec2 pos) {
 	return entity;
 }
 
-Entity createNumber(RenderSystem* renderer, vec2 pos) {
+Entity createScoreNumber(vec2 pos) {
 	Entity entity = Entity();
 
 	auto& motion = registry.motions.emplace(entity);
 	motion.angle = 0.f;
 	motion.velocity = { 0.f, 0.f };
-	motion.scale = { 20.f, 29.f };
+	motion.scale = { 145.f, 29.f };
 	motion.position = pos;
 
-	registry.renderRequests.insert(
-		entity,
-		{ TEXTURE_ASSET_ID::ZERO,
-		 EFFECT_ASSET_ID::TEXTURED,
-		 GEOMETRY_BUFFER_ID::SPRITE,
-		 true,
-		 false,
-		 motion.scale });
+	Text& text = registry.texts.emplace(entity);
+	text.text = "00000";
+	text.font = FONT::SCORE;
+	text.height = 29.f;
+	text.visibility = false;
 
 	registry.inGameGUIs.emplace(entity);
 
 	return entity;
 }
 
+Entity createDebugText(vec2 pos, bool right_aligned) {
+	Entity entity = Entity();
+
+	auto& motion = registry.motions.emplace(entity);
+	motion.angle = 0.f;
+	motion.velocity = { 0.f, 0.f };
+	motion.position = pos;
+
+	Text& text = registry.texts.emplace(entity);
+	text.font = FONT::DEBUG;
+	text.height = 8.f;
+	text.right_aligned = right_aligned;
+	text.visibility = false;
+
+	return entity;
+}
+
 Entity createDBFlame(RenderSystem* renderer, vec2 pos) {
 	Entity entity = Entity();
 
@@ -1360,7 +1341,7 @@ Entity createLavaPillar(RenderSystem* renderer, vec2 pos) {
 	motion.scale = ASSET_SIZE.at(TEXTURE_ASSET_ID::LAVA_PILLAR);
 	registry.gravities.emplace(entity);
 	registry.enemies.emplace(entity).hittable = false;
-	registry.animated.emplace(entity, ANIMATION_INFO.at(TEXTURE_ASSET_ID::LAVA_PILLAR));
+	registry.animated.emplace(entity, ANIMATION_CLIPS.at(TEXTURE_ASSET_ID::LAVA_PILLAR));
 	registry.lavaPillars.emplace(entity);
 	registry.renderRequests.insert(
 		entity,
@@ -1372,6 +1353,9 @@ Entity createLavaPillar(RenderSystem* renderer, vec2 pos) {
 		 SPRITE_SCALE.at(TEXTURE_ASSET_ID::LAVA_PILLAR),
 		 SPRITE_OFFSET.at(TEXTURE_ASSET_ID::LAVA_PILLAR) });
 	registry.debugRenderRequests.emplace(entity);
+
+	// embers where it breaks out of the lava
+	renderer->getParticles().emit(PARTICLE_EFFECT::LAVA, { pos.x, (float)window_height_px });
 	return entity;
 }
 
@@ -4,37 +4,39 @@
 #include "tiny_ecs.hpp"
 #include "render_system.hpp"
 #include "ai_system.hpp"
-#include <map>
+#include <cassert>
+#include <initializer_list>
+#include <utility>
 #include <vector>
 
 // These are hard coded to the dimensions of the entity texture
 
 const static std::vector<std::vector<char>> grid_vec = create_grid();
 
-const float CHARACTER_SCALING = 3.0f;
-const float BOSS_SCALING = 2.5f;
-const float EXPLOSION_SCALING = 2.0f;
-
-const vec2 ENEMY_BB = vec2(26.f, 30.f) * CHARACTER_SCALING;
-const vec2 BOULDER_BB = vec2(15.f, 14.f);
-const vec2 SWORD_BB = vec2(32.f, 64.f) * 0.7f;
-const vec2 GUN_BB = vec2(45.f, 32.f);
-const vec2 ARROW_BB = vec2(64.f, 64.f) * 0.5f;
-const vec2 ROCKET_LAUNCHER_BB = vec2(64.f, 32.f) * .8f;
-const vec2 ROCKET_BB = vec2(16.f, 16.f) * 1.2f;
-const vec2 GRENADE_LAUNCHER_BB = vec2(39.f, 39.f) * 0.6f;
-const vec2 GRENADE_BB = vec2(39.f, 39.f) * 0.6f;
-const vec2 LASER_RIFLE_BB = vec2(32.f, 32.f);
-const vec2 LASER_BB = vec2(window_width_px, 92.f * 0.2f);
-const vec2 HEART_BB = vec2(16.f, 16.f) * 2.f;
-const vec2 WINGED_BOOTS_BB = vec2(1489.f, 1946.f) * .02f;
-const vec2 DASH_BOOTS_BB = vec2(27.f, 30.f) * 1.2f;
-const vec2 PICKAXE_BB = vec2(55.f, 80.f) * .5f;
-const vec2 SPITTER_BULLET_BB = vec2(16.f, 16.f) * 3.f;
-const vec2 HELPER_BB = vec2(566, 510) / 1.8f;
-const vec2 LAVA_PILLAR_BB = vec2(120, 536);
-const vec2 TRIDENT_BB = vec2(16, 32) * 1.5f;
-const vec2 MAIN_MENU_BG_BB = vec2(1200, 800);
+constexpr float CHARACTER_SCALING = 3.0f;
+constexpr float BOSS_SCALING = 2.5f;
+constexpr float EXPLOSION_SCALING = 2.0f;
+
+constexpr vec2 ENEMY_BB = vec2(26.f, 30.f) * CHARACTER_SCALING;
+constexpr vec2 BOULDER_BB = vec2(15.f, 14.f);
+constexpr vec2 SWORD_BB = vec2(32.f, 64.f) * 0.7f;
+constexpr vec2 GUN_BB = vec2(45.f, 32.f);
+constexpr vec2 ARROW_BB = vec2(64.f, 64.f) * 0.5f;
+constexpr vec2 ROCKET_LAUNCHER_BB = vec2(64.f, 32.f) * .8f;
+constexpr vec2 ROCKET_BB = vec2(16.f, 16.f) * 1.2f;
+constexpr vec2 GRENADE_LAUNCHER_BB = vec2(39.f, 39.f) * 0.6f;
+constexpr vec2 GRENADE_BB = vec2(39.f, 39.f) * 0.6f;
+constexpr vec2 LASER_RIFLE_BB = vec2(32.f, 32.f);
+constexpr vec2 LASER_BB = vec2(window_width_px, 92.f * 0.2f);
+constexpr vec2 HEART_BB = vec2(16.f, 16.f) * 2.f;
+constexpr vec2 WINGED_BOOTS_BB = vec2(1489.f, 1946.f) * .02f;
+constexpr vec2 DASH_BOOTS_BB = vec2(27.f, 30.f) * 1.2f;
+constexpr vec2 PICKAXE_BB = vec2(55.f, 80.f) * .5f;
+constexpr vec2 SPITTER_BULLET_BB = vec2(16.f, 16.f) * 3.f;
+constexpr vec2 HELPER_BB = vec2(566, 510) / 1.8f;
+constexpr vec2 LAVA_PILLAR_BB = vec2(120, 536);
+constexpr vec2 TRIDENT_BB = vec2(16, 32) * 1.5f;
+constexpr vec2 MAIN_MENU_BG_BB = vec2(1200, 800);
 
 const int SWORD_DMG = 7;
 const int EXPLOSIVE_DMG = 6;
@@ -92,7 +94,68 @@ const std::vector<vec<3, float>> walkable_area = {
         {window_width_px / 2, window_height_px - base_height * 3, base_width * 7}
 };
 
-const std::map<TEXTURE_ASSET_ID, vec2 > ASSET_SIZE = {
+// Metadata of some of the textures as a dense array indexed by
+// TEXTURE_ASSET_ID, filled in at compile time, so a lookup is an array index
+// and nothing runs at startup. Textures without an entry read as zero.
+template <typename T>
+class TextureTable
+{
+public:
+	struct Entry
+	{
+		TEXTURE_ASSET_ID id;
+		T value;
+	};
+
+	constexpr TextureTable(std::initializer_list<Entry> entries)
+		: TextureTable(entries.begin(), entries.size(), std::make_index_sequence<texture_count>()) {}
+
+	constexpr const T& at(TEXTURE_ASSET_ID id) const
+	{
+		assert(present[(int)id]);
+		return values[(int)id];
+	}
+	constexpr bool has(TEXTURE_ASSET_ID id) const { return present[(int)id]; }
+	// every entry names a texture below TEXTURE_COUNT, and only once
+	constexpr bool valid() const { return well_formed; }
+
+private:
+	// each element is initialized from a lookup rather than assigned in a
+	// loop, which glm's union members don't allow in a constant expression
+	template <size_t... I>
+	constexpr TextureTable(const Entry* entries, size_t count, std::index_sequence<I...>)
+		: values{ find(entries, count, I)... }
+		, present{ (occurrences(entries, count, I) > 0)... }
+		, well_formed(check(entries, count)) {}
+
+	static constexpr T find(const Entry* entries, size_t count, size_t index)
+	{
+		for (size_t i = 0; i < count; i++)
+			if ((size_t)entries[i].id == index)
+				return entries[i].value;
+		return T();
+	}
+	static constexpr size_t occurrences(const Entry* entries, size_t count, size_t index)
+	{
+		size_t found = 0;
+		for (size_t i = 0; i < count; i++)
+			found += (size_t)entries[i].id == index ? 1 : 0;
+		return found;
+	}
+	static constexpr bool check(const Entry* entries, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			if ((size_t)entries[i].id >= (size_t)texture_count || occurrences(entries, count, (size_t)entries[i].id) != 1)
+				return false;
+		return true;
+	}
+
+	T values[texture_count];
+	bool present[texture_count];
+	bool well_formed;
+};
+
+constexpr TextureTable<vec2> ASSET_SIZE = {
         { TEXTURE_ASSET_ID::SPITTER_ENEMY, {16 * CHARACTER_SCALING, 24 * CHARACTER_SCALING}},
         { TEXTURE_ASSET_ID::QUIT,{204, 56} },
         { TEXTURE_ASSET_ID::QUIT_PRESSED,{204, 56} },
@@ -121,8 +184,6 @@ const std::map<TEXTURE_ASSET_ID, vec2 > ASSET_SIZE = {
         { TEXTURE_ASSET_ID::BOSS, {32 * BOSS_SCALING, 60 * BOSS_SCALING}},
         { TEXTURE_ASSET_ID::BOSS_SWORD_S, {19, 21}},
         { TEXTURE_ASSET_ID::BOSS_SWORD_L, {19, 21}},
-        { TEXTURE_ASSET_ID::SPITTER_ENEMY, {16*CHARACTER_SCALING, 24*CHARACTER_SCALING}},
-        { TEXTURE_ASSET_ID::EXPLOSION, {60, 55}},
         { TEXTURE_ASSET_ID::EXPLOSION, {60, 55}},
         { TEXTURE_ASSET_ID::PLAYER_HEART, {40, 40}},
         { TEXTURE_ASSET_ID::PARALLAX_LAVA, {1200, 42}},
@@ -135,7 +196,7 @@ const std::map<TEXTURE_ASSET_ID, vec2 > ASSET_SIZE = {
         { TEXTURE_ASSET_ID::TRIDENT_HELPER, {464, 17}}
 };
 
-const std::map<TEXTURE_ASSET_ID, vec2 > SPRITE_SCALE = {
+constexpr TextureTable<vec2> SPRITE_SCALE = {
         { TEXTURE_ASSET_ID::HERO, {52*CHARACTER_SCALING, 21*CHARACTER_SCALING}},
         { TEXTURE_ASSET_ID::FIRE_ENEMY, {-48 * CHARACTER_SCALING, 32 * CHARACTER_SCALING}},
         { TEXTURE_ASSET_ID::GHOUL_ENEMY, {50 * CHARACTER_SCALING, 28 * CHARACTER_SCALING}},
@@ -153,7 +214,7 @@ const std::map<TEXTURE_ASSET_ID, vec2 > SPRITE_SCALE = {
         { TEXTURE_ASSET_ID::GUN, GUN_BB}
 };
 
-const std::map<TEXTURE_ASSET_ID, vec2 > SPRITE_OFFSET = {
+constexpr TextureTable<vec2> SPRITE_OFFSET = {
         { TEXTURE_ASSET_ID::HERO, {10 * CHARACTER_SCALING, -1 * CHARACTER_SCALING}},
         { TEXTURE_ASSET_ID::FIRE_ENEMY, { 0 * CHARACTER_SCALING, -4 * CHARACTER_SCALING}},
         { TEXTURE_ASSET_ID::GHOUL_ENEMY, { 0 * CHARACTER_SCALING, -2 * CHARACTER_SCALING}},
@@ -171,7 +232,7 @@ const std::map<TEXTURE_ASSET_ID, vec2 > SPRITE_OFFSET = {
         { TEXTURE_ASSET_ID::GUN, {-2 * CHARACTER_SCALING, 0 * CHARACTER_SCALING}}
 };
 
-const std::map<TEXTURE_ASSET_ID, AnimationInfo> ANIMATION_INFO = {
+constexpr TextureTable<AnimationClip> ANIMATION_CLIPS = {
         {TEXTURE_ASSET_ID::HERO, {
                 13,
                 {9, 1, 8, 4, 4, 4, 16, 4, 8, 4, 14, 2, 8},
@@ -257,6 +318,9 @@ const std::map<TEXTURE_ASSET_ID, AnimationInfo> ANIMATION_INFO = {
             20
         }}
 };
+static_assert(ASSET_SIZE.valid() && SPRITE_SCALE.valid() && SPRITE_OFFSET.valid() && ANIMATION_CLIPS.valid(),
+	"texture metadata names a texture twice or one past TEXTURE_COUNT");
+
 // the player
 Entity createHero(RenderSystem *renderer, vec2 pos);
 // the enemy
@@ -264,6 +328,8 @@ Entity createFireing(RenderSystem *renderer, vec2 position);
 Entity createBoulder(RenderSystem *renderer, vec2 position, vec2 velocity, float size);
 // the ghoul enemy
 Entity createGhoul(RenderSystem* renderer, vec2 position);
+// the batch versions grow each component container once for all of them
+std::vector<Entity> createGhouls(RenderSystem* renderer, const std::vector<vec2>& positions);
 // the following & teleporting enemy
 Entity createFollowingEnemy(RenderSystem* renderer, vec2 position);
 // the boss
@@ -271,8 +337,11 @@ Entity createBossEnemy(RenderSystem *renderer, vec2 pos);
 Entity create_boss_sword(RenderSystem* renderer, vec2 pos, int size);
 // spitter enemy
 Entity createSpitterEnemy(RenderSystem *renderer, vec2 pos);
+std::vector<Entity> createSpitterEnemies(RenderSystem* renderer, const std::vector<vec2>& positions);
 // spitter enemy bullet
 Entity createSpitterEnemyBullet(RenderSystem *renderer, vec2 pos, float angle);
+// count bullets fanning out from pos in random directions
+std::vector<Entity> createSpitterEnemyBullets(RenderSystem *renderer, vec2 pos, float angle, size_t count);
 // the sword
 Entity createSword(RenderSystem *renderer, vec2 position);
 // the gun
@@ -308,8 +377,10 @@ Entity createPickaxe(RenderSystem* renderer, vec2 position);
 
 Entity createMainMenuBackground(RenderSystem* renderer);
 
-// the parallax backgrounds
-Entity createParallaxItem(RenderSystem* renderer, vec2 pos, TEXTURE_ASSET_ID texture_id);
+// the parallax background, drawn by the renderer in one pass
+Entity createParallaxBackground();
+// the lava floor the parallax background shows
+Entity createLava(RenderSystem* renderer, vec2 pos);
 // the helper text during pause
 Entity createHelperText(RenderSystem* renderer, float size);
 Entity createToolTip(RenderSystem* renderer, vec2 pos, TEXTURE_ASSET_ID type);
@@ -325,7 +396,8 @@ Entity createPowerUpIcon(RenderSystem* renderer, vec2 pos);
 Entity createDifficultyBar(RenderSystem* renderer, vec2 pos);
 Entity createDifficultyIndicator(RenderSystem* renderer, vec2 pos);
 Entity createScore(RenderSystem* renderer, vec2 pos);
-Entity createNumber(RenderSystem* renderer, vec2 pos);
+Entity createScoreNumber(vec2 pos);
+Entity createDebugText(vec2 pos, bool right_aligned = true);
 Entity createDBFlame(RenderSystem* renderer, vec2 pos);
 Entity createDBSkull(RenderSystem* renderer, vec2 pos);
 Entity createDBSatan(RenderSystem* renderer, vec2 pos);
@@ -4,6 +4,11 @@
 #include "physics_system.hpp"
 #include "ai_system.hpp"
 #include "json.hpp"
+#include "profiler.hpp"
+#include "logger.hpp"
+#include "projectile_pool.hpp"
+#include "frame_arena.hpp"
+#include "memory_report.hpp"
 
 // stlib
 #include <cassert>
@@ -28,10 +33,13 @@ Entity powerup_GUI;
 Entity difficulty_bar;
 Entity indicator;
 Entity score_text;
-std::vector<Entity> score_GUI = { };
+Entity score_number;
+Entity difficulty_debug_text;
 std::vector<Entity> following_enemies = { };
 
-json::JSON state;
+// best difficulty factor and score over all runs, saved with the game
+float history_max_ddf = 0.f;
+int history_max_score = 0;
 
 /* 
 * ddl = Dynamic Difficulty Level
@@ -65,6 +73,9 @@ WorldSystem::WorldSystem()
 
 WorldSystem::~WorldSystem()
 {
+	// Finish any pending save before tearing down
+	autosave_service.stop();
+
 	// Destroy all sound
 	destroy_sound();
 	
@@ -80,7 +91,7 @@ namespace
 {
 	void glfw_err_cb(int error, const char *desc)
 	{
-		fprintf(stderr, "%d: %s", error, desc);
+		LOG_ERROR(GAME, "%d: %s", error, desc);
 	}
 }
 
@@ -93,7 +104,7 @@ GLFWwindow *WorldSystem::create_window()
 	glfwSetErrorCallback(glfw_err_cb);
 	if (!glfwInit())
 	{
-		fprintf(stderr, "Failed to initialize GLFW");
+		LOG_ERROR(GAME, "Failed to initialize GLFW");
 		return nullptr;
 	}
 
@@ -117,7 +128,7 @@ GLFWwindow *WorldSystem::create_window()
     window = glfwCreateWindow(new_width, new_height, "Titan's Trial", nullptr, nullptr);
 	if (window == nullptr)
 	{
-		fprintf(stderr, "Failed to glfwCreateWindow");
+		LOG_ERROR(GAME, "Failed to glfwCreateWindow");
 		return nullptr;
 	}
 
@@ -148,6 +159,9 @@ GLFWwindow *WorldSystem::create_window()
 void WorldSystem::init(RenderSystem *renderer_arg)
 {
 	this->renderer = renderer_arg;
+
+	autosave_service.start("game_save.json");
+	spawn_director.load(data_path() + "/spawns.json");
 	
 	// Play main menu background music
 	play_main_menu_music();
@@ -172,6 +186,10 @@ void WorldSystem::create_title_screen()
 
 	while (registry.motions.entities.size() > 0)
 		registry.remove_all_components_of(registry.motions.entities.back());
+	// the parallax background has no motion
+	while (registry.parallaxBackgrounds.entities.size() > 0)
+		registry.remove_all_components_of(registry.parallaxBackgrounds.entities.back());
+	renderer->getParticles().clear();
 
 	//these magic number are just the vertical position of where the buttons are
 	createMainMenuBackground(renderer);
@@ -182,12 +200,16 @@ void WorldSystem::create_title_screen()
 }
 
 void WorldSystem::create_almanac_screen() {
+	renderer->finishTextureLoading();
 	isTitleScreen = true;
 	pause = false;
 	dialogue_screen_active = 0;
 
 	while (registry.motions.entities.size() > 0)
 		registry.remove_all_components_of(registry.motions.entities.back());
+	// the parallax background has no motion
+	while (registry.parallaxBackgrounds.entities.size() > 0)
+		registry.remove_all_components_of(registry.parallaxBackgrounds.entities.back());
 
 	Entity helper = createHelperText(renderer, 1.f);
 	Motion& motion = registry.motions.get(helper);
@@ -220,6 +242,12 @@ void WorldSystem::create_almanac_screen() {
 // Update our game world
 bool WorldSystem::step(float elapsed_ms_since_last_update)
 {
+	renderer->getParticles().step(elapsed_ms_since_last_update);
+	// the background stands still during dialogue, like everything else that moves
+	if (dialogue_screen_active == 0)
+		for (ParallaxBackground &background : registry.parallaxBackgrounds.components)
+			background.scroll_ms += elapsed_ms_since_last_update;
+
 	if (dialogue_screen_active == 0) {
 		if (ddl == 4)
 		{
@@ -231,12 +259,6 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 			}
 		}
 
-		for (AnimationInfo& animation: registry.animated.components) {
-			if (animation.oneTimeState != -1) {
-				animation.oneTimer += elapsed_ms_since_last_update / 1000.f;
-			}
-		}
-		
 		// internal data update section
 		float expectedTimer = registry.players.get(player_hero).invulnerable_timer - elapsed_ms_since_last_update;
 		if (expectedTimer <= 0.0f)
@@ -246,46 +268,14 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 			registry.players.get(player_hero).invuln_type = INVULN_TYPE::NONE;
 		}
 		registry.players.get(player_hero).invulnerable_timer = expectedTimer;
+		set_listener_position(registry.motions.get(player_hero).position);
 
-		if (registry.players.get(player_hero).invuln_type == INVULN_TYPE::HIT) 
-		{
-			for (Entity e : player_hearts_GUI) {
-				registry.renderRequests.get(e).used_texture = TEXTURE_ASSET_ID::PLAYER_HEART_STEEL;
-			}
-		}
-		else if (registry.players.get(player_hero).invuln_type == INVULN_TYPE::HEAL)
-		{
-			for (Entity e : player_hearts_GUI) {
-				registry.renderRequests.get(e).used_texture = TEXTURE_ASSET_ID::PLAYER_HEART_HEAL;
-			}
-		}
-		else
-		{
-			for (Entity e : player_hearts_GUI) {
-				registry.renderRequests.get(e).used_texture = TEXTURE_ASSET_ID::PLAYER_HEART;
-			}
-		}
-
-		switch (registry.players.get(player_hero).equipment_type)
-		{
-			case COLLECTABLE_TYPE::PICKAXE:
-				registry.renderRequests.get(powerup_GUI).used_texture = TEXTURE_ASSET_ID::PICKAXE;
-				registry.renderRequests.get(powerup_GUI).visibility = true;
-				break;
-			case COLLECTABLE_TYPE::WINGED_BOOTS:
-				registry.renderRequests.get(powerup_GUI).used_texture = TEXTURE_ASSET_ID::WINGED_BOOTS;
-				registry.renderRequests.get(powerup_GUI).visibility = true;
-				break;
-			case COLLECTABLE_TYPE::DASH_BOOTS:
-				registry.renderRequests.get(powerup_GUI).used_texture = TEXTURE_ASSET_ID::DASH_BOOTS;
-				registry.renderRequests.get(powerup_GUI).visibility = true;
-				break;
-			default:
-				registry.renderRequests.get(powerup_GUI).used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
-				registry.renderRequests.get(powerup_GUI).visibility = false;
-		}
-
-		changeScore(points);
+		// the HUD widgets only hear about what changed
+		Player& hud_player = registry.players.get(player_hero);
+		hud.hp.set(hud_player.hp);
+		hud.invuln_type.set(hud_player.invuln_type);
+		hud.equipment.set(hud_player.equipment_type);
+		hud.score.set(points);
 
 		ddf = max(ddf, 0.f);
 		if (ddf < 100 && ddl != 0)
@@ -333,7 +323,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 			createHealthBar(renderer, boss);
 			if (ddf > recorded_max_ddf) {
 				show_dialogue(7);
-				printf("\nLv4\n");
+				LOG_INFO(GAME, "Lv4");
 			}
 		}
 		else if (ddf >= 500 && ddf < 600 && ddl != 5)
@@ -350,25 +340,25 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 		}
 
 		recorded_max_ddf = max(recorded_max_ddf, ddf);
-		state["history_max_ddf"] = max((float) state["history_max_ddf"].ToFloat(), ddf);
+		history_max_ddf = max(history_max_ddf, ddf);
 		points = (points > (unsigned int) INT_MAX) ? INT_MAX : points;
-		state["history_max_score"] = max((int) state["history_max_score"].ToInt(), (int) points);
+		history_max_score = max(history_max_score, (int) points);
 
-		if (ddl < 4)
-			registry.motions.get(indicator).position[0] = 30.f + ddf * INDICATOR_VELOCITY;
+		hud.difficulty.set(ddf);
 
 		if (ddl == 4)
 			ddf = 499.0;
 		else
 			ddf += elapsed_ms_since_last_update / 1000.f;
 
-		// Updating window title
-
-		std::stringstream title_ss;
-		title_ss << "Points: " << points;
-		title_ss << "; Dynamic Difficulty Level: " << ddl;
-		title_ss << "; Dynamic Difficulty Factor: " << ddf;
-		glfwSetWindowTitle(window, title_ss.str().c_str());
+		// Difficulty readout with the debug overlay, rebuilt only when the numbers change
+		Text& difficulty_text = registry.texts.get(difficulty_debug_text);
+		difficulty_text.visibility = debug;
+		if (debug) {
+			char line[64];
+			snprintf(line, sizeof(line), "points %u  level %d  factor %.1f", points, ddl, ddf);
+			set_text(difficulty_text, line);
+		}
 
 		// Remove debug info from the last step
 		while (registry.debugComponents.entities.size() > 0)
@@ -384,19 +374,10 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 		{
 			Motion &motion = motion_container.components[i];
 
-			if (motion.position.x + abs(motion.scale.x) < 0.f || motion.position.x - abs(motion.scale.x) > window_width_px || motion.position.y - abs(motion.scale.y) > window_height_px || motion.position.y + abs(motion.scale.y) < 0.f)
-			{
-				Entity e = motion_container.entities[i];
-				if (registry.parallaxBackgrounds.has(e)) {
-					ParallaxBackground &bg = registry.parallaxBackgrounds.get(e);
-					motion.position = bg.resetPosition;
-				}
-			}
-			
 			if (motion.position.y < -250 && (registry.bullets.has(motion_container.entities[i]) || registry.rockets.has(motion_container.entities[i]))) // || registry.waterBalls.has(motion_container.entities[i])
-				registry.remove_all_components_of(motion_container.entities[i]);
+				projectile_pool.release(motion_container.entities[i]);
 			else if (registry.lasers.has(motion_container.entities[i]) && (motion.position.x > window_width_px + window_width_px / 2.f || motion.position.x < -window_width_px / 2.f || motion.position.y > window_height_px + window_height_px / 2.f || motion.position.y < -window_height_px / 2.f))
-				registry.remove_all_components_of(motion_container.entities[i]);
+				projectile_pool.release(motion_container.entities[i]);
 			else if ((registry.boulders.has(motion_container.entities[i]) || registry.lavaPillars.has(motion_container.entities[i])) && (motion.position.y > window_height_px + motion.scale.y))
 				registry.remove_all_components_of(motion_container.entities[i]);
 		}
@@ -434,32 +415,22 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 			playerAnimation.curState = 0;
 		}
 
-		for (int i = 0; i < registry.players.get(player_hero).hp; i++) {
-			Entity curHeart = player_hearts_GUI[i];
-			registry.renderRequests.get(curHeart).visibility = true;
-		}
-		for (int i = registry.players.get(player_hero).hp; i < player_hearts_GUI.size(); i++) {
-			Entity curHeart = player_hearts_GUI[i];
-			registry.renderRequests.get(curHeart).visibility = false;
-		}
-
 
 		update_collectable_timer(elapsed_ms_since_last_update, renderer, ddl);
         move_firelings(renderer);
         move_boulder( renderer);
         move_ghouls(renderer, player_hero);
-        move_spitters(elapsed_ms_since_last_update, renderer);
+        move_spitters(elapsed_ms_since_last_update, renderer, spawn_director.spitter_shot_delay_ms());
 		if (boss && registry.boss.size()) {
 			boss_action_decision(player_hero, boss, renderer, elapsed_ms_since_last_update);
 		}
-        do_enemy_spawn(elapsed_ms_since_last_update, renderer, ddl);
+        do_enemy_spawn(elapsed_ms_since_last_update, renderer, spawn_director, ddl);
 		update_graphics_all_enemies();
 
 		if ((ddl == 2 || ddl == 3) && following_enemies.empty())
 		{
 			Entity newEnemy = createFollowingEnemy(renderer, find_index_from_map(vec2(12, 8)));
-			std::vector<std::vector<char>> vec = grid_vec;
-			bfs_follow_start(vec, registry.motions.get(newEnemy).position, registry.motions.get(player_hero).position, newEnemy);
+			bfs_follow_start(grid_vec, registry.motions.get(newEnemy).position, registry.motions.get(player_hero).position, newEnemy);
 			following_enemies.push_back(newEnemy);
 		}
 		else if ((ddl == 2 || ddl == 3) && !following_enemies.empty())
@@ -505,51 +476,9 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 
 void WorldSystem::changeScore(int score)
 {
-	if (score >= 99999) 
-	{
-		for (Entity n : score_GUI)
-			registry.renderRequests.get(n).used_texture = TEXTURE_ASSET_ID::NINE;
-	}
-	else
-	{
-		int mask = 10000;
-		for (Entity n : score_GUI)
-		{
-			int digit = score / mask;
-			registry.renderRequests.get(n).used_texture = connectNumber(digit);
-			if (digit != 0) {
-				score -= digit * mask;
-			}
-			mask /= 10;
-		}
-	}
-}
-
-TEXTURE_ASSET_ID WorldSystem::connectNumber(int digit)
-{
-	switch (digit)
-	{
-	case 0:
-		return TEXTURE_ASSET_ID::ZERO;
-	case 1:
-		return TEXTURE_ASSET_ID::ONE;
-	case 2:
-		return TEXTURE_ASSET_ID::TWO;
-	case 3:
-		return TEXTURE_ASSET_ID::THREE;
-	case 4:
-		return TEXTURE_ASSET_ID::FOUR;
-	case 5:
-		return TEXTURE_ASSET_ID::FIVE;
-	case 6:
-		return TEXTURE_ASSET_ID::SIX;
-	case 7:
-		return TEXTURE_ASSET_ID::SEVEN;
-	case 8:
-		return TEXTURE_ASSET_ID::EIGHT;
-	default:
-		return TEXTURE_ASSET_ID::NINE;
-	}
+	char digits[8];
+	snprintf(digits, sizeof(digits), "%05d", min(score, 99999));
+	set_text(registry.texts.get(score_number), digits);
 }
 
 void WorldSystem::show_dialogue(int dialogue_number)
@@ -568,10 +497,7 @@ void WorldSystem::show_dialogue(int dialogue_number)
 			registry.motions.get(difficulty_bar).position = DB_SATAN_CORD;
 			registry.renderRequests.get(difficulty_bar).scale = { 220.f, 128.f };
 			registry.renderRequests.get(score_text).visibility = true;
-			for (Entity n : score_GUI)
-			{
-				registry.renderRequests.get(n).visibility = true;
-			}
+			registry.texts.get(score_number).visibility = true;
 		}
 	}
 
@@ -639,10 +565,10 @@ void WorldSystem::update_graphics_all_enemies()
             continue;
         AnimationInfo& animation = registry.animated.get(entity);
 
-        if (animation.oneTimeState == enemy.death_animation && (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR) == animation.stateFrameLength[enemy.death_animation]) {
+        if (animation.oneTimeState == enemy.death_animation && (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR) == animation.clip->stateFrameLength[enemy.death_animation]) {
             registry.remove_all_components_of(entity);
             update_health_bar();
-        } else if (animation.oneTimeState == enemy.hit_animation && (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR) == animation.stateFrameLength[enemy.hit_animation]) {
+        } else if (animation.oneTimeState == enemy.hit_animation && (int)floor(animation.oneTimer * ANIMATION_SPEED_FACTOR) == animation.clip->stateFrameLength[enemy.hit_animation]) {
             enemy.hittable = true;
             enemy.hitting = true;
             if (registry.motions.get(entity).velocity.x != 0)
@@ -660,10 +586,12 @@ void WorldSystem::update_graphics_all_enemies()
 // Reset the world state to its initial state
 void WorldSystem::restart_game()
 {
+	restarts++;
 	isTitleScreen = false;
+	renderer->finishTextureLoading();
 	// Debugging for memory/component leaks
 	registry.list_all_components();
-	printf("Restarting\n");
+	LOG_INFO(GAME, "Restarting");
 	play_music();
 
 	points = 0;
@@ -672,6 +600,10 @@ void WorldSystem::restart_game()
 	// All that have a motion, we could also iterate over all, ... but that would be more cumbersome
 	while (registry.motions.entities.size() > 0)
 		registry.remove_all_components_of(registry.motions.entities.back());
+	// the parallax background has no motion
+	while (registry.parallaxBackgrounds.entities.size() > 0)
+		registry.remove_all_components_of(registry.parallaxBackgrounds.entities.back());
+	renderer->getParticles().clear();
 	// Debugging for memory/component leaks
 	registry.list_all_components();
 	// add bg
@@ -689,6 +621,7 @@ void WorldSystem::restart_game()
 
 	// global variables at this .cpp to reset, don't forget it!
 	motionKeyStatus.reset();
+	spawn_director.reset();
 	ddl = -1;
 	ddf = 0.f;
 	if (!death_skip_dialogue)
@@ -703,7 +636,6 @@ void WorldSystem::restart_game()
 	should_score_prepare_to_show = false;
 	player_color = registry.colors.get(player_hero);
 	player_hearts_GUI.clear();
-	score_GUI.clear();
 
 	create_inGame_GUIs();
 
@@ -727,116 +659,107 @@ void WorldSystem::restart_game()
 void WorldSystem::save_game() {
 	if (!isTitleScreen && !registry.deathTimers.has(player_hero))
 	{
-		state =
-		{
-			"mute", is_music_muted,
-			"ddl", ddl,
-			"ddf", ddf,
-			"recorded_max_ddf", recorded_max_ddf,
-			"history_max_ddf", state["history_max_ddf"],
-			"score", points,
-			"history_max_score", state["history_max_score"],
-			"hp", registry.players.get(player_hero).hp,
-			"player_x", registry.motions.get(player_hero).position.x,
-			"player_y", registry.motions.get(player_hero).position.y,
-			"weapon", save_weapon(registry.players.get(player_hero).weapon),
-			"fire_enemy", json::Array(),
-			"ghoul", json::Array(),
-			"spitter", json::Array(),
-			"spitter_bullet", json::Array(),
-			"boulder", json::Array(),
-		};
-
-		for (Entity fire_enemy : registry.fireEnemies.entities)
-		{
-			json::JSON sfes = json::Object();   // single_fire_enemy_save
-			sfes =
-			{
-				"hp", registry.enemies.get(fire_enemy).health,
-				"x_pos", registry.motions.get(fire_enemy).position.x,
-				"y_pos", registry.motions.get(fire_enemy).position.y,
-				"a", registry.testAIs.get(fire_enemy).a,
-				"b", registry.testAIs.get(fire_enemy).b,
-				"c", registry.testAIs.get(fire_enemy).c,
-				"from_right", registry.testAIs.get(fire_enemy).departFromRight,
-			};
-			state["fire_enemy"].append(sfes);
-		}
+		capture_snapshot(autosave_service.back_buffer());
+		autosave_service.submit();
+	}
 
-		for (Entity ghoul : registry.ghouls.entities)
-		{
-			json::JSON sgs = json::Object();   // single_ghoul_save
-			sgs =
-			{
-				"hp", registry.enemies.get(ghoul).health,
-				"x_pos", registry.motions.get(ghoul).position.x,
-				"y_pos", registry.motions.get(ghoul).position.y,
-				"x_v", registry.motions.get(ghoul).velocity.x,
-				"y_v", registry.motions.get(ghoul).velocity.y,
-				"dir", registry.motions.get(ghoul).dir,
-			};
-			state["ghoul"].append(sgs);
-		}
+	create_title_screen();
+}
 
-		for (Entity spitter : registry.spitterEnemies.entities)
-		{
-			json::JSON sss = json::Object();   // single_spitter_save
-			sss =
-			{
-				"hp", registry.enemies.get(spitter).health,
-				"x_pos", registry.motions.get(spitter).position.x,
-				"y_pos", registry.motions.get(spitter).position.y,
-				"x_v", registry.motions.get(spitter).velocity.x,
-				"y_v", registry.motions.get(spitter).velocity.y,
-				"dir", registry.motions.get(spitter).dir,
-				"timer", registry.spitterEnemies.get(spitter).timeUntilNextShotMs,
-				"shootable", registry.spitterEnemies.get(spitter).canShoot,
-				"right_x", registry.spitterEnemies.get(spitter).right_x,
-				"left_x", registry.spitterEnemies.get(spitter).left_x,
-			};
-			state["spitter"].append(sss);
-		}
+void WorldSystem::autosave(float elapsed_ms_since_last_update) {
+	// only endless mode autosaves, and never a dead player
+	if (ddl < 5 || isTitleScreen || registry.deathTimers.has(player_hero))
+	{
+		autosave_timer = 0.f;
+		return;
+	}
 
-		for (Entity spitter_bullet : registry.spitterBullets.entities)
-		{
-			json::JSON ssbs = json::Object();   // single_spitter_bullet_save
-			ssbs =
-			{
-				"x_pos", registry.motions.get(spitter_bullet).position.x,
-				"y_pos", registry.motions.get(spitter_bullet).position.y,
-				"x_v", registry.motions.get(spitter_bullet).velocity.x,
-				"y_v", registry.motions.get(spitter_bullet).velocity.y,
-				"scale_x", registry.motions.get(spitter_bullet).scale.x,
-				"scale_y", registry.motions.get(spitter_bullet).scale.y,
-				"angle", registry.motions.get(spitter_bullet).angle,
-				"mass", registry.spitterBullets.get(spitter_bullet).mass,
-			};
-			state["spitter_bullet"].append(ssbs);
-		}
+	autosave_timer += elapsed_ms_since_last_update;
+	if (autosave_timer < AUTOSAVE_INTERVAL_MS)
+		return;
+	autosave_timer = 0.f;
 
-		for (Entity boulder : registry.boulders.entities)
-		{
-			json::JSON sbs = json::Object();   // single_boulder_save
-			sbs =
-			{
-				"x_pos", registry.motions.get(boulder).position.x,
-				"y_pos", registry.motions.get(boulder).position.y,
-				"x_v", registry.motions.get(boulder).velocity.x,
-				"y_v", registry.motions.get(boulder).velocity.y,
-				"scale_x", registry.motions.get(boulder).scale.x,
-				"scale_y", registry.motions.get(boulder).scale.y,
-				"angle", registry.motions.get(boulder).angle,
-				"hitting", registry.enemies.get(boulder).hitting,
-			};
-			state["boulder"].append(sbs);
-		}
+	capture_snapshot(autosave_service.back_buffer());
+	autosave_service.submit();
+}
 
-		std::ofstream out("game_save.json");
-		out << state;
-		out.close();
+void WorldSystem::capture_snapshot(SaveSnapshot& snapshot) {
+	ScopedTimer timer("autosave snapshot");
+	// the lists keep their capacity, they only grow with the enemy count
+	HEAP_TAG_SCOPE(SAVE);
+	snapshot.clear();
+
+	snapshot.mute = is_music_muted;
+	snapshot.ddl = ddl;
+	snapshot.ddf = ddf;
+	snapshot.recorded_max_ddf = recorded_max_ddf;
+	snapshot.history_max_ddf = history_max_ddf;
+	snapshot.score = points;
+	snapshot.history_max_score = history_max_score;
+	snapshot.hp = registry.players.get(player_hero).hp;
+	snapshot.player_position = registry.motions.get(player_hero).position;
+	snapshot.weapon = save_weapon(registry.players.get(player_hero).weapon);
+
+	for (Entity fire_enemy : registry.fireEnemies.entities)
+	{
+		const TestAI& ai = registry.testAIs.get(fire_enemy);
+		snapshot.fire_enemies.push_back({
+			registry.enemies.get(fire_enemy).health,
+			registry.motions.get(fire_enemy).position,
+			ai.a, ai.b, ai.c,
+			ai.departFromRight,
+		});
 	}
 
-	create_title_screen();
+	for (Entity ghoul : registry.ghouls.entities)
+	{
+		const Motion& motion = registry.motions.get(ghoul);
+		snapshot.ghouls.push_back({
+			registry.enemies.get(ghoul).health,
+			motion.position,
+			motion.velocity,
+			motion.dir,
+		});
+	}
+
+	for (Entity spitter : registry.spitterEnemies.entities)
+	{
+		const Motion& motion = registry.motions.get(spitter);
+		const SpitterEnemy& info = registry.spitterEnemies.get(spitter);
+		snapshot.spitters.push_back({
+			registry.enemies.get(spitter).health,
+			motion.position,
+			motion.velocity,
+			motion.dir,
+			info.timeUntilNextShotMs,
+			info.canShoot,
+			info.left_x, info.right_x,
+		});
+	}
+
+	for (Entity spitter_bullet : registry.spitterBullets.entities)
+	{
+		const Motion& motion = registry.motions.get(spitter_bullet);
+		snapshot.spitter_bullets.push_back({
+			motion.position,
+			motion.velocity,
+			motion.scale,
+			motion.angle,
+			registry.spitterBullets.get(spitter_bullet).mass,
+		});
+	}
+
+	for (Entity boulder : registry.boulders.entities)
+	{
+		const Motion& motion = registry.motions.get(boulder);
+		snapshot.boulders.push_back({
+			motion.position,
+			motion.velocity,
+			motion.scale,
+			motion.angle,
+			registry.enemies.get(boulder).hitting,
+		});
+	}
 }
 
 int WorldSystem::save_weapon(Entity weapon) {
@@ -857,14 +780,20 @@ int WorldSystem::save_weapon(Entity weapon) {
 }
 
 void WorldSystem::load_game() {
+	HEAP_TAG_SCOPE(SAVE);
+	// make sure an in-flight autosave has landed before reading it back
+	autosave_service.flush();
 	std::ifstream in("game_save.json");
 	std::stringstream buffer;
 	buffer << in.rdbuf();
 	std::string jsonString = buffer.str();
-	if (jsonString != "")
+	json::Document doc;
+	if (jsonString != "" && doc.Parse(std::move(jsonString)))
 	{
-		state = json::JSON::Load(jsonString);
-		if (state["mute"].ToBool())
+		json::Document::Value save = doc.Root();
+		history_max_ddf = save["history_max_ddf"].ToFloat();
+		history_max_score = save["history_max_score"].ToInt();
+		if (save["mute"].ToBool())
 		{
 			is_music_muted = true;
 			set_mute_music(is_music_muted);
@@ -872,9 +801,9 @@ void WorldSystem::load_game() {
 		// restart after loading mute status
 		restart_game();
 
-		ddl = state["ddl"].ToInt();
-		ddf = state["ddf"].ToFloat();
-		recorded_max_ddf = state["recorded_max_ddf"].ToFloat();
+		ddl = save["ddl"].ToInt();
+		ddf = save["ddf"].ToFloat();
+		recorded_max_ddf = save["recorded_max_ddf"].ToFloat();
 		switch (ddl)
 		{
 			case 4:
@@ -888,17 +817,14 @@ void WorldSystem::load_game() {
 				registry.motions.get(difficulty_bar).position = DB_SATAN_CORD;
 				registry.renderRequests.get(difficulty_bar).scale = { 220.f, 128.f };
 				registry.renderRequests.get(score_text).visibility = true;
-				for (Entity n : score_GUI)
-				{
-					registry.renderRequests.get(n).visibility = true;
-				}
+				registry.texts.get(score_number).visibility = true;
 				break;
 		}
-		points = state["score"].ToInt();
+		points = save["score"].ToInt();
 		Player& player = registry.players.get(player_hero);
-		player.hp = state["hp"].ToInt();
-		int weapon = state["weapon"].ToInt();
-		registry.motions.get(player_hero).position = { state["player_x"].ToFloat(), state["player_y"].ToFloat() };
+		player.hp = save["hp"].ToInt();
+		int weapon = save["weapon"].ToInt();
+		registry.motions.get(player_hero).position = { save["player_x"].ToFloat(), save["player_y"].ToFloat() };
 		if (weapon == 0)
 			collect(createSword(renderer, { 0.f, 0.f }), player_hero);
 		else if (weapon == 1)
@@ -912,9 +838,9 @@ void WorldSystem::load_game() {
 		else if (weapon == 5)
 			collect(createTrident(renderer, { 0.f, 0.f }), player_hero);
 
-		for (int i = 0; i < state["fire_enemy"].size(); i++)
+		for (int i = 0; i < save["fire_enemy"].size(); i++)
 		{
-			json::JSON sfe = state["fire_enemy"][i];
+			json::Document::Value sfe = save["fire_enemy"][i];
 			if (!sfe["hp"].ToInt() <= 0)
 			{
 				Entity nfe = createFireing(renderer, {sfe["x_pos"].ToFloat(), sfe["y_pos"].ToFloat()});
@@ -930,9 +856,9 @@ void WorldSystem::load_game() {
 			}
 		}
 
-		for (int i = 0; i < state["ghoul"].size(); i++)
+		for (int i = 0; i < save["ghoul"].size(); i++)
 		{
-			json::JSON sg = state["ghoul"][i];
+			json::Document::Value sg = save["ghoul"][i];
 			if (!sg["hp"].ToInt() <= 0)
 			{
 				Entity ng = createGhoul(renderer, { sg["x_pos"].ToFloat(), sg["y_pos"].ToFloat() });
@@ -946,9 +872,9 @@ void WorldSystem::load_game() {
 			}
 		}
 
-		for (int i = 0; i < state["spitter"].size(); i++)
+		for (int i = 0; i < save["spitter"].size(); i++)
 		{
-			json::JSON ss = state["spitter"][i];
+			json::Document::Value ss = save["spitter"][i];
 			if (!ss["hp"].ToInt() <= 0)
 			{
 				Entity ns = createSpitterEnemy(renderer, { ss["x_pos"].ToFloat(), ss["y_pos"].ToFloat() });
@@ -967,9 +893,9 @@ void WorldSystem::load_game() {
 			}
 		}
 
-		for (int i = 0; i < state["spitter_bullet"].size(); i++)
+		for (int i = 0; i < save["spitter_bullet"].size(); i++)
 		{
-			json::JSON ssb = state["spitter_bullet"][i];
+			json::Document::Value ssb = save["spitter_bullet"][i];
 			Entity nsb = createSpitterEnemyBullet(renderer, { ssb["x_pos"].ToFloat(), ssb["y_pos"].ToFloat() }, ssb["angle"].ToFloat());
 			registry.spitterBullets.get(nsb).mass = ssb["mass"].ToFloat();
 			Motion& nsb_mo = registry.motions.get(nsb);
@@ -977,9 +903,9 @@ void WorldSystem::load_game() {
 			nsb_mo.velocity = { ssb["x_v"].ToFloat(), ssb["y_v"].ToFloat() };
 		}
 
-		for (int i = 0; i < state["boulder"].size(); i++)
+		for (int i = 0; i < save["boulder"].size(); i++)
 		{
-			json::JSON sb = state["boulder"][i];
+			json::Document::Value sb = save["boulder"][i];
 			Entity nb = createBoulder(renderer, { sb["x_pos"].ToFloat(), sb["y_pos"].ToFloat() }, { sb["x_v"].ToFloat(), sb["y_v"].ToFloat() }, 3.f);
 			registry.enemies.get(nb).hitting = sb["hitting"].ToBool();
 			Motion& nb_mo = registry.motions.get(nb);
@@ -992,11 +918,8 @@ void WorldSystem::load_game() {
 	else
 	{
 		restart_game();
-		state =
-		{
-			"history_max_ddf", 0.f,
-			"history_max_score", 0,
-		};
+		history_max_ddf = 0.f;
+		history_max_score = 0;
 	}
 }
 
@@ -1007,20 +930,51 @@ void WorldSystem::create_pause_screen() {
 }
 
 void WorldSystem::create_parallax_background() {
-	parallax_background_color = createParallaxItem(renderer, {600, 400}, TEXTURE_ASSET_ID::BACKGROUND_COLOR);
-	parallax_moon = createParallaxItem(renderer, {580, 400}, TEXTURE_ASSET_ID::PARALLAX_MOON);
-	parallax_clouds_far_1 = createParallaxItem(renderer, {600, 400}, TEXTURE_ASSET_ID::PARALLAX_CLOUDS_FAR);
-	parallax_clouds_far_2 = createParallaxItem(renderer, {-600, 400}, TEXTURE_ASSET_ID::PARALLAX_CLOUDS_FAR);
-	parallax_clouds_close_1 = createParallaxItem(renderer, {600, 400}, TEXTURE_ASSET_ID::PARALLAX_CLOUDS_CLOSE);
-	parallax_clouds_close_2 = createParallaxItem(renderer, {-600, 400}, TEXTURE_ASSET_ID::PARALLAX_CLOUDS_CLOSE);
-	parallax_rain_1 = createParallaxItem(renderer, {0, 1200}, TEXTURE_ASSET_ID::PARALLAX_RAIN);
-	parallax_rain_2 = createParallaxItem(renderer, {600, 800}, TEXTURE_ASSET_ID::PARALLAX_RAIN);
-	parallax_rain_3 = createParallaxItem(renderer, {400, 400}, TEXTURE_ASSET_ID::PARALLAX_RAIN);
-	parallax_rain_4 = createParallaxItem(renderer, {800, 100}, TEXTURE_ASSET_ID::PARALLAX_RAIN);
-	parallax_background = createParallaxItem(renderer, {600, 400}, TEXTURE_ASSET_ID::BACKGROUND);
-	parallax_lava_1 = createParallaxItem(renderer, {600, 813}, TEXTURE_ASSET_ID::PARALLAX_LAVA);
-	parallax_lava_2 = createParallaxItem(renderer, {-600, 813}, TEXTURE_ASSET_ID::PARALLAX_LAVA);
-	parallax_lava_3 = createParallaxItem(renderer, {-1200, 813}, TEXTURE_ASSET_ID::PARALLAX_LAVA);
+	parallax_background = createParallaxBackground();
+	lava = createLava(renderer, {600, 813});
+}
+
+// Subscribes the HUD widgets just created to the HUD model. The first publish
+// after this updates every widget, later ones only those whose value changed.
+void WorldSystem::bind_hud() {
+	hud.reset();
+	hud.hp.subscribe([](const int& hp) {
+		for (size_t i = 0; i < player_hearts_GUI.size(); i++)
+			registry.renderRequests.get(player_hearts_GUI[i]).visibility = (int)i < hp;
+	});
+	hud.invuln_type.subscribe([](const INVULN_TYPE& type) {
+		TEXTURE_ASSET_ID texture = TEXTURE_ASSET_ID::PLAYER_HEART;
+		if (type == INVULN_TYPE::HIT)
+			texture = TEXTURE_ASSET_ID::PLAYER_HEART_STEEL;
+		else if (type == INVULN_TYPE::HEAL)
+			texture = TEXTURE_ASSET_ID::PLAYER_HEART_HEAL;
+		for (Entity e : player_hearts_GUI)
+			registry.renderRequests.get(e).used_texture = texture;
+	});
+	hud.equipment.subscribe([](const COLLECTABLE_TYPE& type) {
+		RenderRequest& icon = registry.renderRequests.get(powerup_GUI);
+		switch (type)
+		{
+			case COLLECTABLE_TYPE::PICKAXE:
+				icon.used_texture = TEXTURE_ASSET_ID::PICKAXE;
+				break;
+			case COLLECTABLE_TYPE::WINGED_BOOTS:
+				icon.used_texture = TEXTURE_ASSET_ID::WINGED_BOOTS;
+				break;
+			case COLLECTABLE_TYPE::DASH_BOOTS:
+				icon.used_texture = TEXTURE_ASSET_ID::DASH_BOOTS;
+				break;
+			default:
+				icon.used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
+		}
+		icon.visibility = icon.used_texture != TEXTURE_ASSET_ID::TEXTURE_COUNT;
+	});
+	hud.score.subscribe([this](const unsigned int& score) { changeScore(score); });
+	hud.difficulty.subscribe([](const float& factor) {
+		// the indicator is gone once the boss level is reached
+		if (registry.motions.has(indicator))
+			registry.motions.get(indicator).position[0] = 30.f + factor * INDICATOR_VELOCITY;
+	});
 }
 
 void WorldSystem::create_inGame_GUIs() {
@@ -1033,11 +987,9 @@ void WorldSystem::create_inGame_GUIs() {
 	difficulty_bar = createDifficultyBar(renderer, DIFF_BAR_CORD);
 	indicator = createDifficultyIndicator(renderer, INDICATOR_START_CORD);
 	score_text = createScore(renderer, SCORE_CORD);
-	float numberPosition = NUMBER_START_POS;
-	for (int i = 0; i < 5; i++) {
-		score_GUI.push_back(createNumber(renderer, { numberPosition, NUMBER_Y_CORD }));
-		numberPosition += NUMBER_GAP;
-	}
+	score_number = createScoreNumber(SCORE_NUMBER_CORD);
+	difficulty_debug_text = createDebugText(DIFFICULTY_TEXT_CORD);
+	bind_hud();
 }
 
 // Compute collisions between entities
@@ -1065,13 +1017,14 @@ void WorldSystem::handle_collisions()
 			{
 				// remove 1 hp
 				player.hp -= 1;
+				renderer->getParticles().emit(PARTICLE_EFFECT::HIT, registry.motions.get(entity).position);
 				registry.players.get(player_hero).invulnerable_timer = max(3000.f, registry.players.get(player_hero).invulnerable_timer);
 				registry.players.get(player_hero).invuln_type = INVULN_TYPE::HIT;
 				play_sound(SOUND_EFFECT::HERO_DEAD);
 				if (ddl < 4) ddf -= (player.hp_max - player.hp) * DDF_PUNISHMENT;
 
 				if (registry.spitterBullets.has(entity_other))
-					registry.remove_all_components_of(entity_other);
+					projectile_pool.release(entity_other);
 
 				// initiate death unless already dying
 				if (player.hp == 0 && !registry.deathTimers.has(entity))
@@ -1079,9 +1032,6 @@ void WorldSystem::handle_collisions()
 					registry.deathTimers.emplace(entity);
 					
 					if (player.hasWeapon) {
-						if (registry.grenadeLaunchers.has(player.weapon))
-							for(Entity line: registry.grenadeLaunchers.get(player.weapon).trajectory)
-								registry.remove_all_components_of(line);
 						registry.remove_all_components_of(player.weapon);
 					}
 					player.hasWeapon = false;
@@ -1110,6 +1060,8 @@ void WorldSystem::handle_collisions()
 					Enemies& enemy = registry.enemies.get(entity_other);
 					enemy.health -= registry.weaponHitBoxes.get(entity).damage;
 					enemy.hittable = false;
+					vec2 enemy_position = registry.motions.get(entity_other).position;
+					renderer->getParticles().emit(enemy.health <= 0 ? PARTICLE_EFFECT::DEATH : PARTICLE_EFFECT::HIT, enemy_position);
 					enemy.hitting = false;
 					if (!registry.fireEnemies.has(entity_other))
 						registry.motions.get(entity_other).dir = registry.motions.get(entity).position.x < registry.motions.get(entity_other).position.x ? -1 : 1;
@@ -1121,7 +1073,7 @@ void WorldSystem::handle_collisions()
 						}
 						registry.animated.get(entity_other).oneTimeState = enemy.death_animation;
                         if (registry.boss.has(entity_other)) {
-                            play_sound(SOUND_EFFECT::BOSS_DEATH);
+                            play_sound(SOUND_EFFECT::BOSS_DEATH, registry.motions.get(entity_other).position);
                         }
 					} else {
 						registry.animated.get(entity_other).oneTimeState = enemy.hit_animation;
@@ -1132,16 +1084,16 @@ void WorldSystem::handle_collisions()
 				if (registry.bullets.has(entity) || registry.rockets.has(entity) || registry.grenades.has(entity)) {
 					if (registry.rockets.has(entity) || registry.grenades.has(entity))
 						explode(renderer, registry.motions.get(entity).position, entity);
-					registry.remove_all_components_of(entity);
+					projectile_pool.release(entity);
 				} else if (registry.explosions.has(entity) && registry.boulders.has(entity_other)) {
 					registry.remove_all_components_of(entity_other);
 				}
 			} else if (registry.blocks.has(entity_other) && (registry.bullets.has(entity) || registry.rockets.has(entity))) {
 				if (registry.rockets.has(entity))
 					explode(renderer, registry.motions.get(entity).position, entity);
-				registry.remove_all_components_of(entity);
+				projectile_pool.release(entity);
 			} else if (registry.swords.has(entity) && registry.spitterBullets.has(entity_other)) {
-				registry.remove_all_components_of(entity_other);
+				projectile_pool.release(entity_other);
 			}
 		}
 		else if (registry.blocks.has(entity))
@@ -1216,8 +1168,7 @@ void WorldSystem::handle_collisions()
 				if (registry.waterBalls.has(entity_other)) {
 					registry.waterBalls.get(entity_other).drawing = false;
 					registry.waterBalls.get(entity_other).state = -1;
-					for (Entity line: registry.waterBalls.get(entity_other).trajectory)
-						registry.remove_all_components_of(line);
+					projectile_pool.release_polyline(entity_other);
 					registry.animated.get(entity_other).oneTimeState = 2;
 					registry.animated.get(entity_other).oneTimer = 0;
 					registry.weaponHitBoxes.get(entity_other).isActive = false;
@@ -1242,23 +1193,15 @@ void WorldSystem::handle_collisions()
 				}
 				projectile_motion.velocity = vec2(projectile_motion.velocity.x * projectile.friction_x, projectile_motion.velocity.y * projectile.friction_y);
 			} 
-		} else if (registry.parallaxBackgrounds.has(entity) && registry.renderRequests.get(entity).used_texture == TEXTURE_ASSET_ID::PARALLAX_LAVA) {
+		} else if (registry.lava.has(entity)) {
 			if (registry.bullets.has(entity_other) || registry.rockets.has(entity_other) || registry.grenades.has(entity_other) || registry.spitterBullets.has(entity_other) || registry.collectables.has(entity_other) || registry.waterBalls.has(entity_other)) {
-				if (registry.waterBalls.has(entity_other)) {
-					registry.waterBalls.get(entity_other).drawing = false;
-					for (Entity line: registry.waterBalls.get(entity_other).trajectory)
-						registry.remove_all_components_of(line);
-				}
-				registry.remove_all_components_of(entity_other);
+				projectile_pool.release(entity_other);
 			} else if (registry.players.has(entity_other) && !registry.deathTimers.has(entity_other)) {
 				// Scream, reset timer, and make the hero fall
 				registry.deathTimers.emplace(entity_other);
 				Player& player = registry.players.get(entity_other);
 			
 				if (player.hasWeapon) {
-					if (registry.grenadeLaunchers.has(player.weapon))
-						for(Entity line: registry.grenadeLaunchers.get(player.weapon).trajectory)
-							registry.remove_all_components_of(line);
 					registry.remove_all_components_of(player.weapon);
 				}
 				player.hasWeapon = false;
@@ -1304,7 +1247,7 @@ void WorldSystem::motion_helper(Motion &playerMotion)
 
 void WorldSystem::clear_enemies()
 {
-	std::vector<Entity> justKillThem = { };
+	frame_vector<Entity> justKillThem;
 	for (uint i = 0; i < registry.enemies.size(); i++)
 	{
 		Entity enemy = registry.enemies.entities[i];
@@ -1500,6 +1443,17 @@ void WorldSystem::on_key(int key, int, int action, int mod)
 		ddf = 500;
 	}
 
+	// Toggles render scale following the GPU frame time
+	if (key == GLFW_KEY_V && action == GLFW_RELEASE && debug) {
+		renderer->setDynamicResolution(!renderer->dynamicResolution());
+		LOG_INFO(RENDER, "Dynamic resolution %s", renderer->dynamicResolution() ? "on" : "off");
+	}
+
+	// Dumps memory per heap tag, container, GPU resource and sound
+	if (key == GLFW_KEY_H && action == GLFW_RELEASE && debug) {
+		log_memory_report(renderer);
+	}
+
 	if (action == GLFW_RELEASE && key == GLFW_KEY_M) {
 		is_music_muted = !is_music_muted;
 		set_mute_music(is_music_muted);
@@ -17,6 +17,9 @@
 #include "weapon_utils.hpp"
 #include "ai_system.hpp"
 #include "enemy_utils.hpp"
+#include "spawn_director.hpp"
+#include "autosave.hpp"
+#include "hud.hpp"
 // Container for all our entities and game logic. Individual rendering / update is
 // deferred to the relative update() methods
 
@@ -26,9 +29,6 @@
 const float ANIMATION_SPEED_FACTOR = 10.0f;
 
 // Game configuration
-static float spitter_projectile_delay_ms = 5000.f;
-static float spawn_delay_variance = 0.6;
-static size_t spawn_delay = 6000;
 const size_t BOSS_MAX_GHOULS = 14;
 const size_t BOSS_MAX_SPITTERS = 8;
 const float ENEMY_INVULNERABILITY_TIME = 500.f;
@@ -51,26 +51,16 @@ const vec2 DB_BOSS_CORD = { 140.f, 717.5f };
 const vec2 INDICATOR_START_CORD = { 35.f, 710.f };
 const float INDICATOR_VELOCITY = 55.f / 100.f;
 const vec2 SCORE_CORD = { 1050.f, 700.f };
-const float NUMBER_START_POS = 992.f;
-const float NUMBER_GAP = 29.f;
-const float NUMBER_Y_CORD = 740.f;
+// top left of the five score digits
+const vec2 SCORE_NUMBER_CORD = { 977.5f, 725.5f };
+// top right of the debug difficulty readout
+const vec2 DIFFICULTY_TEXT_CORD = { 1190.f, 10.f };
 const vec2 DB_SATAN_CORD = { 140.f, 725.f };
 const float LAVA_PILLAR_SPAWN_DELAY = 15000.f;
 const uint MDP_HORIZON = 2;
 const float MDP_DISCOUNT_FACTOR = 0.9f;
 const float MDP_BASE_REWARD = 100;
-
-enum SpawnableEnemyType {
-        FIRELINGS = 0,
-        GHOULS = FIRELINGS + 1,
-        SPITTERS = GHOULS + 1,
-        BOULDERS = SPITTERS + 1,
-        ENEMY_COUNT = BOULDERS + 1
-};
-
-static std::vector<int> max_spawns;
-
-static std::vector<float> spawn_prob;
+const float AUTOSAVE_INTERVAL_MS = 10000.f;
 
 class WorldSystem
 {
@@ -82,6 +72,8 @@ public:
 	static bool mouse_clicked;
 	static bool isTitleScreen;
 	static int dialogue_screen_active;
+	// how often restart_game rebuilt the world
+	unsigned int restarts = 0;
 
 	// Creates a window
 	GLFWwindow *create_window();
@@ -97,8 +89,6 @@ public:
   
 	void changeScore(int score);
 
-	TEXTURE_ASSET_ID connectNumber(int digit);
-
 	void show_dialogue(int dialogue_number);
 	TEXTURE_ASSET_ID connectDialogue(int digit);
 
@@ -109,6 +99,9 @@ public:
 	// Check for collisions
 	void handle_collisions();
 
+	// Called at the end of a tick; periodically hands a snapshot to the autosave thread in endless mode
+	void autosave(float elapsed_ms_since_last_update);
+
 	// Should the game be over ?
 	bool is_over() const;
 
@@ -132,6 +125,9 @@ private:
 
 	void save_game();
 
+	// Copies the saveable components into snapshot, no serialisation happens here
+	void capture_snapshot(SaveSnapshot& snapshot);
+
 	void load_game();
 
 	int save_weapon(Entity weapon);
@@ -149,20 +145,19 @@ private:
 	
 	// backgrounds
     void create_parallax_background();
+
+	// HUD widgets follow this model, see bind_hud
+	HudModel hud;
+	void bind_hud();
 	Entity parallax_background;
-	Entity parallax_background_color;
-	Entity parallax_clouds_far_1;
-	Entity parallax_clouds_far_2;
-	Entity parallax_clouds_close_1;
-	Entity parallax_clouds_close_2;
-	Entity parallax_rain_1;
-	Entity parallax_rain_2;
-	Entity parallax_rain_3;
-	Entity parallax_rain_4;
-	Entity parallax_moon;
-	Entity parallax_lava_1;
-	Entity parallax_lava_2;
-	Entity parallax_lava_3;
+	Entity lava;
+
+	// Enemy waves, tiers come from data/spawns.json
+	SpawnDirector spawn_director;
+
+	// Autosave
+	AutosaveService autosave_service;
+	float autosave_timer = 0.f;
 
 	// Game state
 	RenderSystem *renderer;